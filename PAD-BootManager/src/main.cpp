@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -7,6 +8,7 @@
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include "pad_firmware.h"
 
 // Forward declarations for bootloader handlers
 class DFUHandler;
@@ -33,7 +35,8 @@ public:
         std::cout << "Usage: pad-bootmanager [OPTIONS]\n";
         std::cout << "Options:\n";
         std::cout << "  -d, --device PORT         Device port (e.g., /dev/ttyUSB0)\n";
-        std::cout << "  -f, --firmware FILE       Firmware file to flash\n";
+        std::cout << "  -f, --firmware FILE       Firmware file to flash: raw binary, Intel HEX,\n";
+        std::cout << "                            S-record or ELF\n";
         std::cout << "  -m, --mode MODE           Bootloader mode: dfu, uf2 (default: dfu)\n";
         std::cout << "  -v, --verbose             Enable verbose output\n";
         std::cout << "  -r, --recovery            Enable recovery mode\n";
@@ -179,17 +182,30 @@ public:
     }
     
     bool load_firmware() {
-        std::ifstream file(firmware_file, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open firmware file: " << firmware_file << std::endl;
+        // Raw binaries, Intel HEX, S-records and ELF; gaps between segments
+        // are left alone on the device
+        char error[256];
+        pad_firmware* firmware = pad_firmware_load(firmware_file.c_str(), PAD_FIRMWARE_AUTO, 0,
+                                                   error, sizeof(error));
+        if (!firmware) {
+            std::cerr << "Error: Could not load firmware file: " << error << std::endl;
             return false;
         }
         
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
-        
-        std::cout << "Loaded firmware: " << firmware_file << " (" << size << " bytes)" << std::endl;
+        size_t count = pad_firmware_segment_count(firmware);
+        std::cout << "Loaded firmware: " << firmware_file << " ("
+                  << pad_firmware_data_size(firmware) << " bytes, "
+                  << pad_firmware_format_name(pad_firmware_get_format(firmware)) << ")" << std::endl;
+        if (verbose || count > 1) {
+            const pad_firmware_segment* segments = pad_firmware_segments(firmware);
+            for (size_t i = 0; i < count; i++) {
+                std::cout << "  0x" << std::hex << std::setw(8) << std::setfill('0')
+                          << segments[i].address << std::dec << std::setfill(' ')
+                          << "  " << segments[i].length << " bytes" << std::endl;
+            }
+        }
         
+        pad_firmware_free(firmware);
         return true;
     }
     
@@ -78,6 +78,7 @@ struct DebuggerConfig {
     bool timeline_enabled = false;        // Enable task timeline
     std::vector<Watchpoint> watchpoints;  // Memory watchpoints to set
     int debug_speed = 4000;               // Debug interface speed in kHz
+    std::string trace_file;               // Chrome/Perfetto trace output (empty = off)
 };
 
 #endif // DEBUGGER_CORE_HPP
\ No newline at end of file
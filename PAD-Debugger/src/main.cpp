@@ -23,6 +23,7 @@
 #include "logger.hpp"
 #include "debugger_core.hpp"
 #include "rtos_integrator.hpp"
+#include "pad_trace.h"
 
 // Application version
 const std::string VERSION = "1.0.0";
@@ -67,14 +68,21 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    if (!config.trace_file.empty()) {
+        pad_trace_init(0);
+        pad_trace_set_thread_name("main");
+    }
+
     // Initialize debugger core
     DebuggerCore debugger(config);
     
     // Execute the requested command
     int result = 0;
     if (config.command == "debug") {
+        PAD_TRACE_SPAN("debug_session");
         result = debugger.start_debug_session();
     } else if (config.command == "connect") {
+        PAD_TRACE_SPAN("connect_to_target");
         result = debugger.connect_to_target();
     } else if (config.command == "list-rtos") {
         debugger.list_supported_rtos();
@@ -86,6 +94,13 @@ int main(int argc, char* argv[]) {
         result = 1;
     }
 
+    if (!config.trace_file.empty()) {
+        if (pad_trace_dump_json(config.trace_file.c_str()) != 0) {
+            Logger::log(LogLevel::ERROR, "Could not write trace file: " + config.trace_file);
+        }
+        pad_trace_shutdown();
+    }
+
     // Clean up SDL
     SDL_Quit();
 
@@ -111,6 +126,7 @@ bool parse_arguments(int argc, char* argv[], DebuggerConfig& config) {
         {"watch-read", required_argument, 0, 'R'},
         {"watch-access", required_argument, 0, 'A'},
         {"verbose", no_argument, 0, 'v'},
+        {"trace", required_argument, 0, 1001},
         {"version", no_argument, 0, 'V'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
@@ -156,6 +172,9 @@ bool parse_arguments(int argc, char* argv[], DebuggerConfig& config) {
             case 'v':
                 Logger::set_level(LogLevel::DEBUG);
                 break;
+            case 1001: // trace
+                config.trace_file = optarg;
+                break;
             case 'V':
                 print_version();
                 return false; // Exit after printing version
@@ -205,6 +224,7 @@ void print_usage(const char* prog_name) {
     std::cout << "  -R, --watch-read ADDR    Set read watchpoint at address/symbol\n";
     std::cout << "  -A, --watch-access ADDR  Set access watchpoint at address/symbol\n";
     std::cout << "  -v, --verbose            Enable verbose output\n";
+    std::cout << "  --trace PATH             Write a Chrome/Perfetto trace of the run to PATH\n";
     std::cout << "  -V, --version            Show version information\n";
     std::cout << "  -h, --help               Show this help message\n\n";
     std::cout << "Examples:\n";
@@ -0,0 +1,832 @@
+// pad-devsim: a farm of simulated PAD bootloaders on pseudo-terminals
+//
+// Each simulated device owns a PTY pair and speaks the UART bootloader
+// protocol (protocols/bootloader.h) on the slave side, so the flasher can be
+// pointed at the slave paths like at real adapters:
+//
+//   pad-devsim -n 64 &
+//   pad-flasher -D /dev/pts/3,/dev/pts/4,... -f firmware.bin -P 16
+//
+// Line speed, flash timing and transmission errors are emulated so that
+// scheduling and protocol changes can be measured without hardware.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <random>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "pad_frame.h"
+#include "pad_lz.h"
+#include "../protocols/bootloader.h"
+
+using namespace bootloader;
+using Clock = std::chrono::steady_clock;
+
+static const int MIN_BAUDRATE = 1200;
+// Fraction of bytes damaged when running faster than --max-baud
+static const double LINE_NOISE_RATE = 0.002;
+
+// The host's line speed, read through the master side. termios2 is declared
+// here because the kernel's own header clashes with <termios.h>.
+#ifdef TCGETS2
+struct termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+#endif
+
+static std::atomic<bool> running(true);
+
+static void handle_signal(int) {
+    running = false;
+}
+
+struct SimConfig {
+    int devices = 4;
+    std::string link_dir;
+    int baudrate = 0;             // 0: follow whatever rate the host sets
+    int max_baudrate = 0;         // Fastest rate without line errors (0: no limit)
+    uint32_t flash_size = 1024 * 1024;
+    uint32_t sector_size = 4096;
+    uint32_t max_block = 1024;
+    uint32_t window = 16;         // Blocks the device can buffer
+    int erase_ms = 20;            // Per sector
+    int write_us = 500;           // Per KB
+    int jitter = 0;               // +/- percent on flash timings
+    double corrupt_rate = 0;      // Received frames damaged on the line
+    double drop_rate = 0;         // Replies lost on the line
+    int dead = 0;                 // Last N devices never answer
+    std::string image_file;
+    std::string dump_dir;
+    unsigned seed = 1;
+};
+
+struct SimStats {
+    uint64_t frames = 0;
+    uint64_t bad_frames = 0;
+    uint64_t bytes_written = 0;
+    uint64_t sectors_erased = 0;
+    uint64_t syncs = 0;
+    uint64_t resets = 0;
+    uint64_t dropped = 0;
+    uint64_t overflows = 0;       // Blocks sent beyond the window
+};
+
+class SimDevice {
+private:
+    const SimConfig& config_;
+    bool dead_;
+    int master_ = -1;
+    int slave_ = -1;
+    std::string path_;
+    std::vector<uint8_t> flash_;
+    pad_framer* framer_ = nullptr;
+    std::mt19937 rng_;
+    Clock::time_point rx_clock_;  // When the bytes received so far finish arriving
+
+    // Line rate set by SET_BAUD (0: follow the host). A new rate stays
+    // provisional until confirmed, as on the real bootloader.
+    int rate_;
+    int fallback_rate_ = 0;
+    bool provisional_ = false;
+    Clock::time_point confirm_by_;
+
+    // Accepted commands run in order once the device gets to them, while the
+    // line keeps receiving
+    struct Operation {
+        Clock::time_point due;
+        std::vector<uint8_t> packet;
+        int rate;
+    };
+    std::deque<Operation> operations_;
+    Clock::time_point busy_until_;
+    size_t queued_blocks_ = 0;
+    std::vector<bool> blocks_done_;  // Windowed transfer: blocks programmed
+    size_t first_missing_ = 0;
+
+    uint8_t tx_packet_[MAX_PACKET];
+    std::vector<uint8_t> tx_frame_;
+    SimStats stats_;
+
+public:
+    SimDevice(const SimConfig& config, int index, const std::vector<uint8_t>& image)
+        : config_(config), dead_(index >= config.devices - config.dead),
+          flash_(config.flash_size, 0xFF), rng_(config.seed * 7919u + index),
+          rate_(config.baudrate) {
+        std::copy(image.begin(), image.begin() + std::min(image.size(), flash_.size()),
+                  flash_.begin());
+        tx_frame_.resize(pad_frame_encoded_max(PAD_FRAME_HDLC, MAX_PACKET));
+    }
+
+    ~SimDevice() {
+        pad_framer_destroy(framer_);
+        if (master_ >= 0) close(master_);
+        if (slave_ >= 0) close(slave_);
+    }
+
+    const std::string& path() const { return path_; }
+    const SimStats& stats() const { return stats_; }
+    const std::vector<uint8_t>& flash() const { return flash_; }
+    bool dead() const { return dead_; }
+
+    bool open_pty() {
+        master_ = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master_ < 0 || grantpt(master_) != 0 || unlockpt(master_) != 0) {
+            return false;
+        }
+        path_ = ptsname(master_);
+
+        // Hold the slave open ourselves: the master then never sees a hangup
+        // between flasher sessions, and the line is raw until the host
+        // configures it
+        slave_ = open(path_.c_str(), O_RDWR | O_NOCTTY);
+        if (slave_ < 0) {
+            return false;
+        }
+        struct termios tty;
+        tcgetattr(slave_, &tty);
+        cfmakeraw(&tty);
+        cfsetspeed(&tty, B115200);
+        tcsetattr(slave_, TCSANOW, &tty);
+
+        framer_ = pad_framer_create(PAD_FRAME_HDLC, 64 * 1024, 0);
+        return framer_ != nullptr;
+    }
+
+    void run() {
+        pad_ring* ring = pad_framer_ring(framer_);
+        rx_clock_ = busy_until_ = Clock::now();
+
+        while (running) {
+            auto wait = std::chrono::nanoseconds(std::chrono::milliseconds(100));
+            if (!operations_.empty()) {
+                wait = std::min(wait, std::max(std::chrono::nanoseconds(0),
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        operations_.front().due - Clock::now())));
+            }
+            struct timespec timeout;
+            timeout.tv_sec = (time_t)(wait.count() / 1000000000);
+            timeout.tv_nsec = (long)(wait.count() % 1000000000);
+
+            struct pollfd pfd = {master_, POLLIN, 0};
+            int ready = ppoll(&pfd, 1, &timeout, NULL);
+            if (provisional_ && Clock::now() >= confirm_by_) {
+                rate_ = fallback_rate_;
+                provisional_ = false;
+            }
+            while (!operations_.empty() && operations_.front().due <= Clock::now()) {
+                execute(operations_.front());
+                operations_.pop_front();
+            }
+            if (ready <= 0) {
+                continue;
+            }
+
+            size_t space;
+            uint8_t* dest = pad_ring_write_ptr(ring, &space);
+            ssize_t received = read(master_, dest, space);
+            if (received <= 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+
+            // Bytes arrive no faster than the device's line rate, and turn to
+            // garbage if the host runs at a different rate
+            int rate = line_rate();
+            rx_clock_ = std::max(rx_clock_, Clock::now()) + line_time(received, rate);
+            if (rate_ && !rate_matches(host_rate(), rate_)) {
+                for (ssize_t i = 0; i < received; i++) {
+                    dest[i] = (uint8_t)rng_();
+                }
+            }
+            add_line_noise(dest, received, rate);
+            pad_ring_commit(ring, received);
+
+            pad_frame frame;
+            int result;
+            while ((result = pad_framer_next(framer_, &frame)) != 0) {
+                if (result < 0) {
+                    stats_.bad_frames++;
+                    continue;
+                }
+                handle_frame(const_cast<uint8_t*>(frame.data), frame.length, rate);
+            }
+        }
+    }
+
+private:
+    int host_rate() const {
+#ifdef TCGETS2
+        struct termios2 tty;
+        if (ioctl(master_, TCGETS2, &tty) == 0 && tty.c_ospeed > 0) {
+            return (int)tty.c_ospeed;
+        }
+#endif
+        return 0;
+    }
+
+    // UARTs tolerate a few percent of clock mismatch
+    static bool rate_matches(int host, int device) {
+        return host == 0 || std::abs(host - device) * 100 <= device * 3;
+    }
+
+    int line_rate() const {
+        if (rate_) return rate_;
+        int rate = host_rate();
+        return rate > 0 ? rate : 115200;
+    }
+
+    // 8N1: ten bit times per byte
+    static Clock::duration line_time(size_t bytes, int rate) {
+        return std::chrono::nanoseconds((uint64_t)bytes * 10u * 1000000000u / (uint64_t)rate);
+    }
+
+    bool chance(double rate) {
+        return rate > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < rate;
+    }
+
+    // Past its fastest clean rate the UART samples some bits wrong
+    void add_line_noise(uint8_t* data, size_t length, int rate) {
+        if (config_.max_baudrate <= 0 || rate <= config_.max_baudrate) {
+            return;
+        }
+        for (size_t i = 0; i < length; i++) {
+            if (chance(LINE_NOISE_RATE)) {
+                data[i] ^= (uint8_t)(1u << (rng_() % 8));
+            }
+        }
+    }
+
+    Clock::duration with_jitter(uint64_t microseconds) {
+        if (config_.jitter > 0) {
+            int percent = std::uniform_int_distribution<int>(-config_.jitter, config_.jitter)(rng_);
+            microseconds = microseconds * (uint64_t)(100 + percent) / 100u;
+        }
+        return std::chrono::microseconds(microseconds);
+    }
+
+    void transmit(const uint8_t* data, size_t length, int rate) {
+        if (chance(config_.drop_rate)) {
+            stats_.dropped++;
+            return;
+        }
+        std::this_thread::sleep_for(line_time(length, rate));
+        std::vector<uint8_t> noisy;
+        if (config_.max_baudrate > 0 && rate > config_.max_baudrate) {
+            noisy.assign(data, data + length);
+            add_line_noise(noisy.data(), length, rate);
+            data = noisy.data();
+        }
+        while (length > 0) {
+            ssize_t written = write(master_, data, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return; // Nobody listening; the host will retry
+            }
+            data += written;
+            length -= written;
+        }
+    }
+
+    void reply(uint8_t command, uint8_t sequence, const uint8_t* payload, size_t length, int rate) {
+        size_t packet = build_packet(command, sequence, payload, length, tx_packet_);
+        int encoded = pad_frame_encode(PAD_FRAME_HDLC, tx_packet_, packet,
+                                       tx_frame_.data(), tx_frame_.size());
+        if (encoded > 0) {
+            transmit(tx_frame_.data(), encoded, rate);
+        }
+    }
+
+    void nak(uint8_t sequence, uint8_t status, int rate) {
+        reply(NAK, sequence, &status, 1, rate);
+    }
+
+    bool in_flash(uint32_t address, uint32_t length) const {
+        return address <= flash_.size() && length <= flash_.size() - address;
+    }
+
+    // A complete frame has arrived (by rx_clock_): answer line-level problems
+    // at once and queue commands behind whatever the device is still doing
+    void handle_frame(uint8_t* data, size_t length, int rate) {
+        stats_.frames++;
+        if (chance(config_.corrupt_rate)) {
+            data[std::uniform_int_distribution<size_t>(0, length - 1)(rng_)] ^= 0x10;
+        }
+        if (dead_) {
+            return;
+        }
+
+        if (is_sync_frame(data, length)) {
+            stats_.syncs++;
+            std::this_thread::sleep_until(rx_clock_);
+            uint8_t flag = 0x7E;
+            transmit(&flag, 1, rate);
+            return;
+        }
+
+        Packet packet;
+        if (!parse_packet(data, length, &packet)) {
+            stats_.bad_frames++;
+            std::this_thread::sleep_until(rx_clock_);
+            nak(length >= HEADER_SIZE ? data[1] : 0, STATUS_BAD_CRC, rate);
+            return;
+        }
+
+        uint64_t work_us = 0;
+        switch (packet.command) {
+            case CMD_ERASE:
+                if (packet.length >= 8) {
+                    work_us = (uint64_t)(get_le32(packet.payload + 4) / config_.sector_size) *
+                              config_.erase_ms * 1000u;
+                }
+                break;
+            case CMD_WRITE:
+                work_us = (uint64_t)(packet.length - std::min<size_t>(packet.length, 4)) *
+                          config_.write_us / 1024u;
+                break;
+            case CMD_WRITE_BLOCK:
+                // Blocks beyond the advertised window have nowhere to go
+                if (queued_blocks_ >= config_.window) {
+                    stats_.overflows++;
+                    return;
+                }
+                queued_blocks_++;
+                work_us = (uint64_t)(packet.length -
+                                     std::min<size_t>(packet.length, BLOCK_HEADER_SIZE)) *
+                          config_.write_us / 1024u;
+                break;
+            case CMD_WRITE_BLOCK_LZ:
+                if (queued_blocks_ >= config_.window) {
+                    stats_.overflows++;
+                    return;
+                }
+                queued_blocks_++;
+                // Programming takes as long as for the expanded data
+                if (packet.length >= LZ_BLOCK_HEADER_SIZE) {
+                    work_us = (uint64_t)get_le16(packet.payload + 10) * config_.write_us / 1024u;
+                }
+                break;
+            case CMD_ERASE_BLOCK:
+                if (queued_blocks_ >= config_.window) {
+                    stats_.overflows++;
+                    return;
+                }
+                queued_blocks_++;
+                if (packet.length >= ERASE_BLOCK_SIZE) {
+                    work_us = (uint64_t)(get_le32(packet.payload + 6) / config_.sector_size) *
+                              config_.erase_ms * 1000u;
+                }
+                break;
+        }
+
+        busy_until_ = std::max(busy_until_, rx_clock_) + with_jitter(work_us);
+        operations_.push_back(Operation{busy_until_, std::vector<uint8_t>(data, data + length), rate});
+    }
+
+    void acknowledge_block(uint8_t command, uint8_t sequence, int rate) {
+        while (first_missing_ < blocks_done_.size() && blocks_done_[first_missing_]) {
+            first_missing_++;
+        }
+        uint32_t bitmap = 0;
+        for (unsigned bit = 0; bit < BLOCK_ACK_BITS; bit++) {
+            size_t block = first_missing_ + 1 + bit;
+            if (block < blocks_done_.size() && blocks_done_[block]) {
+                bitmap |= 1u << bit;
+            }
+        }
+        uint8_t ack[BLOCK_ACK_SIZE];
+        put_le16(ack, (uint16_t)first_missing_);
+        put_le32(ack + 2, bitmap);
+        reply(command, sequence, ack, sizeof(ack), rate);
+    }
+
+    // Program and check one block of a windowed transfer, then acknowledge it
+    void write_block(uint8_t command, uint8_t sequence, uint16_t block, uint32_t address,
+                     uint32_t block_crc, const uint8_t* data, uint32_t size, int rate) {
+        if (size > config_.max_block) {
+            return nak(sequence, STATUS_BAD_LENGTH, rate);
+        }
+        if (!in_flash(address, size)) {
+            return nak(sequence, STATUS_BAD_ADDRESS, rate);
+        }
+        if (block >= blocks_done_.size()) {
+            blocks_done_.resize(block + 1, false);
+        }
+        // A resent block that already made it is only acknowledged again
+        if (!blocks_done_[block]) {
+            program(address, data, size);
+            if (pad_crc32(flash_.data() + address, size) != block_crc) {
+                uint8_t failure[3] = {STATUS_VERIFY, 0, 0};
+                put_le16(failure + 1, block);
+                return reply(NAK, sequence, failure, sizeof(failure), rate);
+            }
+            blocks_done_[block] = true;
+        }
+        acknowledge_block(command, sequence, rate);
+    }
+
+    // The flash has finished everything queued before op: carry it out
+    void execute(const Operation& op) {
+        Packet packet;
+        if (!parse_packet(op.packet.data(), op.packet.size(), &packet)) {
+            return; // Checked when it was queued
+        }
+        const uint8_t* payload = packet.payload;
+        int rate = op.rate;
+        uint8_t answer[MAX_PAYLOAD];
+        uint8_t command = packet.command | REPLY;
+
+        switch (packet.command) {
+            case CMD_PING:
+                put_le32(answer, (uint32_t)flash_.size());
+                put_le32(answer + 4, config_.sector_size);
+                put_le32(answer + 8, config_.max_block);
+                put_le32(answer + 12, config_.window);
+                put_le32(answer + 16, FEATURE_ERASE_BLOCKS | FEATURE_LZ_BLOCKS);
+                reply(command, packet.sequence, answer, DEVICE_INFO_SIZE, rate);
+                return;
+
+            case CMD_ERASE: {
+                if (packet.length < 8) break;
+                uint32_t address = get_le32(payload);
+                uint32_t size = get_le32(payload + 4);
+                if (address % config_.sector_size || size % config_.sector_size) {
+                    return nak(packet.sequence, STATUS_BAD_LENGTH, rate);
+                }
+                if (!in_flash(address, size)) {
+                    return nak(packet.sequence, STATUS_BAD_ADDRESS, rate);
+                }
+                std::fill(flash_.begin() + address, flash_.begin() + address + size, 0xFF);
+                stats_.sectors_erased += size / config_.sector_size;
+                reply(command, packet.sequence, nullptr, 0, rate);
+                return;
+            }
+
+            case CMD_WRITE: {
+                if (packet.length < 4) break;
+                uint32_t address = get_le32(payload);
+                uint32_t size = (uint32_t)packet.length - 4;
+                if (size > config_.max_block) {
+                    return nak(packet.sequence, STATUS_BAD_LENGTH, rate);
+                }
+                if (!in_flash(address, size)) {
+                    return nak(packet.sequence, STATUS_BAD_ADDRESS, rate);
+                }
+                program(address, payload + 4, size);
+                reply(command, packet.sequence, nullptr, 0, rate);
+                return;
+            }
+
+            case CMD_BEGIN_BLOCKS:
+                blocks_done_.clear();
+                first_missing_ = 0;
+                reply(command, packet.sequence, nullptr, 0, rate);
+                return;
+
+            case CMD_WRITE_BLOCK: {
+                queued_blocks_--;
+                if (packet.length < BLOCK_HEADER_SIZE) break;
+                write_block(command, packet.sequence, get_le16(payload), get_le32(payload + 2),
+                            get_le32(payload + 6), payload + BLOCK_HEADER_SIZE,
+                            (uint32_t)(packet.length - BLOCK_HEADER_SIZE), rate);
+                return;
+            }
+
+            case CMD_WRITE_BLOCK_LZ: {
+                queued_blocks_--;
+                if (packet.length < LZ_BLOCK_HEADER_SIZE) break;
+                // Expand into a block buffer, as a bootloader would
+                uint16_t size = get_le16(payload + 10);
+                std::vector<uint8_t> data(config_.max_block);
+                size_t expanded = 0;
+                if (size > config_.max_block ||
+                    pad_lz_decompress(payload + LZ_BLOCK_HEADER_SIZE, packet.length - LZ_BLOCK_HEADER_SIZE,
+                                      data.data(), data.size(), &expanded) != 0 ||
+                    expanded != size) {
+                    return nak(packet.sequence, STATUS_BAD_LENGTH, rate);
+                }
+                write_block(command, packet.sequence, get_le16(payload), get_le32(payload + 2),
+                            get_le32(payload + 6), data.data(), size, rate);
+                return;
+            }
+
+            case CMD_ERASE_BLOCK: {
+                queued_blocks_--;
+                if (packet.length < ERASE_BLOCK_SIZE) break;
+                uint16_t block = get_le16(payload);
+                uint32_t address = get_le32(payload + 2);
+                uint32_t size = get_le32(payload + 6);
+                if (address % config_.sector_size || size % config_.sector_size) {
+                    return nak(packet.sequence, STATUS_BAD_LENGTH, rate);
+                }
+                if (!in_flash(address, size)) {
+                    return nak(packet.sequence, STATUS_BAD_ADDRESS, rate);
+                }
+                if (block >= blocks_done_.size()) {
+                    blocks_done_.resize(block + 1, false);
+                }
+                // Erasing again would wipe data programmed since
+                if (!blocks_done_[block]) {
+                    std::fill(flash_.begin() + address, flash_.begin() + address + size, 0xFF);
+                    stats_.sectors_erased += size / config_.sector_size;
+                    blocks_done_[block] = true;
+                }
+                acknowledge_block(command, packet.sequence, rate);
+                return;
+            }
+
+            case CMD_CRC: {
+                if (packet.length < 8) break;
+                uint32_t address = get_le32(payload);
+                uint32_t size = get_le32(payload + 4);
+                if (!in_flash(address, size)) {
+                    return nak(packet.sequence, STATUS_BAD_ADDRESS, rate);
+                }
+                put_le32(answer, pad_crc32(flash_.data() + address, size));
+                reply(command, packet.sequence, answer, 4, rate);
+                return;
+            }
+
+            case CMD_SECTOR_CRCS: {
+                if (packet.length < 8) break;
+                uint32_t address = get_le32(payload);
+                uint32_t count = get_le32(payload + 4);
+                if (count == 0 || count > MAX_SECTOR_CRCS) {
+                    return nak(packet.sequence, STATUS_BAD_LENGTH, rate);
+                }
+                uint64_t size = (uint64_t)count * config_.sector_size;
+                if (address % config_.sector_size != 0 || size > config_.flash_size ||
+                    !in_flash(address, (uint32_t)size)) {
+                    return nak(packet.sequence, STATUS_BAD_ADDRESS, rate);
+                }
+                for (uint32_t i = 0; i < count; i++) {
+                    const uint8_t* sector = flash_.data() + address + i * config_.sector_size;
+                    put_le32(answer + 4 * i, pad_crc32(sector, config_.sector_size));
+                }
+                reply(command, packet.sequence, answer, 4 * count, rate);
+                return;
+            }
+
+            case CMD_READ: {
+                if (packet.length < 8) break;
+                uint32_t address = get_le32(payload);
+                uint32_t size = get_le32(payload + 4);
+                if (size > config_.max_block) {
+                    return nak(packet.sequence, STATUS_BAD_LENGTH, rate);
+                }
+                if (!in_flash(address, size)) {
+                    return nak(packet.sequence, STATUS_BAD_ADDRESS, rate);
+                }
+                reply(command, packet.sequence, flash_.data() + address, size, rate);
+                return;
+            }
+
+            case CMD_SET_BAUD: {
+                if (packet.length < 4) break;
+                int requested = (int)get_le32(payload);
+                if (requested < MIN_BAUDRATE ||
+                    (config_.max_baudrate > 0 && requested > 2 * config_.max_baudrate)) {
+                    return nak(packet.sequence, STATUS_BAD_RATE, rate);
+                }
+                if (provisional_ && requested == rate_) {
+                    provisional_ = false;
+                    reply(command, packet.sequence, nullptr, 0, rate);
+                    return;
+                }
+                // Answer at the old rate, then switch
+                reply(command, packet.sequence, nullptr, 0, rate);
+                if (!provisional_) {
+                    fallback_rate_ = rate_;
+                }
+                rate_ = requested;
+                provisional_ = true;
+                confirm_by_ = Clock::now() + std::chrono::milliseconds(BAUD_CONFIRM_MS);
+                return;
+            }
+
+            case CMD_ECHO:
+                reply(command, packet.sequence, payload, packet.length, rate);
+                return;
+
+            case CMD_RESET:
+                stats_.resets++;
+                reply(command, packet.sequence, nullptr, 0, rate);
+                // The bootloader starts over at its power-on rate
+                rate_ = config_.baudrate;
+                provisional_ = false;
+                return;
+
+            default:
+                return nak(packet.sequence, STATUS_BAD_COMMAND, rate);
+        }
+        nak(packet.sequence, STATUS_BAD_LENGTH, rate);
+    }
+
+    // NOR flash can only clear bits
+    void program(uint32_t address, const uint8_t* data, uint32_t size) {
+        for (uint32_t i = 0; i < size; i++) {
+            flash_[address + i] &= data[i];
+        }
+        stats_.bytes_written += size;
+    }
+};
+
+static void print_usage() {
+    std::cout << "pad-devsim - simulated PAD bootloaders on pseudo-terminals\n";
+    std::cout << "Usage: pad-devsim [OPTIONS]\n";
+    std::cout << "Options:\n";
+    std::cout << "  -n, --devices N           Number of simulated devices (default: 4)\n";
+    std::cout << "  -l, --link-dir DIR        Also create DIR/ttyPAD0, DIR/ttyPAD1, ... links\n";
+    std::cout << "  -b, --baudrate RATE       Device line rate; a host at another rate sees\n";
+    std::cout << "                            garbage (default: follow the host's rate)\n";
+    std::cout << "  --max-baud RATE           Fastest rate without line errors; SET_BAUD\n";
+    std::cout << "                            refuses more than twice it (default: no limit)\n";
+    std::cout << "  --flash-size BYTES        Flash size (default: 1048576)\n";
+    std::cout << "  --sector-size BYTES       Erase sector size (default: 4096)\n";
+    std::cout << "  --block-size BYTES        Largest write/read block (default: 1024)\n";
+    std::cout << "  --window N                Blocks buffered in windowed transfers (default: 16)\n";
+    std::cout << "  --erase-ms MS             Erase time per sector (default: 20)\n";
+    std::cout << "  --write-us US             Program time per KB (default: 500)\n";
+    std::cout << "  --jitter PERCENT          Random +/- variation of flash timings\n";
+    std::cout << "  --corrupt RATE            Fraction of received frames corrupted (0-1)\n";
+    std::cout << "  --drop RATE               Fraction of replies lost (0-1)\n";
+    std::cout << "  --dead N                  The last N devices never answer\n";
+    std::cout << "  --image FILE              Initial flash contents (default: erased)\n";
+    std::cout << "  --dump-dir DIR            Save each device's flash on exit\n";
+    std::cout << "  --seed N                  Random seed (default: 1)\n";
+    std::cout << "  -h, --help                Show this help message\n";
+    std::cout << "\nRuns until interrupted, then prints per-device statistics.\n";
+}
+
+static bool parse_arguments(int argc, char* argv[], SimConfig& config) {
+    const struct option long_options[] = {
+        {"devices", required_argument, 0, 'n'},
+        {"link-dir", required_argument, 0, 'l'},
+        {"baudrate", required_argument, 0, 'b'},
+        {"flash-size", required_argument, 0, 1001},
+        {"sector-size", required_argument, 0, 1002},
+        {"block-size", required_argument, 0, 1003},
+        {"erase-ms", required_argument, 0, 1004},
+        {"write-us", required_argument, 0, 1005},
+        {"jitter", required_argument, 0, 1006},
+        {"corrupt", required_argument, 0, 1007},
+        {"drop", required_argument, 0, 1008},
+        {"dead", required_argument, 0, 1009},
+        {"image", required_argument, 0, 1010},
+        {"dump-dir", required_argument, 0, 1011},
+        {"seed", required_argument, 0, 1012},
+        {"window", required_argument, 0, 1013},
+        {"max-baud", required_argument, 0, 1014},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:l:b:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': config.devices = std::max(1, std::stoi(optarg)); break;
+            case 'l': config.link_dir = optarg; break;
+            case 'b': config.baudrate = std::max(0, std::stoi(optarg)); break;
+            case 1001: config.flash_size = (uint32_t)std::stoul(optarg); break;
+            case 1002: config.sector_size = (uint32_t)std::stoul(optarg); break;
+            case 1003: config.max_block = (uint32_t)std::stoul(optarg); break;
+            case 1004: config.erase_ms = std::max(0, std::stoi(optarg)); break;
+            case 1005: config.write_us = std::max(0, std::stoi(optarg)); break;
+            case 1006: config.jitter = std::min(100, std::max(0, std::stoi(optarg))); break;
+            case 1007: config.corrupt_rate = std::stod(optarg); break;
+            case 1008: config.drop_rate = std::stod(optarg); break;
+            case 1009: config.dead = std::max(0, std::stoi(optarg)); break;
+            case 1010: config.image_file = optarg; break;
+            case 1011: config.dump_dir = optarg; break;
+            case 1012: config.seed = (unsigned)std::stoul(optarg); break;
+            case 1013: config.window = (uint32_t)std::max(1, std::stoi(optarg)); break;
+            case 1014: config.max_baudrate = std::max(0, std::stoi(optarg)); break;
+            case 'h':
+            default:
+                print_usage();
+                return false;
+        }
+    }
+
+    if (config.sector_size == 0 || config.flash_size % config.sector_size != 0) {
+        std::cerr << "Error: --flash-size must be a multiple of --sector-size" << std::endl;
+        return false;
+    }
+    if (config.max_block == 0 || config.max_block > MAX_BLOCK) {
+        std::cerr << "Error: --block-size must be 1.." << MAX_BLOCK << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    SimConfig config;
+    if (!parse_arguments(argc, argv, config)) {
+        return 1;
+    }
+
+    std::vector<uint8_t> image;
+    if (!config.image_file.empty()) {
+        std::ifstream file(config.image_file, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open image file: " << config.image_file << std::endl;
+            return 1;
+        }
+        image.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::vector<std::unique_ptr<SimDevice>> devices;
+    std::vector<std::string> links;
+    std::string device_list;
+    for (int i = 0; i < config.devices; i++) {
+        devices.emplace_back(new SimDevice(config, i, image));
+        if (!devices.back()->open_pty()) {
+            std::cerr << "Error: Could not create PTY " << i << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+
+        std::string path = devices.back()->path();
+        if (!config.link_dir.empty()) {
+            std::string link = config.link_dir + "/ttyPAD" + std::to_string(i);
+            unlink(link.c_str());
+            if (symlink(path.c_str(), link.c_str()) != 0) {
+                std::cerr << "Error: Could not create " << link << ": " << strerror(errno) << std::endl;
+                return 1;
+            }
+            links.push_back(link);
+            path = link;
+        }
+        std::cout << "device " << i << ": " << path
+                  << (devices.back()->dead() ? " (dead)" : "") << std::endl;
+        device_list += (i ? "," : "") + path;
+    }
+    std::cout << "-D " << device_list << std::endl;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    std::vector<std::thread> threads;
+    for (auto& device : devices) {
+        threads.emplace_back([&device] { device->run(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::cout << "\n" << std::left << std::setw(6) << "device" << std::right
+              << std::setw(10) << "frames" << std::setw(10) << "bad"
+              << std::setw(10) << "dropped" << std::setw(12) << "written"
+              << std::setw(10) << "erased" << std::setw(8) << "syncs"
+              << std::setw(8) << "resets" << std::setw(10) << "overflow" << std::endl;
+    for (size_t i = 0; i < devices.size(); i++) {
+        const SimStats& stats = devices[i]->stats();
+        std::cout << std::left << std::setw(6) << i << std::right
+                  << std::setw(10) << stats.frames << std::setw(10) << stats.bad_frames
+                  << std::setw(10) << stats.dropped << std::setw(12) << stats.bytes_written
+                  << std::setw(10) << stats.sectors_erased << std::setw(8) << stats.syncs
+                  << std::setw(8) << stats.resets << std::setw(10) << stats.overflows << std::endl;
+
+        if (!config.dump_dir.empty()) {
+            std::string name = config.dump_dir + "/device" + std::to_string(i) + ".bin";
+            std::ofstream out(name, std::ios::binary);
+            out.write(reinterpret_cast<const char*>(devices[i]->flash().data()),
+                      devices[i]->flash().size());
+            if (!out) {
+                std::cerr << "Error: Could not write " << name << std::endl;
+            }
+        }
+    }
+
+    for (const auto& link : links) {
+        unlink(link.c_str());
+    }
+    return 0;
+}
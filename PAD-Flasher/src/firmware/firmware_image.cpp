@@ -0,0 +1,240 @@
+#include "firmware_image.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include "pad_common.h"
+#include "pad_lz.h"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Images at least this large are worth asking for huge pages: fewer TLB
+// misses while dozens of workers stream the same image
+static const size_t HUGEPAGE_MIN_SIZE = 2 * 1024 * 1024;
+
+#ifndef _WIN32
+static int64_t mtime_ns(const struct stat& st) {
+    return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+#endif
+
+// Read the whole file into buffer (Windows, and files that cannot be mapped)
+static bool read_file(const std::string& path, std::vector<uint8_t>& buffer, std::string* error) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        *error = strerror(errno);
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    buffer.resize((size_t)size);
+    if (size > 0 && !file.read(reinterpret_cast<char*>(buffer.data()), size)) {
+        *error = "read failed";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const FirmwareImage> FirmwareImage::open(const std::string& path,
+                                                          uint32_t binary_address,
+                                                          std::string* error) {
+    std::shared_ptr<FirmwareImage> image(new FirmwareImage());
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        *error = strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        *error = strerror(errno);
+        close(fd);
+        return nullptr;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size > 0 && S_ISREG(st.st_mode)) {
+        void* data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            // Each worker streams the image front to back; read ahead hard
+            madvise(data, size, MADV_SEQUENTIAL);
+            madvise(data, size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+            if (size >= HUGEPAGE_MIN_SIZE) {
+                madvise(data, size, MADV_HUGEPAGE); // A hint; may be unsupported
+            }
+#endif
+            image->mapping_ = static_cast<const uint8_t*>(data);
+            image->mapping_size_ = size;
+            image->mapped_fd_ = fd;
+            image->mapped_mtime_ns_ = mtime_ns(st);
+        }
+    }
+    if (image->mapped_fd_ < 0) {
+        close(fd);
+    }
+#endif
+
+    const uint8_t* contents = image->mapping_;
+    size_t contents_size = image->mapping_size_;
+    if (!contents) {
+        if (!read_file(path, image->buffer_, error)) {
+            return nullptr;
+        }
+        contents = image->buffer_.data();
+        contents_size = image->buffer_.size();
+    }
+
+    image->format_ = pad_firmware_detect(path.c_str(), contents, contents_size);
+    if (image->format_ == PAD_FIRMWARE_BINARY) {
+        // Flash straight from the file
+        if ((uint64_t)binary_address + contents_size > 0x100000000ull) {
+            *error = "image runs past the 4 GB address space";
+            return nullptr;
+        }
+        if (contents_size > 0) {
+            image->segments_.push_back({binary_address, (uint32_t)contents_size, contents, 0});
+        }
+    } else {
+        char detail[256];
+        image->parsed_.reset(pad_firmware_parse(contents, contents_size, path.c_str(), image->format_,
+                                                binary_address, detail, sizeof(detail)));
+        if (!image->parsed_) {
+            *error = detail;
+            return nullptr;
+        }
+        const pad_firmware_segment* segments = pad_firmware_segments(image->parsed_.get());
+        for (size_t i = 0; i < pad_firmware_segment_count(image->parsed_.get()); i++) {
+            image->segments_.push_back({segments[i].address, segments[i].length, segments[i].data, 0});
+        }
+        // The parsed copy is all that is needed from here on
+        image->release_file();
+    }
+    if (image->segments_.empty()) {
+        *error = "no data";
+        return nullptr;
+    }
+
+    for (Segment& segment : image->segments_) {
+        segment.crc = pad_crc32(segment.data, segment.size);
+        image->size_ += segment.size;
+    }
+    return image;
+}
+
+bool FirmwareImage::unchanged(std::string* error) const {
+#ifndef _WIN32
+    // Writing the file in place (cp, a build writing its output) changes
+    // the mapped pages; replacing it (mv, most editors) leaves them alone
+    struct stat st;
+    if (mapped_fd_ >= 0 && (fstat(mapped_fd_, &st) != 0 || (size_t)st.st_size != mapping_size_ ||
+                            mtime_ns(st) != mapped_mtime_ns_)) {
+        *error = "firmware file changed since it was loaded";
+        return false;
+    }
+#else
+    (void)error;
+#endif
+    return true;
+}
+
+void FirmwareImage::release_file() {
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(const_cast<uint8_t*>(mapping_), mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+    if (mapped_fd_ >= 0) {
+        close(mapped_fd_);
+        mapped_fd_ = -1;
+    }
+#endif
+    std::vector<uint8_t>().swap(buffer_);
+}
+
+FirmwareImage::~FirmwareImage() {
+    release_file();
+}
+
+const std::vector<uint32_t>& FirmwareImage::block_crcs(size_t segment, uint32_t block_size) const {
+    std::lock_guard<std::mutex> lock(crcs_mutex_);
+    auto& crcs = block_crcs_[std::make_pair(segment, block_size)];
+    if (!crcs) {
+        std::unique_ptr<std::vector<uint32_t>> computed(new std::vector<uint32_t>());
+        const Segment& source = segments_.at(segment);
+        if (block_size > 0) {
+            computed->reserve((source.size + block_size - 1) / block_size);
+            for (size_t offset = 0; offset < source.size; offset += block_size) {
+                size_t length = std::min<size_t>(block_size, source.size - offset);
+                computed->push_back(pad_crc32(source.data + offset, length));
+            }
+        }
+        crcs = std::move(computed);
+    }
+    return *crcs;
+}
+
+const FirmwareImage::PackedBlocks& FirmwareImage::packed_blocks(size_t segment,
+                                                                uint32_t block_size) const {
+    std::lock_guard<std::mutex> lock(crcs_mutex_);
+    auto& packed = packed_blocks_[std::make_pair(segment, block_size)];
+    if (!packed) {
+        std::unique_ptr<PackedBlocks> computed(new PackedBlocks());
+        const Segment& source = segments_.at(segment);
+        computed->offsets.push_back(0);
+        if (block_size > 0) {
+            std::vector<uint8_t> buffer(pad_lz_bound(block_size));
+            for (size_t offset = 0; offset < source.size; offset += block_size) {
+                size_t length = std::min<size_t>(block_size, source.size - offset);
+                size_t packed_length = length > 1
+                    ? pad_lz_compress(source.data + offset, length, buffer.data(), length - 1) : 0;
+                computed->data.insert(computed->data.end(), buffer.data(), buffer.data() + packed_length);
+                computed->offsets.push_back((uint32_t)computed->data.size());
+            }
+        }
+        computed->data.shrink_to_fit();
+        packed = std::move(computed);
+    }
+    return *packed;
+}
+
+const std::vector<FirmwareImage::Sector>& FirmwareImage::sector_crcs(uint32_t base,
+                                                                     uint32_t sector_size) const {
+    std::lock_guard<std::mutex> lock(crcs_mutex_);
+    auto& crcs = sector_crcs_[std::make_pair(base, sector_size)];
+    if (!crcs) {
+        std::unique_ptr<std::vector<Sector>> computed(new std::vector<Sector>());
+        std::vector<uint8_t> sector(sector_size);
+        uint64_t current = 0;           // Address of the sector being assembled
+        bool open = false;
+        for (const Segment& segment : segments_) {
+            uint64_t end = (uint64_t)segment.address + segment.size;
+            for (uint64_t address = segment.address; sector_size > 0 && address < end;) {
+                uint64_t start = base + (address - base) / sector_size * sector_size;
+                if (!open || start != current) {
+                    // Segments are sorted, so a sector once left is complete
+                    if (open) {
+                        computed->push_back({(uint32_t)current, pad_crc32(sector.data(), sector_size)});
+                    }
+                    std::fill(sector.begin(), sector.end(), 0xFF);
+                    current = start;
+                    open = true;
+                }
+                size_t length = (size_t)(std::min(end, start + sector_size) - address);
+                memcpy(sector.data() + (address - start), segment.data + (address - segment.address), length);
+                address += length;
+            }
+        }
+        if (open) {
+            computed->push_back({(uint32_t)current, pad_crc32(sector.data(), sector_size)});
+        }
+        crcs = std::move(computed);
+    }
+    return *crcs;
+}
@@ -0,0 +1,92 @@
+#ifndef FIRMWARE_IMAGE_H
+#define FIRMWARE_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "pad_firmware.h"
+
+// A firmware file, shared read-only by every flash worker. Raw binaries are
+// mapped rather than copied, so any number of parallel sessions cost one
+// image's worth of memory, and block CRCs are computed once per block size
+// instead of once per device. The file must not be written while it is
+// mapped: check unchanged() before each device.
+//
+// Intel HEX, S-record and ELF files are parsed (pad_firmware.h) into a
+// sparse list of segments; a raw binary is a single segment.
+class FirmwareImage {
+public:
+    struct Segment {
+        uint32_t address;
+        uint32_t size;
+        const uint8_t* data;
+        uint32_t crc;               // pad_crc32 of the segment
+    };
+    struct Sector {
+        uint32_t address;
+        uint32_t crc;
+    };
+    // pad_lz form of each block: data[offsets[i]] up to data[offsets[i + 1]],
+    // empty for blocks that do not shrink
+    struct PackedBlocks {
+        std::vector<uint8_t> data;
+        std::vector<uint32_t> offsets;
+    };
+
+private:
+    const uint8_t* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    int mapped_fd_ = -1;            // Kept open to notice writes to the file
+    int64_t mapped_mtime_ns_ = 0;
+    std::vector<uint8_t> buffer_;   // Contents when the file could not be mapped
+    std::unique_ptr<pad_firmware, void (*)(pad_firmware*)> parsed_{nullptr, pad_firmware_free};
+    pad_firmware_format format_ = PAD_FIRMWARE_BINARY;
+    std::vector<Segment> segments_;
+    size_t size_ = 0;
+
+    mutable std::mutex crcs_mutex_;
+    mutable std::map<std::pair<size_t, uint32_t>, std::unique_ptr<const std::vector<uint32_t>>> block_crcs_;
+    mutable std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<const std::vector<Sector>>> sector_crcs_;
+    mutable std::map<std::pair<size_t, uint32_t>, std::unique_ptr<const PackedBlocks>> packed_blocks_;
+
+    FirmwareImage() = default;
+    // Drop the file contents once everything has been copied out of them
+    void release_file();
+
+public:
+    // nullptr (with a reason in error) if the file cannot be read or parsed.
+    // A raw binary is placed at binary_address.
+    static std::shared_ptr<const FirmwareImage> open(const std::string& path, uint32_t binary_address,
+                                                     std::string* error);
+    ~FirmwareImage();
+    FirmwareImage(const FirmwareImage&) = delete;
+    FirmwareImage& operator=(const FirmwareImage&) = delete;
+
+    pad_firmware_format format() const { return format_; }
+    // Sorted by address, never empty
+    const std::vector<Segment>& segments() const { return segments_; }
+    // False (with a reason in error) if a mapped file was written or
+    // truncated since open: the mapping would show the new bytes, which no
+    // longer match the cached CRCs. Parsed and copied images never change.
+    bool unchanged(std::string* error) const;
+    // Bytes of data in all segments, not counting gaps
+    size_t size() const { return size_; }
+    // pad_crc32 of each block_size block of a segment, the last one possibly
+    // short. Computed on first use; the vector lives as long as the image.
+    const std::vector<uint32_t>& block_crcs(size_t segment, uint32_t block_size) const;
+    // pad_crc32 of each sector the image touches, sectors being sector_size
+    // apart from base, as flash holds them once flashed: image data with
+    // erased (0xFF) bytes around it. Cached like block_crcs.
+    const std::vector<Sector>& sector_crcs(uint32_t base, uint32_t sector_size) const;
+    // Each block_size block of a segment compressed with pad_lz, so the
+    // image is compressed once however many devices it goes to. Cached like
+    // block_crcs.
+    const PackedBlocks& packed_blocks(size_t segment, uint32_t block_size) const;
+};
+
+#endif // FIRMWARE_IMAGE_H
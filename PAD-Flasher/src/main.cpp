@@ -7,16 +7,124 @@
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "pad_json.h"
+#include "pad_trace.h"
+#include "firmware/firmware_image.h"
+#include "protocols/baud_negotiation.h"
+#include "protocols/bootloader_client.h"
+#include "protocols/uart.h"
 
 // Forward declarations for protocol handlers
-class UARTProtocol;
 class JTAGProtocol;
 class SWDProtocol;
 class SPIProtocol;
 
+// One device to flash, from the command line or a batch manifest
+struct BatchDevice {
+    std::string port;
+    int baudrate;
+    size_t index;       // Position in the batch, for the results report
+};
+
+// Steps of flashing one device
+enum class FlashStage { Connect, Erase, Write, Verify, Done };
+
+static const char* stage_name(FlashStage stage) {
+    switch (stage) {
+        case FlashStage::Connect: return "connect";
+        case FlashStage::Erase:   return "erase";
+        case FlashStage::Write:   return "write";
+        case FlashStage::Verify:  return "verify";
+        case FlashStage::Done:    return "done";
+    }
+    return "?";
+}
+
+// How one device fared, for the end-of-batch report
+struct FlashResult {
+    size_t index = 0;
+    std::string port;
+    bool ok = false;
+    bool retryable = true;      // False when another attempt cannot help
+    FlashStage stage = FlashStage::Connect; // Reached, or where it failed
+    int attempts = 0;
+    uint32_t written = 0;       // Bytes acknowledged, in segment order; a retry writes from here
+    int baudrate = 0;
+    double seconds = 0;
+    std::string error;
+    // Seconds per step in the last attempt. Comparing sectors counts as
+    // erasing; a pipelined erase is part of the write.
+    double connect_seconds = 0;
+    double erase_seconds = 0;
+    double write_seconds = 0;
+    double verify_seconds = 0;
+    bool pipelined = false;
+    const char* bound = "";     // What held the write up (TransferStats::bound)
+};
+
+// First retry waits this long; each further one twice as long, up to 8 s
+static const int RETRY_BACKOFF_MS = 500;
+static const int RETRY_BACKOFF_DOUBLINGS = 4;
+
+// Bounded hand-off from the batch manifest parser to the flash workers.
+// push() blocks while the queue is full, so a huge manifest is never
+// buffered ahead of the devices being flashed.
+class DeviceQueue {
+public:
+    explicit DeviceQueue(size_t capacity) : capacity_(capacity), closed_(false) {}
+    
+    void push(const BatchDevice& device) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return items_.size() < capacity_ || closed_; });
+        if (closed_) return;
+        items_.push_back(device);
+        not_empty_.notify_one();
+    }
+    
+    // Blocks until a device is available; false once closed and drained
+    bool pop(BatchDevice& device) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !items_.empty() || closed_; });
+        if (items_.empty()) return false;
+        device = items_.front();
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+    
+    // No more devices; queued ones are still handed out unless discard is set
+    void close(bool discard) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        if (discard) items_.clear();
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+    
+private:
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<BatchDevice> items_;
+    size_t capacity_;
+    bool closed_;
+};
+
 class PADFlasher {
 private:
     std::string firmware_file;
+    std::shared_ptr<const FirmwareImage> firmware; // Shared by all workers
+    uint32_t flash_base;       // Address of flash offset 0 in the image
+    bool delta;                // Rewrite only the sectors that differ
+    bool pipeline;             // Erase inside the windowed write, if the device can
+    bool compress;             // Send compressed blocks, if the device can expand them
     std::vector<std::string> device_ports;
     std::string protocol;
     int baudrate;
@@ -24,10 +132,43 @@ private:
     bool validate;
     bool recovery_mode;
     int parallel_devices;
+    bool parallel_from_cli;
+    int window;
+    int retries;
+    bool retries_from_cli;
+    bool negotiate_baud;
+    int max_baudrate;
+    bool low_latency;
+    std::string baud_cache_file;
+    std::unique_ptr<BaudRateCache> baud_cache;
+    std::string trace_file;
+    std::string batch_config;
+    bool batch_mode;
+    std::mutex output_mutex;
+    
+    // Batch manifest streaming state
+    bool in_devices;
+    bool in_recovery;
+    bool in_device;
+    BatchDevice pending_device;
+    bool workers_started;
+    size_t devices_queued;
+    std::unique_ptr<DeviceQueue> device_queue;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> devices_attempted;
+    std::atomic<size_t> devices_failed;
+    std::mutex results_mutex;
+    std::vector<FlashResult> results;
     
 public:
-    PADFlasher() : baudrate(115200), verbose(false), validate(true), 
-                   recovery_mode(false), parallel_devices(1) {}
+    PADFlasher() : flash_base(0), delta(false), pipeline(true), compress(false),
+                   baudrate(115200), verbose(false), validate(true), 
+                   recovery_mode(false), parallel_devices(1), parallel_from_cli(false), window(8),
+                   retries(2), retries_from_cli(false),
+                   negotiate_baud(true), max_baudrate(0), low_latency(false),
+                   batch_mode(false), in_devices(false), in_recovery(false), in_device(false),
+                   workers_started(false), devices_queued(0), devices_attempted(0),
+                   devices_failed(0) {}
     
     void print_usage() {
         std::cout << "PAD-Flasher v1.2.3 - Mass Firmware Flasher Utility\n";
@@ -35,15 +176,35 @@ public:
         std::cout << "Options:\n";
         std::cout << "  -d, --device PORT         Single device port (e.g., /dev/ttyUSB0)\n";
         std::cout << "  -D, --devices PORTS       Multiple device ports (comma-separated)\n";
-        std::cout << "  -f, --firmware FILE       Firmware file to flash\n";
+        std::cout << "  -f, --firmware FILE       Firmware file to flash: raw binary, Intel HEX,\n";
+        std::cout << "                            S-record or ELF. A raw binary is read in place:\n";
+        std::cout << "                            devices not yet flashed fail if it is rewritten\n";
+        std::cout << "  --flash-base ADDR         Address of the start of flash in the image; a raw\n";
+        std::cout << "                            binary starts here (default: 0)\n";
         std::cout << "  -p, --protocol PROTOCOL   Protocol: uart, jtag, swd, spi (default: uart)\n";
-        std::cout << "  -b, --baudrate RATE       Baud rate for UART (default: 115200)\n";
+        std::cout << "  -b, --baudrate RATE       Baud rate for UART (default: 115200); the UART\n";
+        std::cout << "                            bootloader then negotiates the fastest reliable rate\n";
+        std::cout << "  --fixed-baudrate          Stay at --baudrate, skip the negotiation\n";
+        std::cout << "  --max-baudrate RATE       Highest rate to negotiate (default: no limit)\n";
+        std::cout << "  --baud-cache FILE         Negotiated rates per adapter\n";
+        std::cout << "                            (default: ~/.cache/pad-flasher/baudrates)\n";
+        std::cout << "  --low-latency             Have the serial driver pass on received bytes\n";
+        std::cout << "                            at once instead of batching them (FTDI: 16 ms)\n";
         std::cout << "  -v, --verbose             Enable verbose output\n";
         std::cout << "  -s, --skip-validation     Skip post-flash validation\n";
+        std::cout << "  --delta                   Erase and write only the sectors whose CRC differs\n";
+        std::cout << "                            from the image (UART)\n";
         std::cout << "  -r, --recovery            Enable recovery mode\n";
         std::cout << "  -P, --parallel NUM        Number of parallel devices (default: 1)\n";
+        std::cout << "  --retries NUM             Retries per device, with backoff (default: 2)\n";
+        std::cout << "  -w, --window NUM          UART blocks in flight; 1 waits for each (default: 8)\n";
+        std::cout << "  --no-pipeline             Erase everything before writing, even if the\n";
+        std::cout << "                            device can erase during the transfer\n";
+        std::cout << "  --compress                Send blocks compressed, if the device can\n";
+        std::cout << "                            expand them (windowed UART)\n";
         std::cout << "  -c, --batch-config FILE   Batch configuration file\n";
         std::cout << "  -B, --batch-mode          Run in batch mode\n";
+        std::cout << "  --trace FILE              Write a Chrome/Perfetto trace of the run to FILE\n";
         std::cout << "  -V, --version             Show version information\n";
         std::cout << "  -h, --help                Show this help message\n";
         std::cout << "\nExamples:\n";
@@ -68,15 +229,26 @@ public:
             {"skip-validation", no_argument, 0, 's'},
             {"recovery", no_argument, 0, 'r'},
             {"parallel", required_argument, 0, 'P'},
+            {"window", required_argument, 0, 'w'},
             {"batch-config", required_argument, 0, 'c'},
             {"batch-mode", no_argument, 0, 'B'},
+            {"trace", required_argument, 0, 1001},
+            {"fixed-baudrate", no_argument, 0, 1002},
+            {"max-baudrate", required_argument, 0, 1003},
+            {"baud-cache", required_argument, 0, 1004},
+            {"retries", required_argument, 0, 1005},
+            {"flash-base", required_argument, 0, 1006},
+            {"delta", no_argument, 0, 1007},
+            {"no-pipeline", no_argument, 0, 1008},
+            {"compress", no_argument, 0, 1009},
+            {"low-latency", no_argument, 0, 1010},
             {"version", no_argument, 0, 'V'},
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
         };
         
         int opt;
-        while ((opt = getopt_long(argc, argv, "d:D:f:p:b:vVsrP:c:Bh", long_options, NULL)) != -1) {
+        while ((opt = getopt_long(argc, argv, "d:D:f:p:b:vVsrP:w:c:Bh", long_options, NULL)) != -1) {
             switch (opt) {
                 case 'd':
                     device_ports.push_back(optarg);
@@ -103,15 +275,49 @@ public:
                     recovery_mode = true;
                     break;
                 case 'P':
-                    parallel_devices = std::stoi(optarg);
+                    parallel_devices = std::max(1, std::stoi(optarg));
+                    parallel_from_cli = true;
+                    break;
+                case 'w':
+                    window = std::max(1, std::stoi(optarg));
                     break;
                 case 'c':
-                    // Handle batch config file
-                    std::cout << "Batch config file: " << optarg << std::endl;
+                    batch_config = optarg;
+                    break;
+                case 1001: // trace
+                    trace_file = optarg;
+                    break;
+                case 1002: // fixed-baudrate
+                    negotiate_baud = false;
+                    break;
+                case 1003: // max-baudrate
+                    max_baudrate = std::max(0, std::stoi(optarg));
+                    break;
+                case 1004: // baud-cache
+                    baud_cache_file = optarg;
+                    break;
+                case 1005: // retries
+                    retries = std::max(0, std::stoi(optarg));
+                    retries_from_cli = true;
+                    break;
+                case 1006: // flash-base
+                    flash_base = (uint32_t)std::stoul(optarg, nullptr, 0);
+                    break;
+                case 1007: // delta
+                    delta = true;
+                    break;
+                case 1008: // no-pipeline
+                    pipeline = false;
+                    break;
+                case 1009: // compress
+                    compress = true;
+                    break;
+                case 1010: // low-latency
+                    low_latency = true;
                     break;
                 case 'B':
-                    std::cout << "Running in batch mode..." << std::endl;
-                    return handle_batch_mode();
+                    batch_mode = true;
+                    break;
                 case 'V':
                     print_version();
                     return false;
@@ -124,6 +330,24 @@ public:
             }
         }
         
+        if (batch_mode && batch_config.empty() && device_ports.empty()) {
+            std::cerr << "Error: Batch mode needs --batch-config or a device list" << std::endl;
+            return false;
+        }
+        
+        // Normalize protocol name
+        if (protocol.empty()) {
+            protocol = batch_config.empty() ? "uart" : "";
+        } else {
+            // Convert to lowercase
+            std::transform(protocol.begin(), protocol.end(), protocol.begin(), ::tolower);
+        }
+        
+        // A batch manifest may supply the firmware and devices itself
+        if (!batch_config.empty()) {
+            return true;
+        }
+        
         // Validate required arguments
         if (firmware_file.empty()) {
             std::cerr << "Error: Firmware file is required (-f or --firmware)" << std::endl;
@@ -135,14 +359,6 @@ public:
             return false;
         }
         
-        // Normalize protocol name
-        if (protocol.empty()) {
-            protocol = "uart";
-        } else {
-            // Convert to lowercase
-            std::transform(protocol.begin(), protocol.end(), protocol.begin(), ::tolower);
-        }
-        
         return true;
     }
     
@@ -157,80 +373,727 @@ public:
         }
     }
     
+    // Stream the batch manifest: each device entry is handed to the flash
+    // workers as soon as it is parsed, while the rest of the file is read
     bool handle_batch_mode() {
-        std::cout << "Batch mode not implemented in this demo version." << std::endl;
-        std::cout << "This would normally read a configuration file and flash multiple devices." << std::endl;
+        PAD_TRACE_SPAN("batch_mode");
+        std::cout << "Running in batch mode: " << batch_config << std::endl;
+        
+        char error[256];
+        bool parsed = pad_json_parse_file(batch_config.c_str(), on_manifest_event, this,
+                                          error, sizeof(error)) == 0;
+        if (!parsed) {
+            report(std::string("Error: Batch config: ") + error, true);
+        }
+        
+        // Devices given on the command line still run without manifest entries
+        if (parsed && !workers_started && !start_batch_workers()) {
+            return false;
+        }
+        if (!workers_started) {
+            return false;
+        }
+        
+        // On a parse error, let running devices finish but start no more
+        finish_batch(!parsed);
+        print_results();
+        
+        size_t attempted = devices_attempted.load();
+        size_t failed = devices_failed.load();
+        std::cout << "Batch complete: " << attempted - failed << " of " << attempted
+                  << " devices flashed";
+        if (attempted < devices_queued) {
+            std::cout << ", " << devices_queued - attempted << " not started";
+        }
+        std::cout << (parsed ? "" : " (manifest incomplete)") << std::endl;
+        return parsed && failed == 0;
+    }
+    
+    static int on_manifest_event(void* user, pad_json_event event, const char* key,
+                                 const char* value, size_t, int depth) {
+        return static_cast<PADFlasher*>(user)->handle_manifest_event(event, key ? key : "",
+                                                                     value, depth);
+    }
+    
+    int handle_manifest_event(pad_json_event event, const std::string& key,
+                              const char* value, int depth) {
+        // Top-level settings; command-line values take precedence
+        if (depth == 1) {
+            if (event == PAD_JSON_OBJECT_END || event == PAD_JSON_ARRAY_END) {
+                in_recovery = false;
+                in_devices = false;
+            } else if (event == PAD_JSON_ARRAY_BEGIN && key == "devices") {
+                in_devices = true;
+            } else if (workers_started) {
+                // Workers already read the settings; changing them now would race
+                report("Warning: Ignoring \"" + key + "\" after \"devices\" in batch config", true);
+            } else if (event == PAD_JSON_STRING && key == "firmware_file" && firmware_file.empty()) {
+                firmware_file = value;
+            } else if (event == PAD_JSON_STRING && key == "protocol" && protocol.empty()) {
+                protocol = value;
+            } else if (event == PAD_JSON_STRING && key == "batch_id") {
+                std::cout << "Batch ID: " << value << std::endl;
+            } else if (event == PAD_JSON_NUMBER && key == "parallel_devices" && !parallel_from_cli) {
+                parallel_devices = std::max(1, std::atoi(value));
+            } else if (event == PAD_JSON_FALSE && key == "validation_enabled") {
+                validate = false;
+            } else if (event == PAD_JSON_TRUE && key == "recovery_mode") {
+                recovery_mode = true;
+            } else if (event == PAD_JSON_OBJECT_BEGIN && key == "recovery_mode") {
+                in_recovery = true;
+            }
+            return 0;
+        }
+        
+        if (depth == 2 && in_recovery) {
+            if (event == PAD_JSON_TRUE && key == "enabled") {
+                recovery_mode = true;
+            } else if (event == PAD_JSON_NUMBER && key == "max_retries" && !retries_from_cli) {
+                retries = std::max(0, std::atoi(value));
+            }
+        } else if (depth == 2 && in_devices) {
+            if (event == PAD_JSON_OBJECT_BEGIN) {
+                pending_device.port.clear();
+                pending_device.baudrate = baudrate;
+                in_device = true;
+            } else if (event == PAD_JSON_OBJECT_END) {
+                in_device = false;
+                if (pending_device.port.empty()) {
+                    report("Warning: Skipping device entry without a port", true);
+                    return 0;
+                }
+                return queue_device(pending_device) ? 0 : 1;
+            } else if (event == PAD_JSON_STRING) {
+                // Shorthand: "devices": ["/dev/ttyUSB0", ...]
+                return queue_device(BatchDevice{value, baudrate, 0}) ? 0 : 1;
+            }
+        } else if (depth == 3 && in_device) {
+            if (event == PAD_JSON_STRING && key == "port") {
+                pending_device.port = value;
+            } else if (event == PAD_JSON_NUMBER && key == "baudrate") {
+                pending_device.baudrate = std::atoi(value);
+            }
+        }
+        return 0;
+    }
+    
+    bool queue_device(BatchDevice device) {
+        if (!workers_started && !start_batch_workers()) {
+            return false;
+        }
+        device.index = devices_queued++;
+        device_queue->push(device);
         return true;
     }
     
-    bool load_firmware() {
-        std::ifstream file(firmware_file, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open firmware file: " << firmware_file << std::endl;
+    // Called when the first device is parsed: settings that precede the
+    // devices array in the manifest are final from here on
+    bool start_batch_workers() {
+        if (firmware_file.empty()) {
+            std::cerr << "Error: Firmware file is required (-f or \"firmware_file\" before \"devices\")" << std::endl;
             return false;
         }
+        if (protocol.empty()) {
+            protocol = "uart";
+        }
+        std::transform(protocol.begin(), protocol.end(), protocol.begin(), ::tolower);
+        if (!load_firmware()) {
+            return false;
+        }
+        
+        // Without a manifest the device count is known: no idle workers
+        int worker_count = parallel_devices;
+        if (batch_config.empty()) {
+            worker_count = std::max(1, std::min(worker_count, (int)device_ports.size()));
+        }
+        
+        std::cout << "Starting flash operation with protocol: " << protocol << std::endl;
+        std::cout << "Parallel operations: " << worker_count << std::endl;
+        
+        device_queue.reset(new DeviceQueue((size_t)worker_count * 2));
+        for (int i = 0; i < worker_count; i++) {
+            workers.emplace_back([this] { batch_worker(); });
+        }
+        workers_started = true;
+        
+        for (const auto& port : device_ports) {
+            device_queue->push(BatchDevice{port, baudrate, devices_queued++});
+        }
+        return true;
+    }
+    
+    // Wait for the workers; with discard set, queued devices are not started
+    void finish_batch(bool discard) {
+        device_queue->close(discard);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+    
+    // One line per device, in batch order
+    void print_results() {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        std::sort(results.begin(), results.end(),
+                  [](const FlashResult& a, const FlashResult& b) { return a.index < b.index; });
+        
+        size_t width = 4;
+        for (const auto& result : results) {
+            width = std::max(width, result.port.size());
+        }
+        std::cout << "\nResults:\n" << std::left << std::setw((int)width + 2) << "port"
+                  << std::setw(8) << "result" << std::setw(9) << "stage" << std::setw(7) << "tries"
+                  << std::setw(10) << "baud" << std::setw(9) << "time" << "error" << std::endl;
+        for (const auto& result : results) {
+            std::ostringstream seconds;
+            seconds << std::fixed << std::setprecision(2) << result.seconds << " s";
+            std::cout << std::setw((int)width + 2) << result.port
+                      << std::setw(8) << (result.ok ? "OK" : "FAILED")
+                      << std::setw(9) << stage_name(result.stage)
+                      << std::setw(7) << result.attempts
+                      << std::setw(10) << result.baudrate
+                      << std::setw(9) << seconds.str()
+                      << result.error << std::endl;
+        }
         
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
+        // Which step bounds each device: with a pipelined erase, the erase
+        // shows up in the write time and as "erase" in the bound column
+        bool timed = false;
+        for (const auto& result : results) {
+            timed = timed || result.write_seconds > 0;
+        }
+        if (timed) {
+            std::cout << "\nStep times (s):\n" << std::setw((int)width + 2) << "port"
+                      << std::setw(9) << "connect" << std::setw(9) << "erase" << std::setw(9) << "write"
+                      << std::setw(9) << "verify" << "bound" << std::endl;
+            std::cout << std::fixed << std::setprecision(2);
+            for (const auto& result : results) {
+                std::cout << std::setw((int)width + 2) << result.port
+                          << std::setw(9) << result.connect_seconds << std::setw(9) << result.erase_seconds
+                          << std::setw(9) << result.write_seconds << std::setw(9) << result.verify_seconds
+                          << result.bound << (result.pipelined ? " (pipelined)" : "") << std::endl;
+            }
+            std::cout.unsetf(std::ios::floatfield);
+            std::cout << std::setprecision(6);
+        }
+        std::cout << std::right;
+    }
+    
+    void batch_worker() {
+        pad_trace_set_thread_name("flash_worker");
+        BatchDevice device;
+        while (device_queue->pop(device)) {
+            devices_attempted++;
+            if (!flash_device(device)) {
+                devices_failed++;
+            }
+        }
+    }
+    
+    // Print one whole line; workers flash devices concurrently
+    void report(const std::string& line, bool error = false) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        (error ? std::cerr : std::cout) << line << std::endl;
+    }
+    
+    bool load_firmware() {
+        PAD_TRACE_SPAN("load_firmware");
+        std::string error;
+        firmware = FirmwareImage::open(firmware_file, flash_base, &error);
+        if (!firmware) {
+            std::cerr << "Error: Could not read firmware file: " << firmware_file << " ("
+                      << error << ")" << std::endl;
+            return false;
+        }
         
-        std::cout << "Loaded firmware: " << firmware_file << " (" << size << " bytes)" << std::endl;
+        const auto& segments = firmware->segments();
+        std::cout << "Loaded firmware: " << firmware_file << " (" << firmware->size() << " bytes, "
+                  << pad_firmware_format_name(firmware->format());
+        if (segments.size() > 1) {
+            std::cout << ", " << segments.size() << " segments";
+        }
+        std::cout << ")" << std::endl;
+        if (verbose || segments.size() > 1) {
+            for (const auto& segment : segments) {
+                std::cout << "  0x" << std::hex << std::setw(8) << std::setfill('0') << segment.address
+                          << std::dec << std::setfill(' ') << "  " << segment.size << " bytes" << std::endl;
+            }
+        }
+        if (segments.front().address < flash_base) {
+            std::cerr << "Error: Firmware data at 0x" << std::hex << segments.front().address
+                      << " lies below the flash base 0x" << flash_base << std::dec
+                      << " (set --flash-base)" << std::endl;
+            return false;
+        }
         
         return true;
     }
     
-    bool flash_device(const std::string& port) {
-        std::cout << "Attempting to flash device on port: " << port << std::endl;
+    // Flash one device, retrying with backoff. Failures stay with the
+    // device; the other workers carry on.
+    bool flash_device(const BatchDevice& device) {
+        PAD_TRACE_SPAN("flash_device");
+        const std::string prefix = "  [" + device.port + "] ";
+        report("Attempting to flash device on port: " + device.port);
+        if (protocol == "uart" && verbose) {
+            report(prefix + "Baud rate: " + std::to_string(device.baudrate));
+        }
+        
+        FlashResult result;
+        result.index = device.index;
+        result.port = device.port;
+        result.baudrate = device.baudrate;
+        auto started = std::chrono::steady_clock::now();
+        
+        FlashStage resume = FlashStage::Connect;
+        for (int attempt = 0; attempt <= retries; attempt++) {
+            if (attempt > 0) {
+                int delay_ms = RETRY_BACKOFF_MS << std::min(attempt - 1, RETRY_BACKOFF_DOUBLINGS);
+                report(prefix + "Retrying from " + stage_name(resume) + " in " +
+                       std::to_string(delay_ms) + " ms (attempt " + std::to_string(attempt + 1) +
+                       " of " + std::to_string(retries + 1) + ")");
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+            }
+            result.attempts++;
+            result.ok = protocol == "uart" ? flash_uart(device, resume, result)
+                                           : flash_simulated(device.port, result);
+            if (result.ok) {
+                result.error.clear();
+                break;
+            }
+            if (!result.retryable) {
+                break;
+            }
+            // Writing the same data again is harmless, but a failed verify
+            // means the flash holds something else: erase it again. Steps
+            // already done stay done when a retry fails to connect.
+            if (result.stage == FlashStage::Verify) {
+                resume = FlashStage::Erase;
+            } else {
+                resume = std::max(resume, result.stage);
+            }
+        }
+        
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2);
+        if (result.ok) {
+            line << "  Device on " << device.port << " flashed successfully! (" << result.seconds << " s)";
+        } else {
+            line << "Failed to flash device on port: " << device.port << " (" << result.error << ")";
+        }
+        report(line.str(), !result.ok);
+        
+        std::lock_guard<std::mutex> lock(results_mutex);
+        results.push_back(result);
+        return result.ok;
+    }
+    
+    bool flash_simulated(const std::string& port, FlashResult& result) {
+        const std::string prefix = "  [" + port + "] ";
         
         // Simulate connection
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
         
         if (recovery_mode) {
-            std::cout << "  Recovery mode enabled" << std::endl;
+            report(prefix + "Recovery mode enabled");
         }
         
         // Simulate flashing process
-        std::cout << "  Connecting..." << std::flush;
+        pad_trace_begin("connect");
+        result.stage = FlashStage::Connect;
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        std::cout << " Connected!" << std::endl;
+        report(prefix + "Connecting... Connected!");
+        pad_trace_end("connect");
         
-        std::cout << "  Erasing flash..." << std::flush;
+        pad_trace_begin("erase");
+        result.stage = FlashStage::Erase;
         std::this_thread::sleep_for(std::chrono::milliseconds(800));
-        std::cout << " Done!" << std::endl;
+        report(prefix + "Erasing flash... Done!");
+        pad_trace_end("erase");
         
-        std::cout << "  Writing firmware..." << std::flush;
+        pad_trace_begin("write");
+        result.stage = FlashStage::Write;
         std::this_thread::sleep_for(std::chrono::milliseconds(1500));
-        std::cout << " Done!" << std::endl;
+        report(prefix + "Writing firmware... Done!");
+        pad_trace_end("write");
         
         if (validate) {
-            std::cout << "  Validating..." << std::flush;
+            PAD_TRACE_SPAN("validate");
+            result.stage = FlashStage::Verify;
             std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            std::cout << " OK!" << std::endl;
+            report(prefix + "Validating... OK!");
         }
         
-        std::cout << "  Device on " << port << " flashed successfully!" << std::endl;
+        result.stage = FlashStage::Done;
         return true;
     }
     
-    bool run() {
-        if (!load_firmware()) {
+    // Flash through the UART bootloader: sync, erase, write, verify, reset.
+    // Starts at resume, except that every attempt connects afresh.
+    bool flash_uart(const BatchDevice& device, FlashStage resume, FlashResult& result) {
+        const std::string& port = device.port;
+        const std::string prefix = "  [" + port + "] ";
+        auto fail = [&](const std::string& line, const std::string& error) {
+            report(prefix + line, true);
+            result.error = error;
             return false;
+        };
+        
+        // The CRCs were computed from the file as it was loaded
+        std::string changed;
+        if (!firmware->unchanged(&changed)) {
+            result.retryable = false;
+            return fail("Checking firmware... " + changed + "; run again to flash the new one", changed);
         }
         
-        std::cout << "Starting flash operation with protocol: " << protocol << std::endl;
-        std::cout << "Number of devices: " << device_ports.size() << std::endl;
-        std::cout << "Parallel operations: " << std::min(parallel_devices, (int)device_ports.size()) << std::endl;
+        UARTProtocol uart(port, device.baudrate);
+        uart.set_verbose(verbose);
+        uart.set_low_latency(low_latency);
+        BootloaderClient bootloader(uart);
+        bootloader::DeviceInfo info;
         
-        // Process devices sequentially or in parallel based on settings
-        for (const auto& port : device_ports) {
-            if (!flash_device(port)) {
-                std::cerr << "Failed to flash device on port: " << port << std::endl;
+        // Seconds since the last call, for the per-step times
+        auto step_started = std::chrono::steady_clock::now();
+        auto lap = [&]() {
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(now - step_started).count();
+            step_started = now;
+            return seconds;
+        };
+        result.connect_seconds = result.erase_seconds = 0;
+        result.write_seconds = result.verify_seconds = 0;
+        result.pipelined = false;
+        result.bound = "";
+        
+        pad_trace_begin("connect");
+        result.stage = FlashStage::Connect;
+        bool connected = uart.connect();
+        for (int attempt = 0; connected && attempt < 3; attempt++) {
+            if (uart.sync_connection()) break;
+            if (attempt == 2) connected = false;
+        }
+        connected = connected && bootloader.ping(&info);
+        pad_trace_end("connect");
+        if (!connected) {
+            std::string error = "no response from bootloader";
+            if (!bootloader.error().empty()) error += " (" + bootloader.error() + ")";
+            return fail("Connecting... " + error, error);
+        }
+        report(prefix + "Connecting... Connected!");
+        
+        if (negotiate_baud && !negotiate_baudrate(prefix, port, bootloader, uart)) {
+            result.error = "baud rate negotiation failed";
+            return false;
+        }
+        result.baudrate = uart.baudrate();
+        result.connect_seconds = lap();
+        
+        // Segments at their flash offsets; only the sectors they touch are
+        // erased and only their bytes written, so gaps cost nothing
+        const FirmwareImage& image = *firmware;
+        const auto& segments = image.segments();
+        uint64_t image_end = (uint64_t)segments.back().address + segments.back().size - flash_base;
+        if (image_end > info.flash_size) {
+            result.retryable = false;
+            return fail("Firmware (ending at offset " + std::to_string(image_end) + ") does not fit in " +
+                        std::to_string(info.flash_size) + " bytes of flash" +
+                        (segments.front().address - flash_base >= info.flash_size
+                             ? " (is --flash-base set?)" : ""), "firmware too large");
+        }
+        uint32_t sector = info.sector_size ? info.sector_size : 1;
+        uint32_t block = (uint32_t)std::min<size_t>(info.max_block, bootloader::MAX_BLOCK);
+        
+        // Erase each sector while the line carries the data for the one
+        // before, if the device takes erases in windowed transfers
+        unsigned in_flight = std::min((unsigned)window, info.window);
+        bool pipelined = pipeline && in_flight > 1 && (info.features & bootloader::FEATURE_ERASE_BLOCKS);
+        // Compressed blocks go in windowed transfers, to devices that expand them
+        bool compressed = compress && in_flight > 1 && (info.features & bootloader::FEATURE_LZ_BLOCKS);
+        if (compress && !compressed) {
+            report(prefix + "Device does not take compressed blocks, sending them as they are");
+        }
+        bootloader.set_compression(compressed);
+        
+        // Sector-aligned flash ranges to erase and program, merged where
+        // sectors adjoin
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        auto add_range = [&](uint32_t start, uint32_t end) {
+            if (!ranges.empty() && start <= ranges.back().second) {
+                ranges.back().second = std::max(ranges.back().second, end);
+            } else {
+                ranges.emplace_back(start, end);
+            }
+        };
+        // A pipelined attempt that failed part way has erased and written
+        // sectors in step: compare to carry on with the unfinished ones
+        if (delta || (pipelined && resume > FlashStage::Erase)) {
+            // Only sectors whose contents differ from the image. Every attempt
+            // compares afresh, so a retry redoes exactly the unfinished sectors.
+            pad_trace_begin("compare");
+            result.stage = FlashStage::Erase;
+            result.written = 0;
+            resume = FlashStage::Erase;
+            size_t changed = 0;
+            bool compared = find_changed_sectors(bootloader, sector, add_range, &changed);
+            pad_trace_end("compare");
+            if (!compared) {
+                return fail("Comparing flash... failed: " + bootloader.error(), "compare: " + bootloader.error());
+            }
+            report(prefix + "Comparing flash... " + std::to_string(changed) + " of " +
+                   std::to_string(image.sector_crcs(flash_base, sector).size()) + " sectors differ");
+        } else {
+            for (const auto& segment : segments) {
+                uint32_t start = (segment.address - flash_base) / sector * sector;
+                add_range(start, (uint32_t)(((uint64_t)segment.address - flash_base + segment.size +
+                                             sector - 1) / sector * sector));
+            }
+        }
+        
+        // The image bytes inside the ranges, in address order
+        struct Piece {
+            size_t segment;
+            uint32_t offset;             // Into the segment
+            uint32_t size;
+        };
+        std::vector<Piece> pieces;
+        for (size_t i = 0; i < segments.size(); i++) {
+            uint64_t start = segments[i].address - flash_base;
+            uint64_t end = start + segments[i].size;
+            for (const auto& range : ranges) {
+                uint64_t from = std::max<uint64_t>(start, range.first);
+                uint64_t to = std::min<uint64_t>(end, range.second);
+                if (from < to) {
+                    pieces.push_back({i, (uint32_t)(from - start), (uint32_t)(to - from)});
+                }
+            }
+        }
+        // Part of a segment to write, with its cached block CRCs and
+        // compressed blocks if the blocks from offset line up with them
+        auto make_span = [&](size_t segment, uint32_t offset, uint32_t end) {
+            const auto& source = segments[segment];
+            BootloaderClient::Span span;
+            span.address = source.address - flash_base + offset;
+            span.data = source.data + offset;
+            span.length = end - offset;
+            if (offset % block == 0 && (end == source.size || (end - offset) % block == 0)) {
+                span.block_crcs = image.block_crcs(segment, block).data() + offset / block;
+                if (compressed) {
+                    const auto& packed = image.packed_blocks(segment, block);
+                    span.packed_data = packed.data.data();
+                    span.packed_offsets = packed.offsets.data() + offset / block;
+                }
+            }
+            return span;
+        };
+        // How much smaller compression made the data, for the reports
+        auto ratio = [&](const TransferStats& stats) -> std::string {
+            if (!compressed || stats.data_bytes == 0) return "";
+            return ", compressed to " + std::to_string(stats.wire_bytes * 100 / stats.data_bytes) + "%";
+        };
+        result.erase_seconds = lap();
+        
+        TransferStats stats;
+        if (pipelined) {
+            pad_trace_begin("erase_write");
+            result.stage = FlashStage::Write;
+            result.pipelined = true;
+            std::vector<BootloaderClient::Span> spans;
+            for (const Piece& piece : pieces) {
+                spans.push_back(make_span(piece.segment, piece.offset, piece.offset + piece.size));
+            }
+            bool flashed = bootloader.flash_windowed(ranges, spans, sector, block, in_flight, &stats);
+            pad_trace_end("erase_write");
+            result.write_seconds = lap();
+            result.bound = stats.bound();
+            if (!flashed) {
+                return fail("Erasing and writing firmware... failed: " + bootloader.error(),
+                            "write: " + bootloader.error());
+            }
+            report(prefix + "Erasing and writing firmware... Done! (" + std::to_string(stats.erases) +
+                   " sectors, bound by " + result.bound + ratio(stats) + ")");
+        } else {
+            if (resume <= FlashStage::Erase) {
+                pad_trace_begin("erase");
+                result.stage = FlashStage::Erase;
+                result.written = 0;
+                for (const auto& range : ranges) {
+                    if (!bootloader.erase(range.first, range.second - range.first)) {
+                        pad_trace_end("erase");
+                        return fail("Erasing flash... failed: " + bootloader.error(), "erase: " + bootloader.error());
+                    }
+                }
+                pad_trace_end("erase");
+                result.erase_seconds += lap();
+                report(prefix + "Erasing flash... Done!");
+            }
+            
+            // Keep the line busy while the device programs, if it can buffer blocks.
+            // result.written counts bytes through the pieces in order.
+            pad_trace_begin("write");
+            result.stage = FlashStage::Write;
+            size_t done = 0;                 // Bytes in the pieces before this one
+            for (const Piece& piece : pieces) {
+                const auto& segment = segments[piece.segment];
+                if (result.written >= done + piece.size) {
+                    done += piece.size;
+                    continue;
+                }
+                uint32_t offset = piece.offset + (uint32_t)(result.written - done);
+                uint32_t end = piece.offset + piece.size;
+                uint32_t address = segment.address - flash_base + offset;
+                if (in_flight > 1) {
+                    uint32_t written = 0;
+                    if (!bootloader.write_windowed(make_span(piece.segment, offset, end), block, in_flight,
+                                                   &stats, &written)) {
+                        // A retry picks up after the acknowledged blocks
+                        result.written += written;
+                        pad_trace_end("write");
+                        return fail("Writing firmware... failed: " + bootloader.error(), "write: " + bootloader.error());
+                    }
+                } else {
+                    for (; offset < end; offset += block, address += block) {
+                        uint32_t length = std::min(block, end - offset);
+                        if (!bootloader.write(address, segment.data + offset, length)) {
+                            pad_trace_end("write");
+                            return fail("Writing firmware... failed at offset " + std::to_string(address) +
+                                        ": " + bootloader.error(), "write: " + bootloader.error());
+                        }
+                        result.written = (uint32_t)(done + offset + length - piece.offset);
+                    }
+                }
+                done += piece.size;
+                result.written = (uint32_t)done;
+            }
+            pad_trace_end("write");
+            result.write_seconds = lap();
+            result.bound = in_flight > 1 ? stats.bound() : "";
+            std::string compression = ratio(stats);
+            report(prefix + "Writing firmware... Done!" +
+                   (compression.empty() ? "" : " (" + compression.substr(2) + ")"));
+        }
+        
+        if (validate) {
+            PAD_TRACE_SPAN("validate");
+            result.stage = FlashStage::Verify;
+            for (const auto& segment : segments) {
+                uint32_t device_crc = 0;
+                if (!bootloader.crc(segment.address - flash_base, segment.size, &device_crc)) {
+                    return fail("Validating... failed: " + bootloader.error(), "verify: " + bootloader.error());
+                }
+                if (device_crc != segment.crc) {
+                    return fail("Validating... CRC mismatch!", "verify: CRC mismatch");
+                }
+            }
+            report(prefix + "Validating... OK!");
+            result.verify_seconds = lap();
+        }
+        
+        bootloader.reset();
+        uart.disconnect();
+        result.stage = FlashStage::Done;
+        return true;
+    }
+    
+    // Read back the CRC of every sector the image touches and pass the
+    // sectors that differ from it to add_range, in address order
+    template <typename AddRange>
+    bool find_changed_sectors(BootloaderClient& bootloader, uint32_t sector, AddRange add_range,
+                              size_t* changed) {
+        const auto& expected = firmware->sector_crcs(flash_base, sector);
+        std::vector<uint32_t> device_crcs(bootloader::MAX_SECTOR_CRCS);
+        *changed = 0;
+        for (size_t first = 0; first < expected.size();) {
+            // A run of consecutive sectors, one request's worth
+            size_t last = first + 1;
+            while (last < expected.size() && last - first < bootloader::MAX_SECTOR_CRCS &&
+                   expected[last].address == expected[last - 1].address + sector) {
+                last++;
+            }
+            if (!bootloader.sector_crcs(expected[first].address - flash_base, sector,
+                                        (uint32_t)(last - first), device_crcs.data())) {
                 return false;
             }
+            for (size_t i = first; i < last; i++) {
+                if (device_crcs[i - first] != expected[i].crc) {
+                    uint32_t start = expected[i].address - flash_base;
+                    add_range(start, start + sector);
+                    (*changed)++;
+                }
+            }
+            first = last;
         }
+        return true;
+    }
+    
+    // Step the line up to the fastest rate the device, adapter and cable
+    // handle, starting from the one remembered for this adapter
+    bool negotiate_baudrate(const std::string& prefix, const std::string& port,
+                            BootloaderClient& bootloader, UARTProtocol& uart) {
+        PAD_TRACE_SPAN("negotiate_baud");
+        std::string adapter = BaudRateCache::adapter_key(port);
+        int cached = baud_cache->lookup(adapter);
         
-        std::cout << "All devices flashed successfully!" << std::endl;
+        BaudNegotiator negotiator(bootloader, uart, max_baudrate);
+        negotiator.set_verbose(verbose);
+        int rate = negotiator.negotiate(cached);
+        if (rate == 0) {
+            report(prefix + "Negotiating baud rate... failed: " + negotiator.error(), true);
+            return false;
+        }
+        if (rate != cached) {
+            baud_cache->store(adapter, rate);
+        }
+        report(prefix + "Negotiating baud rate... " + std::to_string(rate) + " baud" +
+               (rate == cached ? " (cached)" : ""));
         return true;
     }
+    
+    bool run() {
+        baud_cache.reset(new BaudRateCache(baud_cache_file.empty() ? BaudRateCache::default_path()
+                                                                   : baud_cache_file));
+        if (!trace_file.empty()) {
+            pad_trace_init(0);
+            pad_trace_set_thread_name("main");
+        }
+        
+        bool ok = batch_config.empty() ? run_batch() : handle_batch_mode();
+        
+        if (!trace_file.empty()) {
+            if (pad_trace_dump_json(trace_file.c_str()) == 0) {
+                std::cout << "Trace written to " << trace_file << std::endl;
+            } else {
+                std::cerr << "Error: Could not write trace file: " << trace_file << std::endl;
+            }
+            pad_trace_shutdown();
+        }
+        return ok;
+    }
+    
+    // Devices from the command line, flashed by the same bounded worker
+    // pool as a manifest; one failing device does not stop the rest
+    bool run_batch() {
+        std::cout << "Number of devices: " << device_ports.size() << std::endl;
+        auto started = std::chrono::steady_clock::now();
+        if (!start_batch_workers()) {
+            return false;
+        }
+        finish_batch(false);
+        print_results();
+        
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        size_t failed = devices_failed.load();
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2);
+        if (failed == 0) {
+            line << "All devices flashed successfully! (" << seconds << " s)";
+        } else {
+            line << failed << " of " << devices_attempted.load() << " devices failed ("
+                 << seconds << " s)";
+        }
+        report(line.str(), failed != 0);
+        return failed == 0;
+    }
 };
 
 int main(int argc, char *argv[]) {
@@ -0,0 +1,215 @@
+#include "baud_negotiation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pad_serial.h"
+
+using namespace bootloader;
+
+// Rates tried in order above the starting one: the standard table, then
+// what USB bridges reach with arbitrary divisors
+static const int CANDIDATE_RATES[] = {
+    230400, 460800, 921600, 1000000, 1500000, 2000000, 3000000, 4000000,
+    6000000, 8000000, 12000000
+};
+
+// Between the last good and first failed rate, try arbitrary rates while
+// the gain is at least a tenth, at most this many times
+static const int REFINE_STEPS = 2;
+
+// Test pattern: every byte value, so escapes and all bit patterns go across
+static const size_t TEST_FRAME_SIZE = 512;
+static const int TEST_FRAMES = 8;
+// A rate the line cannot carry damages most frames; one bad frame in
+// TEST_FRAMES is sporadic noise that every rate sees
+static const int TEST_ERRORS_ALLOWED = 1;
+
+std::string BaudRateCache::default_path() {
+    const char* cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache) {
+        return std::string(cache) + "/pad-flasher/baudrates";
+    }
+    const char* home = getenv("HOME");
+    return std::string(home ? home : ".") + "/.cache/pad-flasher/baudrates";
+}
+
+std::string BaudRateCache::adapter_key(const std::string& port) {
+    char id[256];
+    if (pad_serial_adapter_id(port.c_str(), id, sizeof(id)) == 0) {
+        return id;
+    }
+    return "port:" + port;
+}
+
+std::map<std::string, int> BaudRateCache::load() const {
+    std::map<std::string, int> rates;
+    std::ifstream in(path_);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string adapter;
+        int rate = 0;
+        if (fields >> adapter >> rate && rate > 0) {
+            rates[adapter] = rate;
+        }
+    }
+    return rates;
+}
+
+int BaudRateCache::lookup(const std::string& adapter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto rates = load();
+    auto it = rates.find(adapter);
+    return it == rates.end() ? 0 : it->second;
+}
+
+void BaudRateCache::store(const std::string& adapter, int baudrate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Re-read first so entries written by other sessions survive
+    auto rates = load();
+    if (baudrate > 0) {
+        rates[adapter] = baudrate;
+    } else if (!rates.erase(adapter)) {
+        return;
+    }
+
+    // Create missing parent directories, one level at a time
+    for (size_t slash = path_.find('/', 1); slash != std::string::npos;
+         slash = path_.find('/', slash + 1)) {
+        mkdir(path_.substr(0, slash).c_str(), 0755);
+    }
+
+    // Write a new file and rename it over the old one, so a reader never
+    // sees half a file. The name is per process: two sessions storing at
+    // once must not write into the same temporary file.
+    std::string temporary = path_ + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        for (const auto& entry : rates) {
+            out << entry.first << " " << entry.second << "\n";
+        }
+        if (!out) {
+            std::cerr << "Warning: Could not write baud rate cache " << path_ << std::endl;
+            remove(temporary.c_str());
+            return;
+        }
+    }
+    if (rename(temporary.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Warning: Could not replace baud rate cache " << path_ << ": " << strerror(errno)
+                  << std::endl;
+        remove(temporary.c_str());
+    }
+}
+
+int BaudNegotiator::negotiate(int hint) {
+    int good = uart_.baudrate();
+
+    // A rate cached without --max-baudrate may be above it now
+    if (max_baudrate_ > 0 && hint > max_baudrate_) {
+        hint = max_baudrate_;
+    }
+    if (hint > 0 && hint <= good) {
+        return good; // Nothing faster worked last time
+    }
+    if (hint > good) {
+        switch (try_rate(hint)) {
+            case Step::Ok:     return hint;
+            case Step::Lost:   return 0;
+            case Step::Failed: break; // The adapter or cable changed; search again
+        }
+    }
+
+    int failed = 0;
+    for (int rate : CANDIDATE_RATES) {
+        if (rate <= good) continue;
+        if (max_baudrate_ > 0 && rate > max_baudrate_) break;
+        Step step = try_rate(rate);
+        if (step == Step::Lost) return 0;
+        if (step == Step::Failed) {
+            failed = rate;
+            break;
+        }
+        good = rate;
+    }
+
+    for (int i = 0; failed && i < REFINE_STEPS && failed - good > good / 10; i++) {
+        int rate = (good + failed) / 2 / 1000 * 1000;
+        Step step = try_rate(rate);
+        if (step == Step::Lost) return 0;
+        if (step == Step::Ok) {
+            good = rate;
+        } else {
+            failed = rate;
+        }
+    }
+    return good;
+}
+
+// Switch both sides to baudrate and keep it if the test pattern gets
+// through; otherwise end up back at the current rate
+BaudNegotiator::Step BaudNegotiator::try_rate(int baudrate) {
+    int previous = uart_.baudrate();
+    bool accepted = bootloader_.set_baudrate(baudrate);
+    // The device has switched by now if it is going to
+    auto switched = std::chrono::steady_clock::now();
+
+    if (!accepted) {
+        if (bootloader_.status() != 0) {
+            // Refused outright (or an older bootloader): nothing changed
+            if (verbose_) {
+                std::cout << "  " << baudrate << " baud: " << bootloader_.error() << std::endl;
+            }
+            return Step::Failed;
+        }
+    } else if (line_test(baudrate) && bootloader_.confirm_baudrate()) {
+        return Step::Ok;
+    }
+
+    // The device may have switched without us; it falls back on its own
+    // once the change goes unconfirmed
+    std::this_thread::sleep_until(switched + std::chrono::milliseconds(BAUD_CONFIRM_MS + 100));
+    return recover(previous) ? Step::Failed : Step::Lost;
+}
+
+bool BaudNegotiator::line_test(int baudrate) {
+    uint8_t pattern[TEST_FRAME_SIZE];
+    for (size_t i = 0; i < sizeof(pattern); i++) {
+        pattern[i] = (uint8_t)i;
+    }
+
+    // Both directions at line speed, plus turnaround slack
+    int timeout_ms = (int)(2 * (sizeof(pattern) + 32) * 10 * 1000 / (size_t)baudrate) + 100;
+    int frames = 0, errors = 0;
+    while (frames < TEST_FRAMES && errors <= TEST_ERRORS_ALLOWED) {
+        // Vary the alignment of the pattern from frame to frame
+        std::rotate(pattern, pattern + 37, pattern + sizeof(pattern));
+        if (!bootloader_.echo(pattern, sizeof(pattern), timeout_ms)) {
+            errors++;
+        }
+        frames++;
+    }
+
+    if (verbose_) {
+        std::cout << "  " << baudrate << " baud: " << errors << " of " << frames
+                  << " test frames damaged" << std::endl;
+    }
+    return errors <= TEST_ERRORS_ALLOWED;
+}
+
+bool BaudNegotiator::recover(int baudrate) {
+    bootloader::DeviceInfo info;
+    if (uart_.set_baudrate(baudrate) && uart_.sync_connection() && bootloader_.ping(&info)) {
+        return true;
+    }
+    error_ = "device lost at " + std::to_string(baudrate) + " baud";
+    return false;
+}
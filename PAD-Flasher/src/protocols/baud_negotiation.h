@@ -0,0 +1,62 @@
+#ifndef BAUD_NEGOTIATION_H
+#define BAUD_NEGOTIATION_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include "bootloader_client.h"
+#include "uart.h"
+
+// Fastest reliable rate found for each adapter, kept in a small text file
+// ("<adapter> <rate>" per line) so later sessions can skip the search.
+// Safe to share between flash workers.
+class BaudRateCache {
+private:
+    std::string path_;
+    std::mutex mutex_;
+
+public:
+    explicit BaudRateCache(const std::string& path) : path_(path) {}
+
+    // $XDG_CACHE_HOME/pad-flasher/baudrates, or under ~/.cache
+    static std::string default_path();
+    // Cache key for a port: the USB adapter's serial number, or the port
+    // path for adapters that have none
+    static std::string adapter_key(const std::string& port);
+
+    int lookup(const std::string& adapter);   // 0 if unknown
+    void store(const std::string& adapter, int baudrate);
+    void forget(const std::string& adapter) { store(adapter, 0); }
+
+private:
+    std::map<std::string, int> load() const;
+};
+
+// Steps a connected, synced device up from the current (safe) rate to the
+// fastest one that carries a test pattern without errors.
+class BaudNegotiator {
+private:
+    BootloaderClient& bootloader_;
+    UARTProtocol& uart_;
+    int max_baudrate_;
+    bool verbose_ = false;
+    std::string error_;
+
+public:
+    BaudNegotiator(BootloaderClient& bootloader, UARTProtocol& uart, int max_baudrate)
+        : bootloader_(bootloader), uart_(uart), max_baudrate_(max_baudrate) {}
+
+    void set_verbose(bool enabled) { verbose_ = enabled; }
+    // Try hint first (a cached rate, 0 for none), then search. Returns the
+    // rate both sides run at afterwards, or 0 if the device was lost.
+    int negotiate(int hint);
+    const std::string& error() const { return error_; }
+
+private:
+    enum class Step { Ok, Failed, Lost };
+    Step try_rate(int baudrate);
+    bool line_test(int baudrate);
+    bool recover(int baudrate);
+};
+
+#endif // BAUD_NEGOTIATION_H
@@ -0,0 +1,168 @@
+#ifndef BOOTLOADER_PROTOCOL_H
+#define BOOTLOADER_PROTOCOL_H
+
+// PAD UART bootloader wire format, shared by the flasher and pad-devsim.
+//
+// Every packet travels in one 0x7E frame (see pad_frame.h):
+//
+//   command (1) | sequence (1) | payload (0..MAX_PAYLOAD) | CRC32 (4, LE)
+//
+// The CRC covers command, sequence and payload. A reply carries the request's
+// command with REPLY set and the request's sequence number; a request the
+// device rejects is answered with NAK and a one-byte status. Frames that fail
+// their CRC are answered with NAK/BAD_CRC. The sync handshake (7E FF FF 7E,
+// see UARTProtocol::sync_connection) sits outside this format and is
+// answered with a single 0x7E. Multi-byte fields are little-endian.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "pad_common.h"
+
+namespace bootloader {
+
+enum Command : uint8_t {
+    CMD_PING  = 0x01, // -> DeviceInfo
+    CMD_ERASE = 0x02, // address, length (sector aligned)
+    CMD_WRITE = 0x03, // address, data (ANDed into erased flash)
+    CMD_CRC   = 0x04, // address, length -> CRC32 of that range
+    CMD_READ  = 0x05, // address, length (<= max_block) -> data
+    CMD_RESET = 0x06, // Leave the bootloader
+    CMD_BEGIN_BLOCKS = 0x07, // Start a windowed transfer: block numbers restart at 0
+    CMD_WRITE_BLOCK  = 0x08, // block (u16), address, CRC32 of data, data -> BlockAck
+    CMD_SET_BAUD = 0x09,     // rate (u32); see BAUD_CONFIRM_MS
+    CMD_ECHO     = 0x0A,     // data -> the same data (line test pattern)
+    CMD_SECTOR_CRCS = 0x0B,  // address (sector aligned), count -> CRC32 of each sector
+    CMD_ERASE_BLOCK = 0x0C,  // block (u16), address, length (sector aligned) -> BlockAck
+    CMD_WRITE_BLOCK_LZ = 0x0D // block (u16), address, CRC32 of data, length (u16), pad_lz data -> BlockAck
+};
+
+const uint8_t REPLY = 0x80;
+const uint8_t NAK   = 0x7F;
+
+enum Status : uint8_t {
+    STATUS_BAD_CRC     = 0x01,
+    STATUS_BAD_COMMAND = 0x02,
+    STATUS_BAD_ADDRESS = 0x03,
+    STATUS_BAD_LENGTH  = 0x04,
+    STATUS_VERIFY      = 0x05, // Block read back wrong after programming; NAK adds block (u16)
+    STATUS_BAD_RATE    = 0x06  // The device's UART cannot run at that rate
+};
+
+const size_t HEADER_SIZE = 2;
+const size_t CRC_SIZE = 4;
+const size_t MAX_BLOCK = 4096;             // Largest data block any device takes
+const size_t MAX_PAYLOAD = 16 + MAX_BLOCK; // Largest command header plus a data block
+const size_t MAX_PACKET = HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE;
+
+// PING reply payload
+struct DeviceInfo {
+    uint32_t flash_size;
+    uint32_t sector_size;
+    uint32_t max_block;    // Largest WRITE/READ data block
+    uint32_t window;       // WRITE_BLOCKs the device can buffer (1 if it has no windowed mode)
+    uint32_t features;     // FEATURE_* bits (0 if the reply has no such field)
+};
+const size_t DEVICE_INFO_SIZE = 20;
+const size_t DEVICE_INFO_NO_FEATURES_SIZE = 16; // Devices without feature bits
+const size_t DEVICE_INFO_MIN_SIZE = 12; // Devices without windowed mode
+
+enum Feature : uint32_t {
+    FEATURE_ERASE_BLOCKS = 1u << 0, // ERASE_BLOCK in windowed transfers
+    FEATURE_LZ_BLOCKS    = 1u << 1  // WRITE_BLOCK_LZ in windowed transfers
+};
+
+// Windowed transfer (selective repeat). The host keeps up to `window`
+// WRITE_BLOCKs in flight; the device programs them as they arrive and
+// answers each one with the set of blocks programmed so far: every block
+// below `next`, plus block next + 1 + i for each bit i of `bitmap`.
+const size_t BLOCK_HEADER_SIZE = 10;   // block, address, data CRC
+const size_t BLOCK_ACK_SIZE = 6;       // next (u16), bitmap (u32)
+const unsigned BLOCK_ACK_BITS = 32;
+
+// ERASE_BLOCK takes a block number in the same sequence and window as
+// WRITE_BLOCK, so a sector's erase can be queued behind the data for the
+// one before it. The device carries out blocks in arrival order; the host
+// sends a sector's data only once its erase has been acknowledged.
+const size_t ERASE_BLOCK_SIZE = 10;    // block, address, length
+
+// WRITE_BLOCK_LZ is WRITE_BLOCK with the data compressed (pad_lz.h, the
+// LZ4 block format); the device expands it into its block buffer. The CRC
+// and length are those of the expanded data. Blocks that do not shrink go
+// as plain WRITE_BLOCKs in the same transfer.
+const size_t LZ_BLOCK_HEADER_SIZE = 12; // block, address, data CRC, length
+
+// Sectors per SECTOR_CRCS request, so the reply fits one packet
+const uint32_t MAX_SECTOR_CRCS = MAX_BLOCK / 4;
+
+// Baud rate change. The device answers SET_BAUD at the old rate and then
+// switches. The new rate is provisional: unless a second SET_BAUD for the
+// same rate arrives at that rate within BAUD_CONFIRM_MS, the device falls
+// back to the old one, so a rate the line cannot carry never strands it.
+const int BAUD_CONFIRM_MS = 1000;
+
+inline void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+inline void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+inline uint16_t get_le16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+inline uint32_t get_le32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+// A decoded packet; payload points into the frame it was parsed from
+struct Packet {
+    uint8_t command;
+    uint8_t sequence;
+    const uint8_t* payload;
+    size_t length;
+};
+
+// Assemble command, sequence, payload and CRC into out (MAX_PACKET bytes);
+// returns the packet length. The payload may already sit at out + HEADER_SIZE.
+inline size_t build_packet(uint8_t command, uint8_t sequence, const uint8_t* payload,
+                           size_t length, uint8_t* out) {
+    out[0] = command;
+    out[1] = sequence;
+    if (length && payload != out + HEADER_SIZE) {
+        memmove(out + HEADER_SIZE, payload, length);
+    }
+    put_le32(out + HEADER_SIZE + length, pad_crc32(out, HEADER_SIZE + length));
+    return HEADER_SIZE + length + CRC_SIZE;
+}
+
+// Check a frame's CRC and split it into fields
+inline bool parse_packet(const uint8_t* frame, size_t length, Packet* packet) {
+    if (length < HEADER_SIZE + CRC_SIZE || length > MAX_PACKET) {
+        return false;
+    }
+    size_t body = length - CRC_SIZE;
+    if (pad_crc32(frame, body) != get_le32(frame + body)) {
+        return false;
+    }
+    packet->command = frame[0];
+    packet->sequence = frame[1];
+    packet->payload = frame + HEADER_SIZE;
+    packet->length = body - HEADER_SIZE;
+    return true;
+}
+
+inline bool is_sync_frame(const uint8_t* frame, size_t length) {
+    return length == 2 && frame[0] == 0xFF && frame[1] == 0xFF;
+}
+
+} // namespace bootloader
+
+#endif // BOOTLOADER_PROTOCOL_H
@@ -0,0 +1,530 @@
+#include "bootloader_client.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "pad_lz.h"
+
+using namespace bootloader;
+
+// Reply deadlines; erase time grows with the number of sectors
+static const int COMMAND_TIMEOUT_MS = 500;
+static const int ERASE_TIMEOUT_MS = 2000;
+static const int ERASE_SECTOR_TIMEOUT_MS = 500;
+static const uint32_t ASSUMED_SECTOR_SIZE = 4096;
+static const size_t MAX_TRANSFER_BLOCKS = 65535; // Block numbers are 16-bit
+
+static std::string status_name(uint8_t status) {
+    switch (status) {
+        case STATUS_BAD_CRC:     return "bad CRC";
+        case STATUS_BAD_COMMAND: return "unknown command";
+        case STATUS_BAD_ADDRESS: return "address out of range";
+        case STATUS_BAD_LENGTH:  return "bad length";
+        case STATUS_VERIFY:      return "verify failed";
+        case STATUS_BAD_RATE:    return "baud rate not supported";
+        default:                 return "status " + std::to_string(status);
+    }
+}
+
+bool BootloaderClient::transact(uint8_t command, const uint8_t* payload, size_t length,
+                                int timeout_ms, Packet* reply) {
+    if (length > MAX_PAYLOAD) {
+        error_ = "request too large";
+        return false;
+    }
+
+    error_ = "no reply";
+    status_ = 0;
+    for (int attempt = 0; attempt <= retries_; attempt++) {
+        uint8_t sequence = ++sequence_;
+        size_t packet_length = build_packet(command, sequence, payload, length, packet_);
+        if (!uart_.send_frame(packet_, packet_length)) {
+            error_ = "write failed";
+            return false;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        bool resend = false;
+        while (!resend) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            pad_frame frame;
+            if (left <= 0 || !uart_.receive_frame(&frame, static_cast<int>(left))) {
+                break; // Timed out: send again
+            }
+
+            Packet packet;
+            if (!parse_packet(frame.data, frame.length, &packet)) {
+                continue; // Line noise, or a sync echo
+            }
+            if (packet.command == NAK && packet.length >= 1) {
+                if (packet.payload[0] == STATUS_BAD_CRC) {
+                    error_ = "request corrupted on the line";
+                    resend = true;
+                } else if (packet.sequence == sequence) {
+                    status_ = packet.payload[0];
+                    error_ = status_name(status_);
+                    return false;
+                }
+                continue;
+            }
+            if (packet.command != (command | REPLY) || packet.sequence != sequence) {
+                continue; // Late reply to an earlier attempt
+            }
+
+            // The frame view is only valid until the next receive
+            memcpy(reply_, packet.payload, packet.length);
+            reply->command = packet.command;
+            reply->sequence = packet.sequence;
+            reply->payload = reply_;
+            reply->length = packet.length;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BootloaderClient::ping(DeviceInfo* info) {
+    Packet reply;
+    if (!transact(CMD_PING, nullptr, 0, COMMAND_TIMEOUT_MS, &reply)) {
+        return false;
+    }
+    if (reply.length < DEVICE_INFO_MIN_SIZE) {
+        error_ = "short device info";
+        return false;
+    }
+    info->flash_size = get_le32(reply.payload);
+    info->sector_size = get_le32(reply.payload + 4);
+    info->max_block = get_le32(reply.payload + 8);
+    info->window = reply.length >= DEVICE_INFO_NO_FEATURES_SIZE ? get_le32(reply.payload + 12) : 1;
+    info->features = reply.length >= DEVICE_INFO_SIZE ? get_le32(reply.payload + 16) : 0;
+    return true;
+}
+
+bool BootloaderClient::erase(uint32_t address, uint32_t length) {
+    uint8_t payload[8];
+    put_le32(payload, address);
+    put_le32(payload + 4, length);
+    int timeout = ERASE_TIMEOUT_MS +
+                  (int)(length / ASSUMED_SECTOR_SIZE + 1) * ERASE_SECTOR_TIMEOUT_MS;
+    Packet reply;
+    return transact(CMD_ERASE, payload, sizeof(payload), timeout, &reply);
+}
+
+bool BootloaderClient::write(uint32_t address, const uint8_t* data, size_t length) {
+    if (length > MAX_BLOCK) {
+        error_ = "block too large";
+        return false;
+    }
+    uint8_t payload[4 + MAX_BLOCK];
+    put_le32(payload, address);
+    memcpy(payload + 4, data, length);
+    Packet reply;
+    return transact(CMD_WRITE, payload, 4 + length, COMMAND_TIMEOUT_MS, &reply);
+}
+
+const char* TransferStats::bound() const {
+    if (line_seconds >= device_wait_seconds && line_seconds >= erase_wait_seconds) {
+        return "line";
+    }
+    return erase_wait_seconds > device_wait_seconds ? "erase" : "program";
+}
+
+void BootloaderClient::add_data_blocks(std::vector<StreamBlock>& blocks, const Span& span,
+                                       uint32_t block_size, size_t erase) {
+    for (size_t offset = 0, i = 0; offset < span.length; offset += block_size, i++) {
+        uint32_t size = (uint32_t)std::min((size_t)block_size, span.length - offset);
+        StreamBlock block;
+        block.address = span.address + (uint32_t)offset;
+        block.length = size;
+        block.data = span.data + offset;
+        block.crc = span.block_crcs ? span.block_crcs[i] : pad_crc32(block.data, size);
+        block.erase = erase;
+        block.packed = nullptr;
+        block.packed_length = -1;
+        if (span.packed_offsets) {
+            block.packed = span.packed_data + span.packed_offsets[i];
+            block.packed_length = (int32_t)(span.packed_offsets[i + 1] - span.packed_offsets[i]);
+        }
+        blocks.push_back(block);
+    }
+}
+
+bool BootloaderClient::write_windowed(const Span& span, uint32_t block_size, unsigned window,
+                                      TransferStats* stats, uint32_t* written) {
+    if (written) *written = 0;
+    if (block_size == 0 || block_size > MAX_BLOCK) {
+        error_ = "bad block size";
+        return false;
+    }
+    std::vector<StreamBlock> blocks;
+    blocks.reserve((span.length + block_size - 1) / block_size);
+    add_data_blocks(blocks, span, block_size, NO_ERASE);
+    size_t acked = 0;
+    bool ok = write_stream(blocks, window, stats, &acked);
+    if (written) {
+        for (size_t i = 0; i < acked; i++) {
+            *written += blocks[i].length;
+        }
+    }
+    return ok;
+}
+
+bool BootloaderClient::flash_windowed(const std::vector<std::pair<uint32_t, uint32_t>>& erase_ranges,
+                                      const std::vector<Span>& spans, uint32_t sector_size,
+                                      uint32_t block_size, unsigned window, TransferStats* stats) {
+    if (block_size == 0 || block_size > MAX_BLOCK || sector_size == 0) {
+        error_ = "bad block size";
+        return false;
+    }
+    std::vector<uint32_t> sectors;
+    for (const auto& range : erase_ranges) {
+        for (uint64_t sector = range.first; sector < range.second; sector += sector_size) {
+            sectors.push_back((uint32_t)sector);
+        }
+    }
+
+    // E0 E1 D0 E2 D1 E3 D2 ...: the device erases sector k + 1 while the
+    // data for sector k is on the line
+    std::vector<StreamBlock> blocks;
+    auto add_erase = [&](uint32_t sector) {
+        blocks.push_back({sector, sector_size, nullptr, 0, NO_ERASE, nullptr, -1});
+        return blocks.size() - 1;
+    };
+    size_t erase = sectors.empty() ? NO_ERASE : add_erase(sectors[0]);
+    size_t span = 0;
+    uint32_t span_offset = 0;           // Into spans[span]
+    for (size_t k = 0; k < sectors.size(); k++) {
+        size_t next_erase = k + 1 < sectors.size() ? add_erase(sectors[k + 1]) : NO_ERASE;
+        uint64_t sector_end = (uint64_t)sectors[k] + sector_size;
+        while (span < spans.size() && spans[span].address + (uint64_t)span_offset < sector_end) {
+            const Span& source = spans[span];
+            Span piece;
+            piece.address = source.address + span_offset;
+            piece.data = source.data + span_offset;
+            piece.length = (uint32_t)std::min<uint64_t>(source.length - span_offset,
+                                                        sector_end - source.address - span_offset);
+            // What is cached per block fits when the blocks line up with the span's
+            if (span_offset % block_size == 0 &&
+                (piece.length % block_size == 0 || span_offset + piece.length == source.length)) {
+                size_t first_block = span_offset / block_size;
+                piece.block_crcs = source.block_crcs ? source.block_crcs + first_block : nullptr;
+                piece.packed_data = source.packed_data;
+                piece.packed_offsets = source.packed_offsets ? source.packed_offsets + first_block : nullptr;
+            }
+            add_data_blocks(blocks, piece, block_size, erase);
+            uint32_t length = piece.length;
+            span_offset += length;
+            if (span_offset == source.length) {
+                span++;
+                span_offset = 0;
+            }
+        }
+        erase = next_erase;
+    }
+    if (span < spans.size()) {
+        error_ = "data outside the erased sectors";
+        return false;
+    }
+    return write_stream(blocks, window, stats);
+}
+
+bool BootloaderClient::write_stream(const std::vector<StreamBlock>& blocks, unsigned window,
+                                    TransferStats* stats, size_t* acked) {
+    if (acked) *acked = 0;
+    // The device reports at most BLOCK_ACK_BITS blocks past its first gap
+    window = std::max(1u, std::min(window, BLOCK_ACK_BITS));
+
+    auto started = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (size_t first = 0; ok && first < blocks.size(); first += MAX_TRANSFER_BLOCKS) {
+        size_t count = std::min(MAX_TRANSFER_BLOCKS, blocks.size() - first);
+        size_t base = 0;
+        ok = write_blocks(blocks.data() + first, count, first, window, stats, &base);
+        if (acked) *acked = first + base;
+    }
+    if (stats) {
+        stats->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+    return ok;
+}
+
+size_t BootloaderClient::send_block(uint16_t number, const StreamBlock& block,
+                                    TransferStats* stats) {
+    uint8_t* payload = packet_ + HEADER_SIZE;
+    put_le16(payload, number);
+    put_le32(payload + 2, block.address);
+    size_t packet_length;
+    if (!block.data) {
+        put_le32(payload + 6, block.length);
+        packet_length = build_packet(CMD_ERASE_BLOCK, ++sequence_, payload, ERASE_BLOCK_SIZE, packet_);
+    } else {
+        put_le32(payload + 6, block.crc);
+        // Compressed if that saves anything; without a cached form, try now
+        size_t packed_length = 0;
+        if (compress_ && block.packed_length > 0) {
+            packed_length = (size_t)block.packed_length;
+            memcpy(payload + LZ_BLOCK_HEADER_SIZE, block.packed, packed_length);
+        } else if (compress_ && block.packed_length < 0 && block.length > 1) {
+            packed_length = pad_lz_compress(block.data, block.length, payload + LZ_BLOCK_HEADER_SIZE,
+                                            block.length - 1);
+        }
+        if (packed_length > 0) {
+            put_le16(payload + 10, (uint16_t)block.length);
+            packet_length = build_packet(CMD_WRITE_BLOCK_LZ, ++sequence_, payload,
+                                         LZ_BLOCK_HEADER_SIZE + packed_length, packet_);
+        } else {
+            memcpy(payload + BLOCK_HEADER_SIZE, block.data, block.length);
+            packet_length = build_packet(CMD_WRITE_BLOCK, ++sequence_, payload,
+                                         BLOCK_HEADER_SIZE + block.length, packet_);
+        }
+        if (stats) {
+            stats->data_bytes += block.length;
+            stats->wire_bytes += packed_length > 0 ? packed_length : block.length;
+        }
+    }
+    return uart_.send_frame(packet_, packet_length) ? packet_length : 0;
+}
+
+bool BootloaderClient::write_blocks(const StreamBlock* stream, size_t count, size_t first,
+                                    unsigned window, TransferStats* stats, size_t* acked) {
+    using Clock = std::chrono::steady_clock;
+    struct Block {
+        bool acked = false;
+        int sends = 0;
+        uint64_t order = 0;          // When it was last sent, in send order
+        Clock::time_point deadline;
+    };
+
+    Packet reply;
+    if (!transact(CMD_BEGIN_BLOCKS, nullptr, 0, COMMAND_TIMEOUT_MS, &reply)) {
+        return false;
+    }
+
+    // A block may wait behind a full window of others on the line, and
+    // behind erases
+    size_t largest = ERASE_BLOCK_SIZE;
+    bool erases = false;
+    for (size_t i = 0; i < count; i++) {
+        if (stream[i].data) {
+            largest = std::max(largest, (size_t)stream[i].length);
+        } else {
+            erases = true;
+        }
+    }
+    int baudrate = std::max(uart_.baudrate(), 1);
+    auto block_time = std::chrono::microseconds(
+        (uint64_t)(largest + 32) * 10u * 1000000u / (uint64_t)baudrate);
+    auto timeout = std::chrono::milliseconds(COMMAND_TIMEOUT_MS) + block_time * window;
+    if (erases) {
+        timeout += std::chrono::milliseconds(ERASE_TIMEOUT_MS);
+    }
+
+    std::vector<Block> blocks(count);
+    size_t& base = *acked;               // First unacknowledged block
+    size_t next = 0;
+    uint64_t order = 0, acked_order = 0;
+
+    auto send = [&](size_t i) {
+        if (blocks[i].sends > retries_) {
+            error_ = "block at offset " + std::to_string(stream[i].address) + " not acknowledged";
+            return false;
+        }
+        size_t sent = send_block((uint16_t)i, stream[i], stats);
+        if (!sent) {
+            error_ = "write failed";
+            return false;
+        }
+        blocks[i].sends++;
+        blocks[i].order = ++order;
+        blocks[i].deadline = Clock::now() + timeout;
+        if (stats) {
+            stats->line_seconds += (double)(sent + 2) * 10 / baudrate; // Plus the frame flags
+            if (stream[i].data) {
+                stats->blocks++;
+            } else {
+                stats->erases++;
+            }
+        }
+        return true;
+    };
+    auto mark = [&](size_t i) {
+        if (i < next && !blocks[i].acked) {
+            blocks[i].acked = true;
+            acked_order = std::max(acked_order, blocks[i].order);
+        }
+    };
+    // A sector's data waits until its erase is done (erases in an earlier
+    // transfer all are)
+    auto ready = [&](size_t i) {
+        size_t erase = stream[i].erase;
+        return erase == NO_ERASE || erase < first || blocks[erase - first].acked;
+    };
+
+    while (base < count) {
+        while (next < count && next - base < window && ready(next)) {
+            if (!send(next++)) return false;
+        }
+
+        Clock::time_point earliest = Clock::time_point::max();
+        for (size_t i = base; i < next; i++) {
+            if (!blocks[i].acked) earliest = std::min(earliest, blocks[i].deadline);
+        }
+        Clock::time_point waited = Clock::now();
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(earliest - waited).count();
+
+        pad_frame frame;
+        Packet packet;
+        bool received = wait > 0 && uart_.receive_frame(&frame, static_cast<int>(wait)) &&
+                        parse_packet(frame.data, frame.length, &packet);
+        if (stats) {
+            double seconds = std::chrono::duration<double>(Clock::now() - waited).count();
+            bool held = next < count && next - base < window; // Window open, data not ready
+            (held ? stats->erase_wait_seconds : stats->device_wait_seconds) += seconds;
+        }
+        if (received) {
+            if (packet.command == NAK && packet.length >= 1) {
+                uint8_t status = packet.payload[0];
+                if (status == STATUS_VERIFY && packet.length >= 3) {
+                    size_t block = get_le16(packet.payload + 1);
+                    if (block < next && !blocks[block].acked && !send(block)) {
+                        error_ = "block at offset " + std::to_string(stream[block].address) +
+                                 " fails verification";
+                        return false;
+                    }
+                } else if (status != STATUS_BAD_CRC) {
+                    error_ = status_name(status);
+                    return false;
+                }
+                continue; // A corrupted block shows up as a gap or a timeout
+            }
+            if ((packet.command != (CMD_WRITE_BLOCK | REPLY) &&
+                 packet.command != (CMD_WRITE_BLOCK_LZ | REPLY) &&
+                 packet.command != (CMD_ERASE_BLOCK | REPLY)) || packet.length < BLOCK_ACK_SIZE) {
+                continue;
+            }
+
+            size_t first_missing = get_le16(packet.payload);
+            uint32_t bitmap = get_le32(packet.payload + 2);
+            for (size_t i = base; i < std::min(first_missing, next); i++) {
+                mark(i);
+            }
+            for (unsigned bit = 0; bit < BLOCK_ACK_BITS; bit++) {
+                if (bitmap & (1u << bit)) mark(first_missing + 1 + bit);
+            }
+
+            // Blocks are carried out in arrival order, so one sent before an
+            // acknowledged block and still unacknowledged was lost
+            for (size_t i = base; i < next; i++) {
+                if (!blocks[i].acked && blocks[i].order < acked_order && !send(i)) {
+                    return false;
+                }
+            }
+        } else {
+            Clock::time_point now = Clock::now();
+            for (size_t i = base; i < next; i++) {
+                if (!blocks[i].acked && blocks[i].deadline <= now && !send(i)) {
+                    return false;
+                }
+            }
+        }
+
+        while (base < count && blocks[base].acked) {
+            base++;
+        }
+    }
+    return true;
+}
+
+bool BootloaderClient::crc(uint32_t address, uint32_t length, uint32_t* crc) {
+    uint8_t payload[8];
+    put_le32(payload, address);
+    put_le32(payload + 4, length);
+    Packet reply;
+    if (!transact(CMD_CRC, payload, sizeof(payload), COMMAND_TIMEOUT_MS, &reply)) {
+        return false;
+    }
+    if (reply.length < 4) {
+        error_ = "short CRC reply";
+        return false;
+    }
+    *crc = get_le32(reply.payload);
+    return true;
+}
+
+bool BootloaderClient::sector_crcs(uint32_t address, uint32_t sector_size, uint32_t count,
+                                   uint32_t* crcs) {
+    bool batched = true;
+    while (count > 0) {
+        uint32_t n = std::min(count, MAX_SECTOR_CRCS);
+        if (batched) {
+            uint8_t payload[8];
+            put_le32(payload, address);
+            put_le32(payload + 4, n);
+            Packet reply;
+            if (transact(CMD_SECTOR_CRCS, payload, sizeof(payload), COMMAND_TIMEOUT_MS, &reply)) {
+                if (reply.length < 4 * (size_t)n) {
+                    error_ = "short sector CRC reply";
+                    return false;
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    crcs[i] = get_le32(reply.payload + 4 * i);
+                }
+            } else if (status_ == STATUS_BAD_COMMAND) {
+                batched = false; // An older bootloader: one CRC request per sector
+                continue;
+            } else {
+                return false;
+            }
+        } else {
+            n = 1;
+            if (!crc(address, sector_size, crcs)) {
+                return false;
+            }
+        }
+        address += n * sector_size;
+        crcs += n;
+        count -= n;
+    }
+    return true;
+}
+
+bool BootloaderClient::set_baudrate(int baudrate) {
+    uint8_t payload[4];
+    put_le32(payload, (uint32_t)baudrate);
+    Packet reply;
+    if (!transact(CMD_SET_BAUD, payload, sizeof(payload), COMMAND_TIMEOUT_MS, &reply)) {
+        return false;
+    }
+    // The reply went out at the old rate; everything after it uses the new one
+    if (!uart_.set_baudrate(baudrate)) {
+        error_ = "host cannot set " + std::to_string(baudrate) + " baud";
+        return false;
+    }
+    return true;
+}
+
+bool BootloaderClient::confirm_baudrate() {
+    uint8_t payload[4];
+    put_le32(payload, (uint32_t)uart_.baudrate());
+    Packet reply;
+    return transact(CMD_SET_BAUD, payload, sizeof(payload), COMMAND_TIMEOUT_MS, &reply);
+}
+
+bool BootloaderClient::echo(const uint8_t* data, size_t length, int timeout_ms) {
+    // A single attempt: a retry would hide the errors being measured
+    int retries = retries_;
+    retries_ = 0;
+    Packet reply;
+    bool ok = transact(CMD_ECHO, data, length, timeout_ms, &reply);
+    retries_ = retries;
+    if (ok && (reply.length != length || memcmp(reply.payload, data, length) != 0)) {
+        error_ = "echo mismatch";
+        ok = false;
+    }
+    return ok;
+}
+
+bool BootloaderClient::reset() {
+    Packet reply;
+    return transact(CMD_RESET, nullptr, 0, COMMAND_TIMEOUT_MS, &reply);
+}
@@ -0,0 +1,124 @@
+#ifndef BOOTLOADER_CLIENT_H
+#define BOOTLOADER_CLIENT_H
+
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "bootloader.h"
+#include "uart.h"
+
+// Where a windowed transfer spent its time. Waits are while the host had
+// nothing it could send: the window full of blocks the device has not got
+// to yet, or data held back until its sector's erase is acknowledged.
+struct TransferStats {
+    double seconds = 0;
+    double line_seconds = 0;        // Frames on the wire, at the line rate
+    double device_wait_seconds = 0;
+    double erase_wait_seconds = 0;
+    size_t blocks = 0;              // Sent, counting resends
+    size_t erases = 0;
+    uint64_t data_bytes = 0;        // Block data sent, as programmed
+    uint64_t wire_bytes = 0;        // The same, as sent (compressed or not)
+
+    // The stage that held the transfer up: "line", "program" or "erase"
+    const char* bound() const;
+};
+
+// Host side of the PAD UART bootloader protocol. Each request waits for its
+// reply (stop-and-wait) except in write_windowed; lost or corrupted
+// exchanges are retried.
+class BootloaderClient {
+private:
+    UARTProtocol& uart_;
+    uint8_t sequence_ = 0;
+    int retries_ = 3;
+    std::string error_;
+    uint8_t status_ = 0;
+    bool compress_ = false;
+    uint8_t packet_[bootloader::MAX_PACKET];
+    uint8_t reply_[bootloader::MAX_PACKET];
+
+public:
+    explicit BootloaderClient(UARTProtocol& uart) : uart_(uart) {}
+
+    void set_retries(int retries) { retries_ = retries; }
+    // Send windowed blocks as WRITE_BLOCK_LZ where that saves bytes; only
+    // for devices with FEATURE_LZ_BLOCKS
+    void set_compression(bool compress) { compress_ = compress; }
+    bool ping(bootloader::DeviceInfo* info);
+    bool erase(uint32_t address, uint32_t length);
+    bool write(uint32_t address, const uint8_t* data, size_t length);
+    // Image bytes to write. What is known of each block_size block from the
+    // start, so it need not be worked out per device: its pad_crc32, and
+    // its pad_lz form, packed_data + packed_offsets[i] up to
+    // packed_offsets[i + 1] (empty if it does not shrink).
+    struct Span {
+        uint32_t address;
+        const uint8_t* data;
+        uint32_t length;
+        const uint32_t* block_crcs = nullptr;
+        const uint8_t* packed_data = nullptr;
+        const uint32_t* packed_offsets = nullptr;
+    };
+    // Write a span as block_size blocks with up to window of them in
+    // flight, so the line stays busy while the device programs earlier ones.
+    // Missing blocks are resent selectively. written receives the bytes
+    // acknowledged from the start of the span, also on failure.
+    bool write_windowed(const Span& span, uint32_t block_size, unsigned window,
+                        TransferStats* stats = nullptr, uint32_t* written = nullptr);
+    // Erase the sector-aligned ranges and program the spans inside them in
+    // one windowed transfer. Each sector's erase goes out ahead of the data
+    // for the sector before, so the device erases while the line carries
+    // data, and every block is read back as it is programmed. Needs
+    // FEATURE_ERASE_BLOCKS.
+    bool flash_windowed(const std::vector<std::pair<uint32_t, uint32_t>>& erase_ranges,
+                        const std::vector<Span>& spans, uint32_t sector_size,
+                        uint32_t block_size, unsigned window, TransferStats* stats = nullptr);
+    bool crc(uint32_t address, uint32_t length, uint32_t* crc);
+    // CRC32 of each of count sector_size sectors from address. Bootloaders
+    // without SECTOR_CRCS are asked one sector at a time.
+    bool sector_crcs(uint32_t address, uint32_t sector_size, uint32_t count, uint32_t* crcs);
+    // Switch the device to baudrate and follow it on the host side. The
+    // device holds the rate only once confirmed (BAUD_CONFIRM_MS).
+    bool set_baudrate(int baudrate);
+    bool confirm_baudrate();
+    // Send data through the device and back; false if anything came back wrong
+    bool echo(const uint8_t* data, size_t length, int timeout_ms);
+    bool reset();
+    // Why the last request failed
+    const std::string& error() const { return error_; }
+    // NAK status if the device refused the last request, else 0
+    uint8_t status() const { return status_; }
+
+private:
+    // One block of a windowed transfer: data to program, or a sector to erase
+    struct StreamBlock {
+        uint32_t address;
+        uint32_t length;
+        const uint8_t* data;        // nullptr for an erase
+        uint32_t crc;
+        size_t erase;               // Index of the block erasing its sector, or NO_ERASE
+        const uint8_t* packed;      // pad_lz form, if packed_length > 0
+        int32_t packed_length;      // 0: does not shrink, -1: not known
+    };
+    static const size_t NO_ERASE = (size_t)-1;
+
+    // Split a span into blocks of at most block_size
+    static void add_data_blocks(std::vector<StreamBlock>& blocks, const Span& span,
+                                uint32_t block_size, size_t erase);
+    // Send blocks in windowed transfers of at most 65535 blocks each.
+    // acked receives how many leading blocks were acknowledged.
+    bool write_stream(const std::vector<StreamBlock>& blocks, unsigned window, TransferStats* stats,
+                      size_t* acked = nullptr);
+    bool write_blocks(const StreamBlock* blocks, size_t count, size_t first, unsigned window,
+                      TransferStats* stats, size_t* acked);
+    // Returns the packet length, 0 if it could not be sent
+    size_t send_block(uint16_t number, const StreamBlock& block, TransferStats* stats);
+    // Send a request and wait for its reply; the reply payload is copied out
+    // of the receive ring into reply_
+    bool transact(uint8_t command, const uint8_t* payload, size_t length, int timeout_ms,
+                  bootloader::Packet* reply);
+};
+
+#endif // BOOTLOADER_CLIENT_H
@@ -1,111 +1,120 @@
 #include "uart.h"
+#include <cerrno>
+#include <chrono>
 #include <iostream>
 #include <cstring>
-#include <unistd.h>
-#include <fcntl.h>
-#include <termios.h>
-#include <sys/ioctl.h>
+
+// Receive ring per connection; holds several maximum-size frames
+static const size_t UART_RING_SIZE = 64 * 1024;
 
 UARTProtocol::UARTProtocol(const std::string& port, int baudrate) 
-    : port_(port), baudrate_(baudrate), fd_(-1) {}
+    : port_(port), baudrate_(baudrate) {}
 
 bool UARTProtocol::connect() {
-    // Open the serial port
-    fd_ = open(port_.c_str(), O_RDWR | O_NOCTTY);
-    if (fd_ < 0) {
-        std::cerr << "Error opening port " << port_ << ": " << strerror(errno) << std::endl;
+    // Open the port raw (8N1, no flow control) at any supported rate
+    serial_ = pad_serial_open(port_.c_str(), baudrate_);
+    if (!serial_) {
+        std::cerr << "Error opening port " << port_ << " at " << baudrate_ << " baud: "
+                  << strerror(errno) << std::endl;
         return false;
     }
 
-    struct termios tty;
-    memset(&tty, 0, sizeof(tty));
-
-    // Get current attributes
-    if (tcgetattr(fd_, &tty) != 0) {
-        std::cerr << "Error getting attributes for " << port_ << ": " << strerror(errno) << std::endl;
-        close(fd_);
-        return false;
+    if (low_latency_ && pad_serial_set_low_latency(serial_, 1) != 0) {
+        std::cerr << "Warning: " << port_ << " does not support low-latency mode" << std::endl;
     }
 
-    // Configure for raw mode
-    cfsetospeed(&tty, get_baud_rate());
-    cfsetispeed(&tty, get_baud_rate());
-
-    tty.c_cflag &= ~PARENB;  // No parity
-    tty.c_cflag &= ~CSTOPB;  // 1 stop bit
-    tty.c_cflag &= ~CSIZE;   // Clear size bits
-    tty.c_cflag |= CS8;      // 8 data bits
-    tty.c_cflag &= ~CRTSCTS; // No hardware flow control
-    tty.c_cflag |= CREAD | CLOCAL; // Enable receiver, ignore modem control lines
-
-    tty.c_lflag &= ~ICANON;  // Non-canonical mode
-    tty.c_lflag &= ~ECHO;    // No echo
-    tty.c_lflag &= ~ECHOE;   // No echo erase
-    tty.c_lflag &= ~ISIG;    // No signal chars
-
-    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // No software flow control
-    tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
-
-    tty.c_oflag &= ~OPOST;   // No output processing
-    tty.c_oflag &= ~ONLCR;   // No newline translation
-
-    tty.c_cc[VMIN] = 0;      // Don't wait for minimum chars
-    tty.c_cc[VTIME] = 10;    // Wait for 1 second max
+    // Flush any existing data
+    pad_serial_flush(serial_);
 
-    // Apply settings
-    if (tcsetattr(fd_, TCSANOW, &tty) != 0) {
-        std::cerr << "Error setting attributes for " << port_ << ": " << strerror(errno) << std::endl;
-        close(fd_);
+    framer_ = pad_framer_create(PAD_FRAME_HDLC, UART_RING_SIZE, 0);
+    if (!framer_) {
+        std::cerr << "Cannot allocate receive buffer for " << port_ << std::endl;
+        pad_serial_close(serial_);
+        serial_ = nullptr;
         return false;
     }
 
-    // Flush any existing data
-    tcflush(fd_, TCIOFLUSH);
-
     connected_ = true;
-    std::cout << "Connected to " << port_ << " at " << baudrate_ << " baud" << std::endl;
+    if (verbose_) {
+        std::cout << "Connected to " << port_ << " at " << baudrate_ << " baud" << std::endl;
+    }
     return true;
 }
 
 bool UARTProtocol::disconnect() {
-    if (connected_ && fd_ >= 0) {
-        close(fd_);
-        fd_ = -1;
+    if (connected_ && serial_) {
+        pad_serial_close(serial_);
+        serial_ = nullptr;
         connected_ = false;
-        std::cout << "Disconnected from " << port_ << std::endl;
+        pad_framer_destroy(framer_);
+        framer_ = nullptr;
+        if (verbose_) {
+            std::cout << "Disconnected from " << port_ << std::endl;
+        }
     }
     return true;
 }
 
+bool UARTProtocol::set_baudrate(int baudrate) {
+    if (connected_) {
+        // Bytes still in the transmitter would go out at the new rate
+        pad_serial_drain(serial_);
+        if (pad_serial_set_baud(serial_, baudrate) != 0) {
+            std::cerr << "Cannot set " << port_ << " to " << baudrate << " baud" << std::endl;
+            return false;
+        }
+        // Whatever arrived at the old rate is garbage at the new one
+        pad_framer_reset(framer_);
+    }
+    baudrate_ = baudrate;
+    return true;
+}
+
 bool UARTProtocol::send_data(const uint8_t* data, size_t length) {
     if (!connected_) {
         std::cerr << "Not connected to " << port_ << std::endl;
         return false;
     }
 
-    ssize_t written = 0;
     size_t total_written = 0;
-
     while (total_written < length) {
-        written = write(fd_, data + total_written, length - total_written);
+        int written = pad_serial_write(serial_, data + total_written, length - total_written);
         if (written < 0) {
+            if (errno == EINTR) continue;
             std::cerr << "Error writing to " << port_ << ": " << strerror(errno) << std::endl;
             return false;
         }
         total_written += written;
     }
-
-    tcdrain(fd_); // Wait for transmission to complete
     return true;
 }
 
+bool UARTProtocol::send_frame(const uint8_t* data, size_t length) {
+    tx_frame_.resize(pad_frame_encoded_max(PAD_FRAME_HDLC, length));
+    int encoded = pad_frame_encode(PAD_FRAME_HDLC, data, length, tx_frame_.data(), tx_frame_.size());
+    return encoded > 0 && send_data(tx_frame_.data(), encoded);
+}
+
 bool UARTProtocol::receive_data(uint8_t* buffer, size_t max_length, size_t* received) {
     if (!connected_) {
         std::cerr << "Not connected to " << port_ << std::endl;
         return false;
     }
 
-    ssize_t bytes_read = read(fd_, buffer, max_length);
+    // Bytes left over from frame parsing come first, after the frame
+    // receive_frame last returned
+    pad_framer_release(framer_);
+    pad_ring* ring = pad_framer_ring(framer_);
+    size_t buffered;
+    uint8_t* pending = pad_ring_read_ptr(ring, &buffered);
+    if (buffered > 0) {
+        *received = buffered < max_length ? buffered : max_length;
+        memcpy(buffer, pending, *received);
+        pad_ring_consume(ring, *received);
+        return true;
+    }
+
+    int bytes_read = pad_serial_read(serial_, buffer, max_length);
     if (bytes_read < 0) {
         std::cerr << "Error reading from " << port_ << ": " << strerror(errno) << std::endl;
         return false;
@@ -115,46 +124,73 @@ bool UARTProtocol::receive_data(uint8_t* buffer, size_t max_length, size_t* rece
     return true;
 }
 
-speed_t UARTProtocol::get_baud_rate() {
-    switch(baudrate_) {
-        case 9600: return B9600;
-        case 19200: return B19200;
-        case 38400: return B38400;
-        case 57600: return B57600;
-        case 115200: return B115200;
-        case 230400: return B230400;
-        case 460800: return B460800;
-        case 921600: return B921600;
-        default:
-            std::cerr << "Unsupported baud rate: " << baudrate_ << ", using 115200" << std::endl;
-            baudrate_ = 115200;
-            return B115200;
+// Read what has arrived straight into the ring, waiting up to timeout_ms
+bool UARTProtocol::fill_ring(int timeout_ms) {
+    if (pad_serial_wait_readable(serial_, timeout_ms) <= 0) {
+        return false;
+    }
+
+    int bytes_read = pad_ring_fill(pad_framer_ring(framer_), serial_);
+    if (bytes_read < 0) {
+        std::cerr << "Error reading from " << port_ << ": " << strerror(errno) << std::endl;
+    }
+    return bytes_read > 0;
+}
+
+bool UARTProtocol::receive_frame(pad_frame* frame, int timeout_ms) {
+    if (!connected_) {
+        std::cerr << "Not connected to " << port_ << std::endl;
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        if (pad_framer_next(framer_, frame) > 0) {
+            return true;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0 || !fill_ring(static_cast<int>(left))) {
+            return pad_framer_next(framer_, frame) > 0;
+        }
     }
 }
 
 bool UARTProtocol::sync_connection() {
+    // The closing flag of the frame receive_frame last returned is no answer
+    pad_framer_release(framer_);
+
     // Send synchronization bytes
     uint8_t sync_bytes[] = {0x7E, 0xFF, 0xFF, 0x7E};
     if (!send_data(sync_bytes, sizeof(sync_bytes))) {
         return false;
     }
 
-    // Give device time to respond
-    usleep(100000); // 100ms
-
-    // Try to read response
-    uint8_t response[8];
-    size_t received;
-    if (receive_data(response, sizeof(response), &received)) {
-        // Look for expected sync response pattern
-        for (size_t i = 0; i < received; ++i) {
-            if (response[i] == 0x7E) {
+    // Give the device 100 ms to answer with a 0x7E flag, looking at
+    // everything it sends rather than just the first read. The flag stays
+    // buffered, so it can still open the device's first frame.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    size_t scanned = 0;
+    for (;;) {
+        size_t buffered;
+        const uint8_t* data = pad_ring_read_ptr(pad_framer_ring(framer_), &buffered);
+        if (memchr(data + scanned, 0x7E, buffered - scanned)) {
+            if (verbose_) {
                 std::cout << "Sync achieved with " << port_ << std::endl;
-                return true;
             }
+            return true;
+        }
+        scanned = buffered;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0 || !fill_ring(static_cast<int>(left))) {
+            break;
         }
     }
 
-    std::cout << "Sync failed with " << port_ << std::endl;
+    if (verbose_) {
+        std::cout << "Sync failed with " << port_ << std::endl;
+    }
     return false;
 }
\ No newline at end of file
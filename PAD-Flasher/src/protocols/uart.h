@@ -3,25 +3,49 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
+#include "pad_frame.h"
+#include "pad_serial.h"
 
 class UARTProtocol {
 private:
     std::string port_;
     int baudrate_;
-    int fd_;
+    serial_port_t* serial_ = nullptr;
     bool connected_ = false;
+    bool low_latency_ = false;
+    bool verbose_ = true;
+    pad_framer* framer_ = nullptr; // 0x7E-delimited receive path
+    std::vector<uint8_t> tx_frame_;
 
 public:
     UARTProtocol(const std::string& port, int baudrate);
+    ~UARTProtocol() { disconnect(); }
+    UARTProtocol(const UARTProtocol&) = delete;
+    UARTProtocol& operator=(const UARTProtocol&) = delete;
     
+    // Ask the driver not to batch received bytes (takes effect on connect)
+    void set_low_latency(bool enabled) { low_latency_ = enabled; }
+    // Report connects and syncs on stdout (errors always go to stderr)
+    void set_verbose(bool enabled) { verbose_ = enabled; }
     bool connect();
     bool disconnect();
+    // Any rate the adapter supports, e.g. 2-12 Mbaud on FTDI/CP210x bridges
+    bool set_baudrate(int baudrate);
+    int baudrate() const { return baudrate_; }
+    // Returns once the driver has the data; set_baudrate waits for it to
+    // leave the UART
     bool send_data(const uint8_t* data, size_t length);
+    // Send data as one 0x7E-delimited frame
+    bool send_frame(const uint8_t* data, size_t length);
     bool receive_data(uint8_t* buffer, size_t max_length, size_t* received);
+    // Wait up to timeout_ms for the next 0x7E-delimited frame. The frame is a
+    // view into the receive ring, valid until the next receive call.
+    bool receive_frame(pad_frame* frame, int timeout_ms);
     bool sync_connection();
     
 private:
-    speed_t get_baud_rate();
+    bool fill_ring(int timeout_ms);
 };
 
 #endif // UART_PROTOCOL_H
\ No newline at end of file
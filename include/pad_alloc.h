@@ -0,0 +1,53 @@
+#ifndef PAD_ALLOC_H
+#define PAD_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Alignment of every arena and pool allocation
+#define PAD_ALLOC_ALIGN 16
+
+// Bump allocator: allocations are never freed individually, pad_arena_reset()
+// releases everything at once. Not thread-safe; use one arena per session.
+typedef struct pad_arena pad_arena;
+
+pad_arena* pad_arena_create(size_t block_size);
+void pad_arena_destroy(pad_arena* arena);
+void* pad_arena_alloc(pad_arena* arena, size_t size);
+char* pad_arena_strdup(pad_arena* arena, const char* str);
+void pad_arena_reset(pad_arena* arena);
+size_t pad_arena_used(const pad_arena* arena);
+
+// Fixed-size object pool with a lock-free global free list and per-thread
+// caches. When the pool is exhausted it falls back to the heap, and
+// pad_pool_free() accepts both kinds of pointer. Thread-safe.
+typedef struct pad_pool pad_pool;
+
+pad_pool* pad_pool_create(size_t object_size, uint32_t capacity);
+void pad_pool_destroy(pad_pool* pool);
+void* pad_pool_alloc(pad_pool* pool);
+void pad_pool_free(pad_pool* pool, void* ptr);
+// Return the calling thread's cached objects to the pool (call before a worker exits)
+void pad_pool_flush_thread_cache(pad_pool* pool);
+size_t pad_pool_heap_fallbacks(const pad_pool* pool);
+
+// Where a library object gets its memory: an arena, a pool, or the heap when
+// both are NULL (or when the allocator pointer itself is NULL).
+typedef struct pad_allocator {
+    pad_arena* arena;
+    pad_pool* pool;
+} pad_allocator;
+
+void* pad_allocator_alloc(const pad_allocator* allocator, size_t size);
+// No-op for arena memory; it is released by pad_arena_reset()
+void pad_allocator_free(const pad_allocator* allocator, void* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_ALLOC_H
@@ -0,0 +1,72 @@
+#ifndef PAD_COMMON_H
+#define PAD_COMMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Storage class for per-thread variables
+#if defined(__cplusplus)
+    #define PAD_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+    #define PAD_THREAD_LOCAL __declspec(thread)
+#else
+    #define PAD_THREAD_LOCAL _Thread_local
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cross-platform helpers (pad_common.c)
+void pad_sleep_ms(uint32_t milliseconds);
+uint64_t pad_get_timestamp_ms(void);
+uint64_t pad_now_ns(void); // Monotonic, for measuring intervals only
+int pad_strncpy(char* dest, const char* src, size_t dest_size);
+void* pad_malloc(size_t size);
+void pad_free(void* ptr);
+
+// One-shot CRC32 (IEEE 802.3, reflected, same result as zlib crc32)
+uint32_t pad_crc32(const uint8_t* data, size_t length);
+
+// Incremental CRC32 (pad_crc32.cpp):
+//   uint32_t state = pad_crc32_init();
+//   state = pad_crc32_update(state, chunk, chunk_len);  // any number of times
+//   uint32_t crc = pad_crc32_final(state);
+uint32_t pad_crc32_init(void);
+uint32_t pad_crc32_update(uint32_t state, const uint8_t* data, size_t length);
+uint32_t pad_crc32_final(uint32_t state);
+
+// Combine/patch CRC32 values without touching the data (pad_common.c)
+uint32_t pad_crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b);
+uint32_t pad_crc32_patch(uint32_t crc, uint64_t total_length, uint64_t offset,
+                         const uint8_t* old_bytes, const uint8_t* new_bytes,
+                         size_t patch_length);
+
+// CRC32 of a large buffer split across a shared worker pool; max_threads == 0
+// uses every core. Small buffers are hashed on the calling thread.
+uint32_t pad_crc32_parallel(const uint8_t* data, size_t length, unsigned max_threads);
+
+// CRC32 kernels; AUTO is the fastest one supported by the running CPU
+typedef enum {
+    PAD_CRC32_IMPL_AUTO = 0,
+    PAD_CRC32_IMPL_BYTEWISE,
+    PAD_CRC32_IMPL_SLICE8,
+    PAD_CRC32_IMPL_SLICE16,
+    PAD_CRC32_IMPL_PCLMUL,
+    PAD_CRC32_IMPL_ARMV8,
+    PAD_CRC32_IMPL_COUNT
+} pad_crc32_impl_t;
+
+const char* pad_crc32_impl_name(pad_crc32_impl_t impl);
+int pad_crc32_impl_available(pad_crc32_impl_t impl);
+pad_crc32_impl_t pad_crc32_impl_selected(void);
+
+// Update with a specific kernel (unavailable kernels fall back to AUTO)
+uint32_t pad_crc32_update_impl(pad_crc32_impl_t impl, uint32_t state,
+                               const uint8_t* data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_COMMON_H
@@ -0,0 +1,79 @@
+#ifndef PAD_CONFIG_H
+#define PAD_CONFIG_H
+
+#include "pad_alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Key/value configuration store (pad_config.c)
+int pad_config_init(void);
+int pad_config_load(const char* filename);
+int pad_config_save(const char* filename);
+int pad_config_set_string(const char* key, const char* value);
+const char* pad_config_get_string(const char* key, const char* default_value);
+int pad_config_set_int(const char* key, int value);
+int pad_config_get_int(const char* key, int default_value);
+int pad_config_set_float(const char* key, float value);
+float pad_config_get_float(const char* key, float default_value);
+int pad_config_remove(const char* key);
+int pad_config_cleanup(void);
+int pad_config_enumerate_keys(void (*callback)(const char* key, const char* value));
+
+// Allocate config values from an arena or pool (NULL restores the heap).
+// Only allowed while the store is empty.
+int pad_config_set_allocator(const pad_allocator* allocator);
+
+// Typed accessor handles: the key is looked up and parsed once, and again
+// only after that key is set, removed or reloaded. Initialize a handle once
+// (e.g. a static or member) and read through it in hot loops. Fields are
+// private to pad_config.c.
+typedef struct pad_config_handle {
+    const char* key;
+    size_t entry;      // Resolved entry index + 1, 0 if the key is missing
+    uint64_t revision;
+    uint64_t layout;
+    int int_value;
+    float float_value;
+} pad_config_handle;
+
+void pad_config_handle_init(pad_config_handle* handle, const char* key);
+int pad_config_handle_get_int(pad_config_handle* handle, int default_value);
+float pad_config_handle_get_float(pad_config_handle* handle, float default_value);
+
+// Hot-reloadable configuration snapshots (pad_config_live.c)
+//
+// Each load builds an immutable snapshot and publishes it with an atomic
+// pointer swap, so readers never lock and never see a half-loaded file.
+// Replaced snapshots are freed by epoch-based reclamation once no reader
+// that could still see them is inside an acquire/release pair.
+typedef struct pad_config_snapshot pad_config_snapshot;
+
+#define PAD_CONFIG_RELOAD_SIGHUP  0x01
+#define PAD_CONFIG_RELOAD_INOTIFY 0x02
+
+// Load filename into a new snapshot and publish it
+int pad_config_live_load(const char* filename);
+// Pin the current snapshot (NULL before the first load); pairs may nest but
+// must be released on the acquiring thread
+const pad_config_snapshot* pad_config_live_acquire(void);
+void pad_config_live_release(void);
+
+const char* pad_config_snapshot_get_string(const pad_config_snapshot* snapshot, const char* key, const char* default_value);
+int pad_config_snapshot_get_int(const pad_config_snapshot* snapshot, const char* key, int default_value);
+float pad_config_snapshot_get_float(const pad_config_snapshot* snapshot, const char* key, float default_value);
+// Increases by one with every published snapshot
+uint64_t pad_config_snapshot_version(const pad_config_snapshot* snapshot);
+
+// Reload filename from a background thread on SIGHUP and/or when the file is
+// rewritten or renamed into place (Linux only; -1 elsewhere)
+int pad_config_live_watch(const char* filename, int flags);
+// Stop the watcher and free every snapshot; no reader may hold one
+void pad_config_live_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_CONFIG_H
@@ -0,0 +1,64 @@
+#ifndef PAD_FIRMWARE_H
+#define PAD_FIRMWARE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Firmware file loader (pad_firmware.c)
+//
+// Reads raw binaries, Intel HEX, Motorola S-records and ELF executables into
+// a sparse segment map: the address ranges that hold data, sorted and
+// non-overlapping, with adjacent records merged. Gaps between regions (say
+// a bootloader, an application and a config page) stay gaps, so a flasher
+// only erases and writes pages that carry data. ELF segments are placed at
+// their load (physical) address, where initialised data lives in flash.
+
+typedef enum {
+    PAD_FIRMWARE_AUTO = 0,  // From the file extension, then the contents
+    PAD_FIRMWARE_BINARY,
+    PAD_FIRMWARE_IHEX,
+    PAD_FIRMWARE_SREC,
+    PAD_FIRMWARE_ELF
+} pad_firmware_format;
+
+typedef struct {
+    uint32_t address;
+    uint32_t length;
+    const uint8_t* data;
+} pad_firmware_segment;
+
+typedef struct pad_firmware pad_firmware;
+
+// Parse a whole file. A raw binary becomes one segment at binary_address.
+// NULL on failure, with a description (and line, for text formats) copied
+// to error if not NULL.
+pad_firmware* pad_firmware_load(const char* filename, pad_firmware_format format,
+                                uint32_t binary_address, char* error, size_t error_size);
+// Same, from memory; name only guides PAD_FIRMWARE_AUTO and may be NULL
+pad_firmware* pad_firmware_parse(const uint8_t* data, size_t length, const char* name,
+                                 pad_firmware_format format, uint32_t binary_address,
+                                 char* error, size_t error_size);
+void pad_firmware_free(pad_firmware* firmware);
+
+// What AUTO picks for a file with this name and contents
+pad_firmware_format pad_firmware_detect(const char* name, const uint8_t* data, size_t length);
+const char* pad_firmware_format_name(pad_firmware_format format);
+
+pad_firmware_format pad_firmware_get_format(const pad_firmware* firmware);
+size_t pad_firmware_segment_count(const pad_firmware* firmware);
+// Sorted by address; valid until pad_firmware_free
+const pad_firmware_segment* pad_firmware_segments(const pad_firmware* firmware);
+// Bytes of data, not counting gaps
+uint64_t pad_firmware_data_size(const pad_firmware* firmware);
+// Start address from the file (ELF entry, HEX/S-record start record), 0 if none
+uint32_t pad_firmware_entry(const pad_firmware* firmware);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_FIRMWARE_H
@@ -0,0 +1,83 @@
+#ifndef PAD_FRAME_H
+#define PAD_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pad_serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Receive ring buffer (pad_frame.c)
+//
+// On Linux the ring's pages are mapped twice back to back, so the readable
+// bytes and the free space are each one contiguous span even when they wrap:
+// read() goes straight into the ring and frames are parsed without stitching.
+// Elsewhere the ring is a flat buffer that is compacted when it runs out of
+// room at the end.
+typedef struct pad_ring pad_ring;
+
+// capacity is rounded up to the page size
+pad_ring* pad_ring_create(size_t capacity);
+void pad_ring_destroy(pad_ring* ring);
+size_t pad_ring_capacity(const pad_ring* ring);
+size_t pad_ring_length(const pad_ring* ring);
+// Free space to read into; make the bytes visible with pad_ring_commit
+uint8_t* pad_ring_write_ptr(pad_ring* ring, size_t* space);
+void pad_ring_commit(pad_ring* ring, size_t length);
+// Buffered bytes; drop them with pad_ring_consume
+uint8_t* pad_ring_read_ptr(const pad_ring* ring, size_t* length);
+void pad_ring_consume(pad_ring* ring, size_t length);
+// Read whatever the port has ready into the ring: bytes read, 0, or -1
+int pad_ring_fill(pad_ring* ring, serial_port_t* port);
+
+// Delimited frame extraction
+//
+// Frames are decoded in place inside the ring and returned as views into it,
+// so nothing is copied. Empty frames (back-to-back delimiters) are skipped.
+typedef enum {
+    PAD_FRAME_SLIP,   // RFC 1055: 0xC0 delimiter, 0xDB escapes
+    PAD_FRAME_COBS,   // Consistent overhead byte stuffing, 0x00 delimiter
+    PAD_FRAME_HDLC    // 0x7E flags, 0x7D escapes with XOR 0x20 (no FCS check)
+} pad_frame_format;
+
+typedef struct {
+    const uint8_t* data;
+    size_t length;
+} pad_frame;
+
+typedef struct pad_framer pad_framer;
+
+// max_frame bounds an encoded frame; longer ones are dropped up to the next
+// delimiter (0 = the ring capacity)
+pad_framer* pad_framer_create(pad_frame_format format, size_t ring_capacity, size_t max_frame);
+void pad_framer_destroy(pad_framer* framer);
+// The ring frames are parsed from; fill it directly or with pad_framer_fill
+pad_ring* pad_framer_ring(pad_framer* framer);
+int pad_framer_fill(pad_framer* framer, serial_port_t* port);
+// 1 with the next frame, 0 if no complete frame is buffered, -1 if a
+// malformed or oversized frame was dropped (call again to continue). The
+// view stays valid until the next pad_framer_next, pad_framer_fill or
+// direct write to the ring.
+int pad_framer_next(pad_framer* framer, pad_frame* frame);
+// Drop the frame last returned by pad_framer_next from the ring, so that
+// bytes read from the ring directly start after it
+void pad_framer_release(pad_framer* framer);
+// Drop everything buffered, e.g. bytes received at a previous line rate
+void pad_framer_reset(pad_framer* framer);
+// Frames returned and frames dropped so far
+uint64_t pad_framer_frames(const pad_framer* framer);
+uint64_t pad_framer_errors(const pad_framer* framer);
+
+// Encode one frame, delimiters included; returns the encoded length or -1
+// if dest is too small (pad_frame_encoded_max bytes always suffice)
+size_t pad_frame_encoded_max(pad_frame_format format, size_t length);
+int pad_frame_encode(pad_frame_format format, const uint8_t* data, size_t length,
+                     uint8_t* dest, size_t dest_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_FRAME_H
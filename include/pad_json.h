@@ -0,0 +1,60 @@
+#ifndef PAD_JSON_H
+#define PAD_JSON_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming SAX-style JSON reader (pad_json.c)
+//
+// Input is pushed in chunks of any size and reported as events while it is
+// parsed, so a document never has to be held in memory. The parser owns one
+// token buffer and one key buffer, grown to the longest string seen; nothing
+// is allocated per value. `//` and `/* */` comments are accepted as an
+// extension, since hand-edited manifests tend to contain them.
+
+typedef enum {
+    PAD_JSON_NULL,
+    PAD_JSON_FALSE,
+    PAD_JSON_TRUE,
+    PAD_JSON_NUMBER,       // value holds the number's text
+    PAD_JSON_STRING,       // value holds the unescaped UTF-8 string
+    PAD_JSON_OBJECT_BEGIN,
+    PAD_JSON_OBJECT_END,
+    PAD_JSON_ARRAY_BEGIN,
+    PAD_JSON_ARRAY_END
+} pad_json_event;
+
+// Called for every event. key is the member name when the value sits directly
+// in an object, otherwise NULL (always NULL for *_END). value is
+// NUL-terminated, and NULL for events without text. depth is 0 for the root
+// value, 1 for its members or elements, and so on; an *_END event has the
+// depth of its *_BEGIN. key and value are only valid during the call.
+// Return non-zero to stop parsing.
+typedef int (*pad_json_callback)(void* user, pad_json_event event, const char* key,
+                                 const char* value, size_t value_length, int depth);
+
+typedef struct pad_json_parser pad_json_parser;
+
+pad_json_parser* pad_json_parser_create(pad_json_callback callback, void* user);
+void pad_json_parser_destroy(pad_json_parser* parser);
+// Parse the next chunk; -1 on a syntax error or when the callback stops
+int pad_json_parser_feed(pad_json_parser* parser, const char* data, size_t length);
+// End of input; -1 unless exactly one complete value was parsed
+int pad_json_parser_finish(pad_json_parser* parser);
+// Description and 1-based line of the first error
+const char* pad_json_parser_error(const pad_json_parser* parser);
+size_t pad_json_parser_line(const pad_json_parser* parser);
+
+// Stream a whole file through a parser; the error is copied to error (if
+// not NULL) on failure
+int pad_json_parse_file(const char* filename, pad_json_callback callback, void* user,
+                        char* error, size_t error_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_JSON_H
@@ -0,0 +1,36 @@
+#ifndef PAD_LZ_H
+#define PAD_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Block compression for firmware transfers (pad_lz.c)
+//
+// The output is an LZ4 block: token, literals, 16-bit offset, match length,
+// with no frame around it. Blocks are independent, so a bootloader expands
+// each one straight into its block buffer with no dictionary or heap; any
+// LZ4 block decoder will do. The compressor is a greedy single-pass one,
+// good for the 0xFF padding and repeated tables of firmware images.
+
+// Largest output pad_lz_compress can produce for input_size bytes
+size_t pad_lz_bound(size_t input_size);
+
+// Compress input into output. Returns the compressed size, or 0 if it does
+// not fit in output_capacity (pass input_size - 1 to keep only gains).
+size_t pad_lz_compress(const uint8_t* input, size_t input_size,
+                       uint8_t* output, size_t output_capacity);
+
+// Expand a block into output. Returns 0 with the expanded size in
+// output_size, or -1 if the block is malformed or would overflow output.
+int pad_lz_decompress(const uint8_t* input, size_t input_size,
+                      uint8_t* output, size_t output_capacity, size_t* output_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_LZ_H
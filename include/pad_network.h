@@ -0,0 +1,31 @@
+#ifndef PAD_NETWORK_H
+#define PAD_NETWORK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pad_alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct network_socket network_socket_t;
+
+// TCP networking (pad_network.c)
+int pad_network_init(void);
+int pad_network_cleanup(void);
+network_socket_t* pad_tcp_create_socket(void);
+// Same as pad_tcp_create_socket, with the socket object taken from an arena or pool
+network_socket_t* pad_tcp_create_socket_with(const pad_allocator* allocator);
+int pad_tcp_connect(network_socket_t* net_sock, const char* host, uint16_t port);
+int pad_tcp_send(network_socket_t* net_sock, const uint8_t* data, size_t length);
+int pad_tcp_receive(network_socket_t* net_sock, uint8_t* buffer, size_t max_length);
+int pad_tcp_close(network_socket_t* net_sock);
+int pad_set_nonblocking(network_socket_t* net_sock);
+int pad_socket_ready_read(network_socket_t* net_sock, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_NETWORK_H
@@ -0,0 +1,92 @@
+#ifndef PAD_SERIAL_H
+#define PAD_SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pad_alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct serial_port serial_port_t;
+
+// Serial port access (pad_serial.c)
+serial_port_t* pad_serial_open(const char* port_name, int baud_rate);
+// Same as pad_serial_open, with the port object taken from an arena or pool
+serial_port_t* pad_serial_open_with(const char* port_name, int baud_rate,
+                                    const pad_allocator* allocator);
+int pad_serial_close(serial_port_t* port);
+int pad_serial_write(serial_port_t* port, const uint8_t* data, size_t length);
+int pad_serial_read(serial_port_t* port, uint8_t* buffer, size_t max_length);
+// Discard unsent output and unread input (not a drain)
+int pad_serial_flush(serial_port_t* port);
+// Any rate the adapter supports, not just the standard ones (termios2 on
+// Linux); pad_serial_open accepts the same rates
+int pad_serial_set_baud(serial_port_t* port, int baud_rate);
+// Have the driver pass received bytes on immediately instead of batching them
+// (ASYNC_LOW_LATENCY; FTDI adapters otherwise hold input for up to 16 ms).
+// -1 if the driver has no such mode.
+int pad_serial_set_low_latency(serial_port_t* port, int enabled);
+// Block until everything written has left the UART. Writes never wait on
+// their own; call this only where the protocol needs the line idle.
+int pad_serial_drain(serial_port_t* port);
+// 1 once input is available, 0 after timeout_ms (-1 = no limit), -1 on error
+int pad_serial_wait_readable(serial_port_t* port, int timeout_ms);
+// Stable identity of the adapter behind port_name ("usb-0403:6001-A10K3XYZ"),
+// which survives re-plugging into another socket. -1 for ports that are not
+// USB adapters with a serial number (Linux only).
+int pad_serial_adapter_id(const char* port_name, char* id, size_t size);
+
+// Event-driven multi-port I/O (pad_serial.c, Linux only)
+//
+// A reactor drives many ports from one thread with epoll. Registered ports
+// are switched to non-blocking reads (pad_serial_read returns at once, -1
+// with errno EAGAIN when empty) and restored on removal. Output goes through
+// a per-port queue bounded by output_limit: pad_serial_reactor_send refuses
+// data that would exceed it, and PAD_SERIAL_WRITABLE is delivered once the
+// queue has drained to half. Reading can be paused per port so unread input
+// backs up into the driver instead of into memory. A reactor is not
+// thread-safe except for pad_serial_reactor_stop; to use several threads,
+// run one reactor per thread and split the ports between them.
+typedef struct pad_serial_reactor pad_serial_reactor;
+
+#define PAD_SERIAL_READABLE 0x01 // Input available (level-triggered)
+#define PAD_SERIAL_WRITABLE 0x02 // Output queue drained after a refused send
+#define PAD_SERIAL_TIMEOUT  0x04 // The port's timeout expired
+#define PAD_SERIAL_ERROR    0x08 // Hangup or I/O error; remove the port
+
+typedef void (*pad_serial_callback)(pad_serial_reactor* reactor, serial_port_t* port,
+                                    int events, void* user);
+
+// output_limit is the per-port send queue bound in bytes (0 = 64 KB)
+pad_serial_reactor* pad_serial_reactor_create(size_t output_limit);
+// Destroy the reactor; registered ports are removed but not closed
+void pad_serial_reactor_destroy(pad_serial_reactor* reactor);
+int pad_serial_reactor_add(pad_serial_reactor* reactor, serial_port_t* port,
+                           pad_serial_callback callback, void* user);
+// Safe to call from a callback, including for the port being dispatched
+int pad_serial_reactor_remove(pad_serial_reactor* reactor, serial_port_t* port);
+// One-shot timeout; re-arming replaces the previous one, 0 cancels
+int pad_serial_reactor_set_timeout(pad_serial_reactor* reactor, serial_port_t* port,
+                                   uint32_t timeout_ms);
+int pad_serial_reactor_set_reading(pad_serial_reactor* reactor, serial_port_t* port,
+                                   int enabled);
+// Queue data for the port, writing what the driver takes right away.
+// Returns -1 without queueing anything if the queue would exceed output_limit.
+int pad_serial_reactor_send(pad_serial_reactor* reactor, serial_port_t* port,
+                            const uint8_t* data, size_t length);
+size_t pad_serial_reactor_pending(const pad_serial_reactor* reactor, const serial_port_t* port);
+// Wait up to timeout_ms (-1 = until an event) and dispatch; returns the
+// number of callbacks made, or -1
+int pad_serial_reactor_run_once(pad_serial_reactor* reactor, int timeout_ms);
+// Dispatch until pad_serial_reactor_stop
+int pad_serial_reactor_run(pad_serial_reactor* reactor);
+// Thread- and signal-safe
+void pad_serial_reactor_stop(pad_serial_reactor* reactor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAD_SERIAL_H
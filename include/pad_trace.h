@@ -0,0 +1,61 @@
+#ifndef PAD_TRACE_H
+#define PAD_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pad_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Low-overhead span/event tracing (pad_trace.c)
+//
+// Each thread records into its own fixed-size ring buffer; writers never take
+// a lock, and the oldest events are overwritten when a ring is full. Event and
+// thread names are stored by pointer, so they must be string literals or
+// otherwise outlive the trace. pad_trace_dump_json() writes the Chrome trace
+// event format, which loads in chrome://tracing and ui.perfetto.dev.
+
+// Enable tracing; events_per_thread is rounded up to a power of two (0 = 64K)
+int pad_trace_init(size_t events_per_thread);
+// Disable tracing and free all rings; no traced thread may be running
+void pad_trace_shutdown(void);
+int pad_trace_enabled(void);
+
+void pad_trace_set_thread_name(const char* name);
+void pad_trace_begin(const char* name);
+void pad_trace_end(const char* name);
+void pad_trace_instant(const char* name);
+void pad_trace_complete(const char* name, uint64_t start_ns, uint64_t duration_ns);
+void pad_trace_counter(const char* name, int64_t value);
+
+int pad_trace_dump_json(const char* filename);
+
+#ifdef __cplusplus
+}
+
+// Scoped span: records a complete event from construction to destruction
+class PadTraceSpan {
+public:
+    explicit PadTraceSpan(const char* name)
+        : name_(name), start_ns_(pad_trace_enabled() ? pad_now_ns() : 0) {}
+    ~PadTraceSpan() {
+        if (start_ns_ != 0) {
+            pad_trace_complete(name_, start_ns_, pad_now_ns() - start_ns_);
+        }
+    }
+    PadTraceSpan(const PadTraceSpan&) = delete;
+    PadTraceSpan& operator=(const PadTraceSpan&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_ns_;
+};
+
+#define PAD_TRACE_CONCAT_(a, b) a##b
+#define PAD_TRACE_CONCAT(a, b) PAD_TRACE_CONCAT_(a, b)
+#define PAD_TRACE_SPAN(name) PadTraceSpan PAD_TRACE_CONCAT(pad_trace_span_, __LINE__)(name)
+#endif
+
+#endif // PAD_TRACE_H
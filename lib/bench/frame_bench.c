@@ -0,0 +1,121 @@
+// Serial framing benchmark: bytes/s and frames/s through the receive ring,
+// and the CPU share a fully loaded 3 Mbaud link would take
+//
+// Usage: pad_frame_bench [stream_MB] [read_size]
+
+#include "../../include/pad_frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 3 Mbaud with 8N1 framing moves 10 bits per byte
+#define LINE_BYTES_PER_SECOND (3000000.0 / 10.0)
+
+static const char* format_names[] = {"SLIP", "COBS", "0x7E"};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Encode random frames of `payload` bytes until `length` bytes are filled
+static size_t build_stream(pad_frame_format format, size_t payload, uint8_t* stream,
+                           size_t length, size_t* frame_count) {
+    uint8_t* frame = (uint8_t*)malloc(payload);
+    size_t used = 0, count = 0;
+    for (;;) {
+        for (size_t i = 0; i < payload; i++) {
+            frame[i] = (uint8_t)rand();
+        }
+        size_t room = length - used;
+        if (room < pad_frame_encoded_max(format, payload)) break;
+        used += (size_t)pad_frame_encode(format, frame, payload, stream + used, room);
+        count++;
+    }
+    free(frame);
+    *frame_count = count;
+    return used;
+}
+
+// Push the stream through a framer in read()-sized chunks; returns seconds
+static double run_variant(pad_frame_format format, const uint8_t* stream, size_t length,
+                          size_t read_size, size_t* frames, uint64_t* checksum) {
+    pad_framer* framer = pad_framer_create(format, 64 * 1024, 0);
+    pad_ring* ring = pad_framer_ring(framer);
+    uint64_t sum = 0;
+    size_t count = 0;
+
+    double start = now_seconds();
+    for (size_t offset = 0; offset < length;) {
+        size_t space;
+        uint8_t* dest = pad_ring_write_ptr(ring, &space);
+        size_t n = length - offset;
+        if (n > read_size) n = read_size;
+        if (n > space) n = space;
+        memcpy(dest, stream + offset, n); // Stands in for read(fd, dest, n)
+        pad_ring_commit(ring, n);
+        offset += n;
+
+        pad_frame frame;
+        while (pad_framer_next(framer, &frame) > 0) {
+            sum += frame.length + frame.data[frame.length - 1];
+            count++;
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    pad_framer_destroy(framer);
+    *frames = count;
+    *checksum = sum;
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : 64;
+    size_t read_size = argc > 2 ? (size_t)atoi(argv[2]) : 4096;
+    if (mb == 0 || read_size == 0) {
+        fprintf(stderr, "Usage: %s [stream_MB] [read_size]\n", argv[0]);
+        return 1;
+    }
+
+    size_t capacity = mb * 1024 * 1024;
+    uint8_t* stream = (uint8_t*)malloc(capacity);
+    if (!stream) {
+        fprintf(stderr, "Cannot allocate %zu MB\n", mb);
+        return 1;
+    }
+
+    static const size_t payloads[] = {16, 64, 256, 1024};
+    printf("Framing benchmark: %zu MB stream, %zu-byte reads, 3 Mbaud = %.0f bytes/s\n",
+           mb, read_size, LINE_BYTES_PER_SECOND);
+    printf("%-6s %8s %12s %14s %14s %10s\n", "format", "payload", "MB/s",
+           "frames/s", "frames/s@3M", "CPU@3M");
+
+    int failures = 0;
+    srand(1);
+    for (int format = PAD_FRAME_SLIP; format <= PAD_FRAME_HDLC; format++) {
+        for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+            size_t expected;
+            size_t length = build_stream((pad_frame_format)format, payloads[p], stream,
+                                         capacity, &expected);
+            size_t frames;
+            uint64_t checksum;
+            double elapsed = run_variant((pad_frame_format)format, stream, length,
+                                         read_size, &frames, &checksum);
+            (void)checksum;
+            failures += frames != expected;
+
+            double bytes_per_second = (double)length / elapsed;
+            double line_frames = LINE_BYTES_PER_SECOND * (double)frames / (double)length;
+            printf("%-6s %8zu %12.1f %14.0f %14.0f %9.3f%%%s\n", format_names[format],
+                   payloads[p], bytes_per_second / 1e6, (double)frames / elapsed, line_frames,
+                   100.0 * LINE_BYTES_PER_SECOND / bytes_per_second,
+                   frames == expected ? "" : "  MISMATCH");
+        }
+    }
+
+    free(stream);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,332 @@
+#include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include "../include/pad_alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+static size_t align_up(size_t value) {
+    return (value + PAD_ALLOC_ALIGN - 1) & ~(size_t)(PAD_ALLOC_ALIGN - 1);
+}
+
+// ---------------------------------------------------------------------------
+// Arena
+// ---------------------------------------------------------------------------
+
+typedef struct pad_arena_block {
+    struct pad_arena_block* next;
+    size_t size;
+    size_t used;
+} pad_arena_block;
+
+#define ARENA_HEADER_SIZE align_up(sizeof(pad_arena_block))
+
+struct pad_arena {
+    size_t block_size;
+    pad_arena_block* first;
+    pad_arena_block* current;
+    size_t used;
+};
+
+static pad_arena_block* arena_new_block(size_t size) {
+    pad_arena_block* block = (pad_arena_block*)pad_malloc(ARENA_HEADER_SIZE + size);
+    if (!block) return NULL;
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+// Create an arena that grows in block_size chunks (0 selects 64 KB)
+pad_arena* pad_arena_create(size_t block_size) {
+    pad_arena* arena = (pad_arena*)pad_malloc(sizeof(pad_arena));
+    if (!arena) return NULL;
+
+    arena->block_size = align_up(block_size ? block_size : 64 * 1024);
+    arena->first = arena_new_block(arena->block_size);
+    if (!arena->first) {
+        pad_free(arena);
+        return NULL;
+    }
+    arena->current = arena->first;
+    arena->used = 0;
+    return arena;
+}
+
+void pad_arena_destroy(pad_arena* arena) {
+    if (!arena) return;
+
+    pad_arena_block* block = arena->first;
+    while (block) {
+        pad_arena_block* next = block->next;
+        pad_free(block);
+        block = next;
+    }
+    pad_free(arena);
+}
+
+void* pad_arena_alloc(pad_arena* arena, size_t size) {
+    if (!arena || size == 0) return NULL;
+    size = align_up(size);
+
+    // Walk forward through blocks kept from before the last reset
+    pad_arena_block* block = arena->current;
+    while (block->used + size > block->size && block->next &&
+           block->next->size >= size) {
+        block = block->next;
+    }
+
+    if (block->used + size > block->size) {
+        size_t block_size = size > arena->block_size ? size : arena->block_size;
+        pad_arena_block* fresh = arena_new_block(block_size);
+        if (!fresh) return NULL;
+        fresh->next = block->next;
+        block->next = fresh;
+        block = fresh;
+    }
+
+    arena->current = block;
+    void* ptr = (uint8_t*)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    arena->used += size;
+    return ptr;
+}
+
+char* pad_arena_strdup(pad_arena* arena, const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str) + 1;
+    char* copy = (char*)pad_arena_alloc(arena, len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+// Release every allocation; regular blocks are kept for reuse, oversized ones freed
+void pad_arena_reset(pad_arena* arena) {
+    if (!arena) return;
+
+    pad_arena_block* prev = NULL;
+    pad_arena_block* block = arena->first;
+    while (block) {
+        pad_arena_block* next = block->next;
+        if (block != arena->first && block->size > arena->block_size) {
+            prev->next = next;
+            pad_free(block);
+        } else {
+            block->used = 0;
+            prev = block;
+        }
+        block = next;
+    }
+    arena->current = arena->first;
+    arena->used = 0;
+}
+
+size_t pad_arena_used(const pad_arena* arena) {
+    return arena ? arena->used : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Pool
+// ---------------------------------------------------------------------------
+
+// The global free list is a Treiber stack of slot indices. The head packs
+// (tag << 32) | (index + 1) so a stale head never wins a CAS (ABA).
+struct pad_pool {
+    uint32_t id;
+    uint32_t capacity;
+    size_t object_size;
+    uint8_t* slab;
+    _Atomic uint64_t free_head;
+    _Atomic size_t heap_fallbacks;
+};
+
+#define POOL_CACHE_SLOTS 4
+#define POOL_CACHE_SIZE 32
+
+// Per-thread magazine of free slot indices, keyed by pool id (never reused,
+// so a cache left behind by a destroyed pool is simply never matched again)
+typedef struct {
+    uint32_t pool_id;
+    uint32_t count;
+    uint32_t items[POOL_CACHE_SIZE];
+} pool_cache;
+
+static PAD_THREAD_LOCAL pool_cache pool_caches[POOL_CACHE_SLOTS];
+static _Atomic uint32_t next_pool_id = 1;
+
+static _Atomic uint32_t* pool_next_link(pad_pool* pool, uint32_t index) {
+    return (_Atomic uint32_t*)(pool->slab + (size_t)index * pool->object_size);
+}
+
+static void pool_push(pad_pool* pool, uint32_t index) {
+    uint64_t old_head = atomic_load_explicit(&pool->free_head, memory_order_relaxed);
+    uint64_t new_head;
+    do {
+        atomic_store_explicit(pool_next_link(pool, index), (uint32_t)old_head,
+                              memory_order_relaxed);
+        new_head = (((old_head >> 32) + 1) << 32) | (uint64_t)(index + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &old_head, new_head,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static int pool_pop(pad_pool* pool, uint32_t* index) {
+    uint64_t old_head = atomic_load_explicit(&pool->free_head, memory_order_acquire);
+    uint64_t new_head;
+    do {
+        uint32_t top = (uint32_t)old_head;
+        if (top == 0) return 0;
+        uint32_t next = atomic_load_explicit(pool_next_link(pool, top - 1),
+                                             memory_order_relaxed);
+        new_head = (((old_head >> 32) + 1) << 32) | next;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &old_head, new_head,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+    *index = (uint32_t)old_head - 1;
+    return 1;
+}
+
+// Find this thread's cache for the pool, claiming an empty slot if needed
+static pool_cache* pool_thread_cache(const pad_pool* pool) {
+    pool_cache* empty = NULL;
+    for (int i = 0; i < POOL_CACHE_SLOTS; i++) {
+        if (pool_caches[i].pool_id == pool->id) {
+            return &pool_caches[i];
+        }
+        if (!empty && pool_caches[i].count == 0) {
+            empty = &pool_caches[i];
+        }
+    }
+    if (empty) {
+        empty->pool_id = pool->id;
+    }
+    return empty;
+}
+
+pad_pool* pad_pool_create(size_t object_size, uint32_t capacity) {
+    if (object_size == 0 || capacity == 0) return NULL;
+
+    pad_pool* pool = (pad_pool*)pad_malloc(sizeof(pad_pool));
+    if (!pool) return NULL;
+
+    pool->object_size = align_up(object_size);
+    pool->capacity = capacity;
+    pool->slab = (uint8_t*)pad_malloc(pool->object_size * capacity);
+    if (!pool->slab) {
+        pad_free(pool);
+        return NULL;
+    }
+    pool->id = atomic_fetch_add(&next_pool_id, 1);
+    atomic_init(&pool->heap_fallbacks, 0);
+
+    // Thread all slots onto the free list, lowest index on top
+    for (uint32_t i = 0; i < capacity; i++) {
+        atomic_init(pool_next_link(pool, i), i + 1 < capacity ? i + 2 : 0);
+    }
+    atomic_init(&pool->free_head, 1);
+    return pool;
+}
+
+// Destroy the pool; objects still allocated from its slab become invalid
+void pad_pool_destroy(pad_pool* pool) {
+    if (!pool) return;
+
+    pool_cache* cache = pool_thread_cache(pool);
+    if (cache) {
+        cache->pool_id = 0;
+        cache->count = 0;
+    }
+    pad_free(pool->slab);
+    pad_free(pool);
+}
+
+void* pad_pool_alloc(pad_pool* pool) {
+    if (!pool) return NULL;
+
+    uint32_t index;
+    pool_cache* cache = pool_thread_cache(pool);
+    if (cache) {
+        // Refill half a magazine at a time to amortize the CAS traffic
+        while (cache->count < POOL_CACHE_SIZE / 2 && pool_pop(pool, &index)) {
+            cache->items[cache->count++] = index;
+        }
+        if (cache->count > 0) {
+            index = cache->items[--cache->count];
+            return pool->slab + (size_t)index * pool->object_size;
+        }
+    } else if (pool_pop(pool, &index)) {
+        return pool->slab + (size_t)index * pool->object_size;
+    }
+
+    atomic_fetch_add_explicit(&pool->heap_fallbacks, 1, memory_order_relaxed);
+    return pad_malloc(pool->object_size);
+}
+
+void pad_pool_free(pad_pool* pool, void* ptr) {
+    if (!ptr) return;
+
+    uint8_t* p = (uint8_t*)ptr;
+    if (!pool || p < pool->slab || p >= pool->slab + pool->object_size * pool->capacity) {
+        pad_free(ptr);
+        return;
+    }
+
+    uint32_t index = (uint32_t)((size_t)(p - pool->slab) / pool->object_size);
+    pool_cache* cache = pool_thread_cache(pool);
+    if (!cache) {
+        pool_push(pool, index);
+        return;
+    }
+    if (cache->count == POOL_CACHE_SIZE) {
+        while (cache->count > POOL_CACHE_SIZE / 2) {
+            pool_push(pool, cache->items[--cache->count]);
+        }
+    }
+    cache->items[cache->count++] = index;
+}
+
+void pad_pool_flush_thread_cache(pad_pool* pool) {
+    if (!pool) return;
+
+    for (int i = 0; i < POOL_CACHE_SLOTS; i++) {
+        if (pool_caches[i].pool_id == pool->id) {
+            while (pool_caches[i].count > 0) {
+                pool_push(pool, pool_caches[i].items[--pool_caches[i].count]);
+            }
+            pool_caches[i].pool_id = 0;
+        }
+    }
+}
+
+size_t pad_pool_heap_fallbacks(const pad_pool* pool) {
+    return pool ? atomic_load_explicit(&((pad_pool*)pool)->heap_fallbacks,
+                                       memory_order_relaxed) : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Allocator selector used by config, serial and network objects
+// ---------------------------------------------------------------------------
+
+void* pad_allocator_alloc(const pad_allocator* allocator, size_t size) {
+    if (allocator && allocator->arena) {
+        return pad_arena_alloc(allocator->arena, size);
+    }
+    if (allocator && allocator->pool && size <= allocator->pool->object_size) {
+        return pad_pool_alloc(allocator->pool);
+    }
+    return pad_malloc(size);
+}
+
+void pad_allocator_free(const pad_allocator* allocator, void* ptr) {
+    if (allocator && allocator->arena) {
+        return;
+    }
+    if (allocator && allocator->pool) {
+        pad_pool_free(allocator->pool, ptr);
+        return;
+    }
+    pad_free(ptr);
+}
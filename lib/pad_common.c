@@ -1,4 +1,5 @@
 #include "../include/common_types.h"
+#include "../include/pad_common.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,6 +9,7 @@
 #else
     #include <unistd.h>
     #include <sys/time.h>
+    #include <time.h>
 #endif
 
 // Cross-platform sleep function
@@ -35,6 +37,24 @@ uint64_t pad_get_timestamp_ms(void) {
 #endif
 }
 
+// Monotonic nanosecond clock for interval timing; unaffected by NTP slew/steps
+uint64_t pad_now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency); // Fixed at boot, cheap to query
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+#else
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0)
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 // Safe string copy function
 int pad_strncpy(char* dest, const char* src, size_t dest_size) {
     if (dest == NULL || src == NULL || dest_size == 0) {
@@ -46,32 +66,72 @@ int pad_strncpy(char* dest, const char* src, size_t dest_size) {
     return 0;
 }
 
-// Calculate CRC32 checksum
+// Calculate CRC32 checksum (see pad_crc32.cpp for the kernels)
 uint32_t pad_crc32(const uint8_t* data, size_t length) {
-    static uint32_t crc_table[256];
-    static int initialized = 0;
-    
-    if (!initialized) {
-        // Initialize CRC32 table
-        for (int i = 0; i < 256; i++) {
-            uint32_t c = i;
-            for (int j = 0; j < 8; j++) {
-                if (c & 1) {
-                    c = 0xEDB88320L ^ (c >> 1);
-                } else {
-                    c >>= 1;
-                }
+    return pad_crc32_final(pad_crc32_update(pad_crc32_init(), data, length));
+}
+
+// Multiply two polynomials modulo the CRC32 polynomial (reflected bit order)
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
             }
-            crc_table[i] = c;
         }
-        initialized = 1;
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0xEDB88320u : b >> 1;
     }
-    
-    uint32_t crc = 0xFFFFFFFF;
-    for (size_t i = 0; i < length; i++) {
-        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return p;
+}
+
+// x^(8 * n_bytes) modulo the CRC32 polynomial, by repeated squaring
+static uint32_t crc32_x8nmodp(uint64_t n_bytes) {
+    uint32_t p = (uint32_t)1 << 31;  // x^0
+    uint32_t xp = (uint32_t)1 << 23; // x^8
+    while (n_bytes) {
+        if (n_bytes & 1) {
+            p = crc32_multmodp(xp, p);
+        }
+        xp = crc32_multmodp(xp, xp);
+        n_bytes >>= 1;
     }
-    return crc ^ 0xFFFFFFFF;
+    return p;
+}
+
+// CRC32 of A||B given crc(A), crc(B) and len(B), in O(log len_b)
+uint32_t pad_crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b) {
+    return crc32_multmodp(crc32_x8nmodp(len_b), crc_a) ^ crc_b;
+}
+
+// Update the CRC32 of a total_length-byte image after replacing patch_length
+// bytes at offset (old_bytes -> new_bytes), without rehashing the image
+uint32_t pad_crc32_patch(uint32_t crc, uint64_t total_length, uint64_t offset,
+                         const uint8_t* old_bytes, const uint8_t* new_bytes,
+                         size_t patch_length) {
+    if (!old_bytes || !new_bytes || offset + patch_length > total_length) {
+        return crc;
+    }
+
+    // CRC is affine, so crc(new) = crc(old) ^ linear_crc(old ^ new, shifted to its position)
+    uint8_t delta[256];
+    uint32_t linear = 0;
+    size_t done = 0;
+    while (done < patch_length) {
+        size_t n = patch_length - done;
+        if (n > sizeof(delta)) n = sizeof(delta);
+        for (size_t i = 0; i < n; i++) {
+            delta[i] = old_bytes[done + i] ^ new_bytes[done + i];
+        }
+        linear = pad_crc32_update(linear, delta, n);
+        done += n;
+    }
+
+    uint64_t trailing = total_length - offset - patch_length;
+    return crc ^ crc32_multmodp(crc32_x8nmodp(trailing), linear);
 }
 
 // Memory allocation with error checking
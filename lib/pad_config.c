@@ -1,61 +1,339 @@
 #include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include "../include/pad_config.h"
+#include "pad_config_store.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Simple configuration structure
-typedef struct config_item {
-    char name[64];
-    char value[256];
-    struct config_item* next;
-} config_item;
 
-static config_item* config_head = NULL;
+#define CONFIG_SLOT_EMPTY     0u
+#define CONFIG_SLOT_TOMBSTONE 0xFFFFFFFFu
 
-// Initialize configuration system
-int pad_config_init(void) {
-    // Clean up any existing configuration
-    pad_config_cleanup();
+// The store behind the pad_config_* API
+static config_store config_global = { 0 };
+
+// FNV-1a
+uint32_t config_hash(const char* key) {
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Find the index slot holding key, or -1
+static long config_find_slot(const config_store* store, const char* key, uint32_t hash) {
+    if (store->index_size == 0) return -1;
+
+    size_t mask = store->index_size - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        uint32_t slot = store->index[i];
+        if (slot == CONFIG_SLOT_EMPTY) {
+            return -1;
+        }
+        if (slot != CONFIG_SLOT_TOMBSTONE) {
+            const config_entry* entry = &store->entries[slot - 1];
+            if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+                return (long)i;
+            }
+        }
+    }
+}
+
+config_entry* config_store_find(const config_store* store, const char* key) {
+    long slot = config_find_slot(store, key, config_hash(key));
+    return slot < 0 ? NULL : &store->entries[store->index[slot] - 1];
+}
+
+// Drop removed entries and rebuild the index with room for min_entries
+static int config_rebuild(config_store* store, size_t min_entries) {
+    size_t live = 0;
+    for (size_t i = 0; i < store->count; i++) {
+        if (store->entries[i].key) {
+            store->entries[live++] = store->entries[i];
+        }
+    }
+    if (live != store->count) {
+        store->layout++;
+    }
+    store->count = live;
+
+    size_t size = 16;
+    while (size * 3 < min_entries * 4 + 4) {
+        size <<= 1;
+    }
+
+    uint32_t* index = (uint32_t*)calloc(size, sizeof(uint32_t));
+    if (!index) return -1;
+
+    for (size_t i = 0; i < store->count; i++) {
+        size_t mask = size - 1;
+        size_t slot = store->entries[i].hash & mask;
+        while (index[slot] != CONFIG_SLOT_EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = (uint32_t)(i + 1);
+    }
+
+    free(store->index);
+    store->index = index;
+    store->index_size = size;
+    store->index_used = store->count;
     return 0;
 }
 
-// Load configuration from a file
-int pad_config_load(const char* filename) {
-    if (!filename) return -1;
+// Copy value into the entry, reusing its buffer when the new value fits
+static int config_store_value(config_store* store, config_entry* entry, const char* value) {
+    size_t length = strlen(value) + 1;
+    if (length > entry->value_capacity) {
+        char* buffer = (char*)pad_allocator_alloc(&store->allocator, length);
+        if (!buffer) return -1;
+        if (entry->value_capacity) {
+            pad_allocator_free(&store->allocator, entry->value);
+        }
+        entry->value = buffer;
+        entry->value_capacity = length;
+    }
+    memcpy(entry->value, value, length);
+    entry->revision = ++store->revision;
+    return 0;
+}
+
+// Append a new entry (key not present) and index it; key is interned
+// unless borrow_key is set. The caller fills in the value.
+static config_entry* config_insert(config_store* store, const char* key, uint32_t hash, int borrow_key) {
+    // Keep the index at most 3/4 full (tombstones included)
+    if ((store->index_used + 1) * 4 > store->index_size * 3) {
+        if (config_rebuild(store, (store->live + 1) * 2) != 0) return NULL;
+    }
+    if (store->count == store->capacity && store->count - store->live > store->count / 2) {
+        // Mostly removed entries: compact instead of growing
+        if (config_rebuild(store, (store->live + 1) * 2) != 0) return NULL;
+    }
+    if (store->count == store->capacity) {
+        size_t capacity = store->capacity ? store->capacity * 2 : 64;
+        config_entry* entries = (config_entry*)realloc(store->entries, capacity * sizeof(config_entry));
+        if (!entries) return NULL;
+        store->entries = entries;
+        store->capacity = capacity;
+    }
+    
+    config_entry* entry = &store->entries[store->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->hash = hash;
+    entry->revision = ++store->revision;
+    store->inserts = entry->revision;
+    if (borrow_key) {
+        entry->key = key;
+    } else {
+        if (!store->keys) {
+            store->keys = pad_arena_create(0);
+            if (!store->keys) return NULL;
+        }
+        entry->key = pad_arena_strdup(store->keys, key);
+        if (!entry->key) return NULL;
+    }
+    
+    size_t mask = store->index_size - 1;
+    size_t slot = hash & mask;
+    while (store->index[slot] != CONFIG_SLOT_EMPTY && store->index[slot] != CONFIG_SLOT_TOMBSTONE) {
+        slot = (slot + 1) & mask;
+    }
+    if (store->index[slot] == CONFIG_SLOT_EMPTY) {
+        store->index_used++;
+    }
+    store->index[slot] = (uint32_t)(store->count + 1);
+    store->count++;
+    store->live++;
+    return entry;
+}
+
+int config_store_set(config_store* store, const char* key, const char* value) {
+    config_entry* existing = config_store_find(store, key);
+    if (existing) {
+        return config_store_value(store, existing, value);
+    }
+    
+    config_entry* entry = config_insert(store, key, config_hash(key), 0);
+    if (!entry) return -1;
+    if (config_store_value(store, entry, value) != 0) {
+        config_store_remove(store, key);
+        return -1;
+    }
+    return 0;
+}
+
+int config_store_remove(config_store* store, const char* key) {
+    long slot = config_find_slot(store, key, config_hash(key));
+    if (slot < 0) return -1; // Key not found
     
-    FILE* file = fopen(filename, "r");
+    config_entry* entry = &store->entries[store->index[slot] - 1];
+    if (entry->value_capacity) {
+        pad_allocator_free(&store->allocator, entry->value);
+    }
+    entry->key = NULL; // Interned key stays in the arena until cleanup
+    entry->value = NULL;
+    entry->value_capacity = 0;
+    entry->revision = ++store->revision;
+    store->index[slot] = CONFIG_SLOT_TOMBSTONE;
+    store->live--;
+    return 0;
+}
+
+// Read a whole file into a heap image. Entries point into it, so it is a
+// copy: a mapping would follow later writes to the file (pad_config_save to
+// the same path, say) and fault if the file were truncated.
+static int config_read_image(const char* filename, config_image* image) {
+    FILE* file = fopen(filename, "rb");
     if (!file) return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(file);
+        return -1;
+    }
+    image->size = (size_t)size;
+    if (image->size > 0) {
+        image->data = (char*)pad_malloc(image->size);
+        if (!image->data || fread(image->data, 1, image->size, file) != image->size) {
+            pad_free(image->data);
+            fclose(file);
+            return -1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+static void config_close_image(config_image* image) {
+    pad_free(image->data);
+}
+
+// Keep an image alive until the store is cleaned up
+static int config_add_image(config_store* store, const config_image* image) {
+    config_image* images = (config_image*)realloc(store->images, (store->image_count + 1) * sizeof(config_image));
+    if (!images) return -1;
+    store->images = images;
+    store->images[store->image_count++] = *image;
+    return 0;
+}
+
+// Index one key=value line in place. line_end points at its '\n', which
+// becomes the value terminator; returns -1 on allocation failure.
+static int config_index_line(config_store* store, char* line, char* line_end) {
+    // Skip empty lines and comments
+    while (line < line_end && (*line == ' ' || *line == '\t')) line++;
+    if (line == line_end || *line == '#' || *line == ';' || *line == '\r') {
+        return 0;
+    }
     
-    char line[512];
-    while (fgets(line, sizeof(line), file)) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
-        
-        // Skip empty lines and comments
-        if (line[0] == '#' || line[0] == ';' || strlen(line) == 0) {
-            continue;
+    // Parse key=value
+    char* separator = (char*)memchr(line, '=', (size_t)(line_end - line));
+    if (!separator) return 0;
+    
+    char* value = separator + 1;
+    while (value < line_end && (*value == ' ' || *value == '\t')) value++;
+    char* value_end = line_end;
+    if (value_end > value && value_end[-1] == '\r') value_end--;
+    
+    *separator = '\0';
+    *value_end = '\0';
+    
+    uint32_t hash = config_hash(line);
+    long slot = config_find_slot(store, line, hash);
+    config_entry* entry = slot >= 0 ? &store->entries[store->index[slot] - 1] : NULL;
+    if (!entry) {
+        entry = config_insert(store, line, hash, 1);
+        if (!entry) return -1;
+    } else if (entry->value_capacity) {
+        pad_allocator_free(&store->allocator, entry->value);
+    }
+    entry->value = value;
+    entry->value_capacity = 0;
+    entry->revision = ++store->revision;
+    return 0;
+}
+
+// Load a file into the store in a single pass. Keys and values are indexed
+// in place inside the file image, with no per-entry allocation and no length
+// limits; the image lives until config_store_cleanup.
+int config_store_load(config_store* store, const char* filename) {
+    config_image image;
+    if (config_read_image(filename, &image) != 0) return -1;
+    if (image.size == 0) return 0;
+    
+    if (config_add_image(store, &image) != 0) {
+        config_close_image(&image);
+        return -1;
+    }
+    
+    char* cursor = image.data;
+    char* end = image.data + image.size;
+    while (cursor < end) {
+        char* newline = (char*)memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!newline) {
+            // The last line has no '\n' to overwrite: index a terminated copy
+            config_image tail;
+            tail.size = (size_t)(end - cursor) + 1;
+            tail.data = (char*)pad_malloc(tail.size);
+            if (!tail.data || config_add_image(store, &tail) != 0) {
+                pad_free(tail.data);
+                return -1;
+            }
+            memcpy(tail.data, cursor, tail.size - 1);
+            newline = tail.data + tail.size - 1;
+            *newline = '\n';
+            return config_index_line(store, tail.data, newline);
         }
-        
-        // Parse key=value
-        char* separator = strchr(line, '=');
-        if (separator) {
-            *separator = '\0';
-            char* key = line;
-            char* value = separator + 1;
-            
-            // Trim whitespace
-            while (*key == ' ' || *key == '\t') key++;
-            while (*value == ' ' || *value == '\t') value++;
-            
-            // Add to configuration
-            pad_config_set_string(key, value);
+        if (config_index_line(store, cursor, newline) != 0) return -1;
+        cursor = newline + 1;
+    }
+    
+    return 0;
+}
+
+// Free everything the store owns; the allocator is kept,
+// and revisions keep counting so handles resolved before see the change
+void config_store_cleanup(config_store* store) {
+    for (size_t i = 0; i < store->count; i++) {
+        if (store->entries[i].key && store->entries[i].value_capacity) {
+            pad_allocator_free(&store->allocator, store->entries[i].value);
         }
     }
+    for (size_t i = 0; i < store->image_count; i++) {
+        config_close_image(&store->images[i]);
+    }
+    free(store->images);
+    free(store->entries);
+    free(store->index);
+    pad_arena_destroy(store->keys);
     
-    fclose(file);
+    pad_allocator allocator = store->allocator;
+    uint64_t revision = store->revision;
+    uint64_t layout = store->layout;
+    memset(store, 0, sizeof(*store));
+    store->allocator = allocator;
+    store->revision = revision;
+    store->inserts = revision;
+    store->layout = layout + 1;
+}
+
+// Initialize configuration system
+int pad_config_init(void) {
+    // Clean up any existing configuration
+    pad_config_cleanup();
     return 0;
 }
 
+// Load configuration from a file; see config_store_load
+int pad_config_load(const char* filename) {
+    if (!filename) return -1;
+    return config_store_load(&config_global, filename);
+}
+
 // Save configuration to a file
 int pad_config_save(const char* filename) {
     if (!filename) return -1;
@@ -63,10 +341,10 @@ int pad_config_save(const char* filename) {
     FILE* file = fopen(filename, "w");
     if (!file) return -1;
     
-    config_item* current = config_head;
-    while (current) {
-        fprintf(file, "%s=%s\n", current->name, current->value);
-        current = current->next;
+    for (size_t i = 0; i < config_global.count; i++) {
+        if (config_global.entries[i].key) {
+            fprintf(file, "%s=%s\n", config_global.entries[i].key, config_global.entries[i].value);
+        }
     }
     
     fclose(file);
@@ -76,42 +354,15 @@ int pad_config_save(const char* filename) {
 // Set a string value in configuration
 int pad_config_set_string(const char* key, const char* value) {
     if (!key || !value) return -1;
-    
-    // Check if key already exists
-    config_item* current = config_head;
-    while (current) {
-        if (strcmp(current->name, key) == 0) {
-            pad_strncpy(current->value, value, sizeof(current->value));
-            return 0;
-        }
-        current = current->next;
-    }
-    
-    // Create new item
-    config_item* new_item = (config_item*)pad_malloc(sizeof(config_item));
-    if (!new_item) return -1;
-    
-    pad_strncpy(new_item->name, key, sizeof(new_item->name));
-    pad_strncpy(new_item->value, value, sizeof(new_item->value));
-    new_item->next = config_head;
-    config_head = new_item;
-    
-    return 0;
+    return config_store_set(&config_global, key, value);
 }
 
 // Get a string value from configuration
 const char* pad_config_get_string(const char* key, const char* default_value) {
     if (!key) return default_value;
     
-    config_item* current = config_head;
-    while (current) {
-        if (strcmp(current->name, key) == 0) {
-            return current->value;
-        }
-        current = current->next;
-    }
-    
-    return default_value;
+    const config_entry* entry = config_store_find(&config_global, key);
+    return entry ? entry->value : default_value;
 }
 
 // Set an integer value in configuration
@@ -157,46 +408,91 @@ float pad_config_get_float(const char* key, float default_value) {
 // Remove a key from configuration
 int pad_config_remove(const char* key) {
     if (!key) return -1;
-    
-    config_item* current = config_head;
-    config_item* prev = NULL;
-    
-    while (current) {
-        if (strcmp(current->name, key) == 0) {
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                config_head = current->next;
-            }
-            pad_free(current);
-            return 0;
-        }
-        prev = current;
-        current = current->next;
-    }
-    
-    return -1; // Key not found
+    return config_store_remove(&config_global, key);
 }
 
 // Clean up configuration system
 int pad_config_cleanup(void) {
-    while (config_head) {
-        config_item* temp = config_head;
-        config_head = config_head->next;
-        pad_free(temp);
+    config_store_cleanup(&config_global);
+    return 0;
+}
+
+// Select where configuration values are allocated
+int pad_config_set_allocator(const pad_allocator* allocator) {
+    if (config_global.live) return -1; // Values must be freed by the allocator that made them
+    
+    if (allocator) {
+        config_global.allocator = *allocator;
+    } else {
+        config_global.allocator.arena = NULL;
+        config_global.allocator.pool = NULL;
     }
     return 0;
 }
 
-// Enumerate all configuration keys
+// Enumerate all configuration keys in insertion order
 int pad_config_enumerate_keys(void (*callback)(const char* key, const char* value)) {
     if (!callback) return -1;
     
-    config_item* current = config_head;
-    while (current) {
-        callback(current->name, current->value);
-        current = current->next;
+    for (size_t i = 0; i < config_global.count; i++) {
+        if (config_global.entries[i].key) {
+            callback(config_global.entries[i].key, config_global.entries[i].value);
+        }
     }
     
     return 0;
-}
\ No newline at end of file
+}
+
+// Resolve the handle's key and cache its parsed values
+static void config_handle_resolve(pad_config_handle* handle) {
+    handle->layout = config_global.layout;
+    handle->entry = 0;
+    handle->revision = config_global.inserts;
+    
+    uint32_t hash = config_hash(handle->key);
+    long slot = config_find_slot(&config_global, handle->key, hash);
+    if (slot < 0) return;
+    
+    size_t index = config_global.index[slot] - 1;
+    const config_entry* entry = &config_global.entries[index];
+    handle->entry = index + 1;
+    handle->revision = entry->revision;
+    handle->int_value = atoi(entry->value);
+    handle->float_value = (float)atof(entry->value);
+}
+
+// Is the cached value still current? Only a change to this key (or, for a
+// key that was missing, any insert) forces a new lookup.
+static int config_handle_current(const pad_config_handle* handle) {
+    if (handle->layout != config_global.layout) return 0;
+    if (handle->entry == 0) {
+        return handle->revision == config_global.inserts;
+    }
+    return config_global.entries[handle->entry - 1].revision == handle->revision;
+}
+
+// Bind a handle to key; key must outlive the handle
+void pad_config_handle_init(pad_config_handle* handle, const char* key) {
+    if (!handle) return;
+    memset(handle, 0, sizeof(*handle));
+    handle->key = key;
+    handle->layout = UINT64_MAX; // Never a store layout: resolve on first use
+}
+
+int pad_config_handle_get_int(pad_config_handle* handle, int default_value) {
+    if (!handle || !handle->key) return default_value;
+    
+    if (!config_handle_current(handle)) {
+        config_handle_resolve(handle);
+    }
+    return handle->entry ? handle->int_value : default_value;
+}
+
+float pad_config_handle_get_float(pad_config_handle* handle, float default_value) {
+    if (!handle || !handle->key) return default_value;
+    
+    if (!config_handle_current(handle)) {
+        config_handle_resolve(handle);
+    }
+    return handle->entry ? handle->float_value : default_value;
+}
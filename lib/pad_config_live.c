@@ -0,0 +1,359 @@
+#include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include "../include/pad_config.h"
+#include "pad_config_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    typedef SRWLOCK live_mutex;
+    #define LIVE_MUTEX_INIT SRWLOCK_INIT
+    #define live_lock(m) AcquireSRWLockExclusive(m)
+    #define live_unlock(m) ReleaseSRWLockExclusive(m)
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <signal.h>
+    #include <unistd.h>
+    typedef pthread_mutex_t live_mutex;
+    #define LIVE_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+    #define live_lock(m) pthread_mutex_lock(m)
+    #define live_unlock(m) pthread_mutex_unlock(m)
+#endif
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+#endif
+
+struct pad_config_snapshot {
+    config_store store;
+    uint64_t version;
+    uint64_t retire_epoch;
+    struct pad_config_snapshot* next_retired;
+};
+
+// One per reader thread, pushed onto a lock-free list and kept for the life
+// of the process. epoch is 0 while the thread holds no snapshot, otherwise
+// the global epoch it observed on entry.
+typedef struct live_reader {
+    struct live_reader* next;
+    _Atomic uint64_t epoch;
+    unsigned nesting;
+} live_reader;
+
+static _Atomic(pad_config_snapshot*) live_current = NULL;
+static _Atomic uint64_t live_epoch = 1;
+static _Atomic(live_reader*) live_readers = NULL;
+static PAD_THREAD_LOCAL live_reader* thread_reader = NULL;
+
+// Writers (loads, reclamation, stop) are serialized; readers never take this
+static live_mutex live_writer_lock = LIVE_MUTEX_INIT;
+static pad_config_snapshot* live_retired = NULL;
+static uint64_t live_version = 0;
+
+static live_reader* live_thread_reader(void) {
+    if (thread_reader) return thread_reader;
+
+    live_reader* reader = (live_reader*)calloc(1, sizeof(live_reader));
+    if (!reader) return NULL;
+
+    live_reader* old_head = atomic_load(&live_readers);
+    do {
+        reader->next = old_head;
+    } while (!atomic_compare_exchange_weak(&live_readers, &old_head, reader));
+
+    thread_reader = reader;
+    return reader;
+}
+
+static void live_free_snapshot(pad_config_snapshot* snapshot) {
+    config_store_cleanup(&snapshot->store);
+    free(snapshot);
+}
+
+// Free retired snapshots that no active reader can still hold. A reader that
+// entered at epoch E may hold anything retired at an epoch >= E.
+// Caller holds live_writer_lock.
+static void live_reclaim(void) {
+    uint64_t oldest = UINT64_MAX;
+    for (live_reader* reader = atomic_load(&live_readers); reader; reader = reader->next) {
+        uint64_t epoch = atomic_load(&reader->epoch);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    pad_config_snapshot** link = &live_retired;
+    while (*link) {
+        pad_config_snapshot* snapshot = *link;
+        if (snapshot->retire_epoch < oldest) {
+            *link = snapshot->next_retired;
+            live_free_snapshot(snapshot);
+        } else {
+            link = &snapshot->next_retired;
+        }
+    }
+}
+
+int pad_config_live_load(const char* filename) {
+    if (!filename) return -1;
+
+    pad_config_snapshot* snapshot = (pad_config_snapshot*)calloc(1, sizeof(pad_config_snapshot));
+    if (!snapshot) return -1;
+    if (config_store_load(&snapshot->store, filename) != 0) {
+        live_free_snapshot(snapshot);
+        return -1;
+    }
+
+    live_lock(&live_writer_lock);
+    snapshot->version = ++live_version;
+    pad_config_snapshot* old = atomic_exchange(&live_current, snapshot);
+    if (old) {
+        // Readers entering after this bump load the pointer after the swap
+        old->retire_epoch = atomic_fetch_add(&live_epoch, 1);
+        old->next_retired = live_retired;
+        live_retired = old;
+    }
+    live_reclaim();
+    live_unlock(&live_writer_lock);
+    return 0;
+}
+
+const pad_config_snapshot* pad_config_live_acquire(void) {
+    live_reader* reader = live_thread_reader();
+    if (!reader) return NULL;
+
+    if (reader->nesting++ == 0) {
+        // Announce the epoch before loading the pointer (both seq_cst), so a
+        // writer either sees us pinned or we see its new snapshot
+        atomic_store(&reader->epoch, atomic_load(&live_epoch));
+    }
+    return atomic_load(&live_current);
+}
+
+void pad_config_live_release(void) {
+    live_reader* reader = thread_reader;
+    if (!reader || reader->nesting == 0) return;
+
+    if (--reader->nesting == 0) {
+        atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+    }
+}
+
+const char* pad_config_snapshot_get_string(const pad_config_snapshot* snapshot, const char* key, const char* default_value) {
+    if (!snapshot || !key) return default_value;
+
+    const config_entry* entry = config_store_find(&snapshot->store, key);
+    return entry ? entry->value : default_value;
+}
+
+int pad_config_snapshot_get_int(const pad_config_snapshot* snapshot, const char* key, int default_value) {
+    const char* str_value = pad_config_snapshot_get_string(snapshot, key, NULL);
+    return str_value ? atoi(str_value) : default_value;
+}
+
+float pad_config_snapshot_get_float(const pad_config_snapshot* snapshot, const char* key, float default_value) {
+    const char* str_value = pad_config_snapshot_get_string(snapshot, key, NULL);
+    return str_value ? (float)atof(str_value) : default_value;
+}
+
+uint64_t pad_config_snapshot_version(const pad_config_snapshot* snapshot) {
+    return snapshot ? snapshot->version : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Reload watcher
+// ---------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#define WATCH_WAKE_RELOAD 'r'
+#define WATCH_WAKE_STOP   'q'
+
+static pthread_t watch_thread;
+static int watch_running = 0;
+static int watch_pipe[2] = { -1, -1 };
+static int watch_inotify = -1;
+static int watch_flags = 0;
+static char* watch_filename = NULL;
+static const char* watch_basename = NULL;
+static struct sigaction watch_old_sighup;
+
+static void watch_sighup_handler(int signo) {
+    (void)signo;
+    int saved_errno = errno;
+    char wake = WATCH_WAKE_RELOAD;
+    ssize_t ignored = write(watch_pipe[1], &wake, 1); // Non-blocking; a full pipe already means "reload"
+    (void)ignored;
+    errno = saved_errno;
+}
+
+// Did this batch of inotify events touch the watched file?
+static int watch_drain_inotify(void) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int touched = 0;
+    ssize_t length;
+    while ((length = read(watch_inotify, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + length;) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            if (event->len && strcmp(event->name, watch_basename) == 0) {
+                touched = 1;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return touched;
+}
+
+static void* watch_main(void* arg) {
+    (void)arg;
+    struct pollfd fds[2];
+    fds[0].fd = watch_pipe[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = watch_inotify;
+    fds[1].events = POLLIN;
+    nfds_t count = watch_inotify >= 0 ? 2 : 1;
+
+    for (;;) {
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        int reload = 0;
+        if (fds[0].revents & POLLIN) {
+            char wakes[64];
+            ssize_t length = read(watch_pipe[0], wakes, sizeof(wakes));
+            for (ssize_t i = 0; i < length; i++) {
+                if (wakes[i] == WATCH_WAKE_STOP) return NULL;
+                reload = 1;
+            }
+        }
+        if (count == 2 && (fds[1].revents & POLLIN) && watch_drain_inotify()) {
+            reload = 1;
+        }
+        if (reload) {
+            // A failed load (file missing mid-rename, parse error) keeps the old snapshot
+            pad_config_live_load(watch_filename);
+        }
+    }
+    return NULL;
+}
+
+int pad_config_live_watch(const char* filename, int flags) {
+    if (!filename || watch_running) return -1;
+    if (!(flags & (PAD_CONFIG_RELOAD_SIGHUP | PAD_CONFIG_RELOAD_INOTIFY))) return -1;
+
+    watch_filename = strdup(filename);
+    if (!watch_filename) return -1;
+    char* slash = strrchr(watch_filename, '/');
+    watch_basename = slash ? slash + 1 : watch_filename;
+
+    if (pipe(watch_pipe) != 0) goto fail;
+    for (int i = 0; i < 2; i++) {
+        fcntl(watch_pipe[i], F_SETFD, FD_CLOEXEC);
+        fcntl(watch_pipe[i], F_SETFL, O_NONBLOCK);
+    }
+
+    if (flags & PAD_CONFIG_RELOAD_INOTIFY) {
+        // Watch the directory: editors and deploy tools replace the file by rename
+        watch_inotify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (watch_inotify < 0) goto fail;
+
+        char directory[4096] = ".";
+        if (slash) {
+            size_t length = slash == watch_filename ? 1 : (size_t)(slash - watch_filename);
+            if (length >= sizeof(directory)) goto fail;
+            memcpy(directory, watch_filename, length);
+            directory[length] = '\0';
+        }
+        if (inotify_add_watch(watch_inotify, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            goto fail;
+        }
+    }
+
+    if (flags & PAD_CONFIG_RELOAD_SIGHUP) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = watch_sighup_handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGHUP, &action, &watch_old_sighup) != 0) goto fail;
+    }
+    watch_flags = flags;
+
+    if (pthread_create(&watch_thread, NULL, watch_main, NULL) != 0) {
+        if (flags & PAD_CONFIG_RELOAD_SIGHUP) {
+            sigaction(SIGHUP, &watch_old_sighup, NULL);
+        }
+        goto fail;
+    }
+    watch_running = 1;
+    return 0;
+
+fail:
+    if (watch_inotify >= 0) close(watch_inotify);
+    if (watch_pipe[0] >= 0) close(watch_pipe[0]);
+    if (watch_pipe[1] >= 0) close(watch_pipe[1]);
+    watch_inotify = watch_pipe[0] = watch_pipe[1] = -1;
+    free(watch_filename);
+    watch_filename = NULL;
+    watch_flags = 0;
+    return -1;
+}
+
+static void watch_stop(void) {
+    if (!watch_running) return;
+
+    if (watch_flags & PAD_CONFIG_RELOAD_SIGHUP) {
+        sigaction(SIGHUP, &watch_old_sighup, NULL);
+    }
+    char wake = WATCH_WAKE_STOP;
+    while (write(watch_pipe[1], &wake, 1) < 0 && errno == EAGAIN) {
+        pad_sleep_ms(1); // Pipe full of pending reloads; the watcher is draining it
+    }
+    pthread_join(watch_thread, NULL);
+
+    if (watch_inotify >= 0) close(watch_inotify);
+    close(watch_pipe[0]);
+    close(watch_pipe[1]);
+    watch_inotify = watch_pipe[0] = watch_pipe[1] = -1;
+    free(watch_filename);
+    watch_filename = NULL;
+    watch_flags = 0;
+    watch_running = 0;
+}
+
+#else
+
+int pad_config_live_watch(const char* filename, int flags) {
+    (void)filename;
+    (void)flags;
+    return -1;
+}
+
+static void watch_stop(void) {
+}
+
+#endif
+
+void pad_config_live_stop(void) {
+    watch_stop();
+
+    live_lock(&live_writer_lock);
+    pad_config_snapshot* current = atomic_exchange(&live_current, NULL);
+    if (current) {
+        live_free_snapshot(current);
+    }
+    while (live_retired) {
+        pad_config_snapshot* next = live_retired->next_retired;
+        live_free_snapshot(live_retired);
+        live_retired = next;
+    }
+    live_unlock(&live_writer_lock);
+}
@@ -0,0 +1,54 @@
+#ifndef PAD_CONFIG_STORE_H
+#define PAD_CONFIG_STORE_H
+
+// Internal to lib/: the key/value store behind pad_config_* and the
+// immutable snapshots published by pad_config_live_*.
+
+#include "../include/pad_alloc.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Entries live in a dense array in insertion order (which is the order
+// pad_config_save and pad_config_enumerate_keys use). An open-addressing hash
+// index with linear probing maps keys to entries. Keys are interned once in
+// the store's arena and never move; entries read by config_store_load instead
+// point straight into the loaded file image, a private copy of the file.
+typedef struct config_entry {
+    const char* key;       // NULL once the entry has been removed
+    char* value;
+    size_t value_capacity; // 0 when value borrows from a loaded file image
+    uint32_t hash;
+    uint64_t revision;     // Store revision of the last change to this entry
+} config_entry;
+
+// A file image kept alive for the entries that point into it
+typedef struct config_image {
+    char* data;
+    size_t size;
+} config_image;
+
+typedef struct config_store {
+    config_entry* entries;   // Insertion order, including removed entries
+    size_t count;
+    size_t capacity;
+    size_t live;
+    uint32_t* index;         // Slot holds entry index + 1, or EMPTY/TOMBSTONE
+    size_t index_size;       // Power of two
+    size_t index_used;       // Live + tombstone slots
+    pad_arena* keys;
+    pad_allocator allocator; // Value storage
+    config_image* images;
+    size_t image_count;
+    uint64_t revision;       // Bumped by every set, insert and remove
+    uint64_t inserts;        // Revision of the most recent insert
+    uint64_t layout;         // Bumped whenever entries move to new indices
+} config_store;
+
+uint32_t config_hash(const char* key);
+config_entry* config_store_find(const config_store* store, const char* key);
+int config_store_set(config_store* store, const char* key, const char* value);
+int config_store_remove(config_store* store, const char* key);
+int config_store_load(config_store* store, const char* filename);
+void config_store_cleanup(config_store* store);
+
+#endif // PAD_CONFIG_STORE_H
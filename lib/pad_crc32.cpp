@@ -0,0 +1,447 @@
+#include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define PAD_CRC32_HAVE_PCLMUL 1
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+    #include <arm_acle.h>
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+    #define PAD_CRC32_HAVE_ARMV8 1
+#endif
+
+namespace {
+
+// Reflected IEEE 802.3 polynomial
+constexpr uint32_t kCrc32Poly = 0xEDB88320u;
+
+// Slice-by-N tables: table[k][b] is the CRC of byte b followed by k zero bytes.
+// Built by the compiler, so there is no first-call initialization to race on.
+struct Crc32Tables {
+    uint32_t table[16][256];
+};
+
+constexpr Crc32Tables make_crc32_tables() {
+    Crc32Tables t{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int j = 0; j < 8; j++) {
+            c = (c & 1) ? (kCrc32Poly ^ (c >> 1)) : (c >> 1);
+        }
+        t.table[0][i] = c;
+    }
+    for (int k = 1; k < 16; k++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t prev = t.table[k - 1][i];
+            t.table[k][i] = (prev >> 8) ^ t.table[0][prev & 0xFF];
+        }
+    }
+    return t;
+}
+
+constexpr Crc32Tables kCrc32 = make_crc32_tables();
+
+static_assert(kCrc32.table[0][1] == 0x77073096u, "CRC32 table generation is broken");
+
+inline uint32_t load_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+typedef uint32_t (*crc32_kernel_fn)(uint32_t crc, const uint8_t* p, size_t len);
+
+uint32_t crc32_bytewise(uint32_t crc, const uint8_t* p, size_t len) {
+    const auto& T = kCrc32.table;
+    while (len--) {
+        crc = T[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+uint32_t crc32_slice8(uint32_t crc, const uint8_t* p, size_t len) {
+    const auto& T = kCrc32.table;
+    while (len >= 8) {
+        uint32_t one = load_le32(p) ^ crc;
+        uint32_t two = load_le32(p + 4);
+        crc = T[7][one & 0xFF] ^ T[6][(one >> 8) & 0xFF] ^
+              T[5][(one >> 16) & 0xFF] ^ T[4][one >> 24] ^
+              T[3][two & 0xFF] ^ T[2][(two >> 8) & 0xFF] ^
+              T[1][(two >> 16) & 0xFF] ^ T[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    return crc32_bytewise(crc, p, len);
+}
+
+uint32_t crc32_slice16(uint32_t crc, const uint8_t* p, size_t len) {
+    const auto& T = kCrc32.table;
+    while (len >= 16) {
+        uint32_t one = load_le32(p) ^ crc;
+        uint32_t two = load_le32(p + 4);
+        uint32_t three = load_le32(p + 8);
+        uint32_t four = load_le32(p + 12);
+        crc = T[15][one & 0xFF] ^ T[14][(one >> 8) & 0xFF] ^
+              T[13][(one >> 16) & 0xFF] ^ T[12][one >> 24] ^
+              T[11][two & 0xFF] ^ T[10][(two >> 8) & 0xFF] ^
+              T[9][(two >> 16) & 0xFF] ^ T[8][two >> 24] ^
+              T[7][three & 0xFF] ^ T[6][(three >> 8) & 0xFF] ^
+              T[5][(three >> 16) & 0xFF] ^ T[4][three >> 24] ^
+              T[3][four & 0xFF] ^ T[2][(four >> 8) & 0xFF] ^
+              T[1][(four >> 16) & 0xFF] ^ T[0][four >> 24];
+        p += 16;
+        len -= 16;
+    }
+    return crc32_bytewise(crc, p, len);
+}
+
+#ifdef PAD_CRC32_HAVE_PCLMUL
+// Carry-less multiply folding, after Intel's "Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ Instruction" (bit-reflected constants).
+// Requires len >= 64 and len % 16 == 0.
+__attribute__((target("pclmul,sse4.1")))
+uint32_t crc32_pclmul_fold(uint32_t crc, const uint8_t* buf, size_t len) {
+    alignas(16) static const uint64_t k1k2[] = {0x0154442bd4ULL, 0x01c6e41596ULL};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997d0ULL, 0x00ccaa009eULL};
+    alignas(16) static const uint64_t k5k0[] = {0x0163cd6124ULL, 0x0000000000ULL};
+    alignas(16) static const uint64_t poly[] = {0x01db710641ULL, 0x01f7011641ULL};
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_load_si128((const __m128i*)k1k2);
+    buf += 64;
+    len -= 64;
+
+    // Fold four 128-bit lanes in parallel
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one
+    x0 = _mm_load_si128((const __m128i*)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Remaining 16-byte blocks
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i*)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i*)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+uint32_t crc32_pclmul(uint32_t crc, const uint8_t* p, size_t len) {
+    if (len >= 64) {
+        size_t chunk = len & ~(size_t)15;
+        crc = crc32_pclmul_fold(crc, p, chunk);
+        p += chunk;
+        len -= chunk;
+    }
+    return crc32_slice16(crc, p, len);
+}
+
+bool cpu_has_pclmul() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+#ifdef PAD_CRC32_HAVE_ARMV8
+__attribute__((target("+crc")))
+uint32_t crc32_armv8(uint32_t crc, const uint8_t* p, size_t len) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = __crc32b(crc, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = __crc32d(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32b(crc, *p++);
+    }
+    return crc;
+}
+
+bool cpu_has_armv8_crc() {
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+#endif
+
+bool impl_available(pad_crc32_impl_t impl) {
+    switch (impl) {
+        case PAD_CRC32_IMPL_AUTO:
+        case PAD_CRC32_IMPL_BYTEWISE:
+        case PAD_CRC32_IMPL_SLICE8:
+        case PAD_CRC32_IMPL_SLICE16:
+            return true;
+#ifdef PAD_CRC32_HAVE_PCLMUL
+        case PAD_CRC32_IMPL_PCLMUL:
+            return cpu_has_pclmul();
+#endif
+#ifdef PAD_CRC32_HAVE_ARMV8
+        case PAD_CRC32_IMPL_ARMV8:
+            return cpu_has_armv8_crc();
+#endif
+        default:
+            return false;
+    }
+}
+
+pad_crc32_impl_t select_impl() {
+    if (impl_available(PAD_CRC32_IMPL_ARMV8)) return PAD_CRC32_IMPL_ARMV8;
+    if (impl_available(PAD_CRC32_IMPL_PCLMUL)) return PAD_CRC32_IMPL_PCLMUL;
+    return PAD_CRC32_IMPL_SLICE16;
+}
+
+crc32_kernel_fn kernel_for(pad_crc32_impl_t impl) {
+    switch (impl) {
+        case PAD_CRC32_IMPL_BYTEWISE: return crc32_bytewise;
+        case PAD_CRC32_IMPL_SLICE8:   return crc32_slice8;
+        case PAD_CRC32_IMPL_SLICE16:  return crc32_slice16;
+#ifdef PAD_CRC32_HAVE_PCLMUL
+        case PAD_CRC32_IMPL_PCLMUL:   return crc32_pclmul;
+#endif
+#ifdef PAD_CRC32_HAVE_ARMV8
+        case PAD_CRC32_IMPL_ARMV8:    return crc32_armv8;
+#endif
+        default:                      return crc32_slice16;
+    }
+}
+
+// Runtime CPU dispatch, resolved once (function-local statics are thread-safe)
+pad_crc32_impl_t selected_impl() {
+    static const pad_crc32_impl_t impl = select_impl();
+    return impl;
+}
+
+crc32_kernel_fn selected_kernel() {
+    static const crc32_kernel_fn kernel = kernel_for(selected_impl());
+    return kernel;
+}
+
+// Below this size a chunk is not worth handing to another thread
+constexpr size_t kParallelMinChunk = 1024 * 1024;
+
+// Fixed pool of worker threads shared by all pad_crc32_parallel callers
+class Crc32WorkerPool {
+public:
+    explicit Crc32WorkerPool(unsigned workers) {
+        for (unsigned i = 0; i < workers; i++) {
+            threads_.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~Crc32WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) {
+            t.join();
+        }
+    }
+
+    unsigned size() const { return (unsigned)threads_.size(); }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void worker_loop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+Crc32WorkerPool& worker_pool() {
+    static Crc32WorkerPool pool(std::thread::hardware_concurrency() > 1
+                                    ? std::thread::hardware_concurrency() - 1 : 1);
+    return pool;
+}
+
+} // namespace
+
+DLL_EXPORT uint32_t pad_crc32_init(void) {
+    return 0xFFFFFFFFu;
+}
+
+DLL_EXPORT uint32_t pad_crc32_update(uint32_t state, const uint8_t* data, size_t length) {
+    if (data == NULL || length == 0) {
+        return state;
+    }
+    return selected_kernel()(state, data, length);
+}
+
+DLL_EXPORT uint32_t pad_crc32_final(uint32_t state) {
+    return state ^ 0xFFFFFFFFu;
+}
+
+DLL_EXPORT const char* pad_crc32_impl_name(pad_crc32_impl_t impl) {
+    switch (impl) {
+        case PAD_CRC32_IMPL_AUTO:     return "auto";
+        case PAD_CRC32_IMPL_BYTEWISE: return "bytewise";
+        case PAD_CRC32_IMPL_SLICE8:   return "slice-by-8";
+        case PAD_CRC32_IMPL_SLICE16:  return "slice-by-16";
+        case PAD_CRC32_IMPL_PCLMUL:   return "pclmulqdq";
+        case PAD_CRC32_IMPL_ARMV8:    return "armv8-crc";
+        default:                      return "unknown";
+    }
+}
+
+DLL_EXPORT int pad_crc32_impl_available(pad_crc32_impl_t impl) {
+    return impl_available(impl) ? 1 : 0;
+}
+
+DLL_EXPORT pad_crc32_impl_t pad_crc32_impl_selected(void) {
+    return selected_impl();
+}
+
+DLL_EXPORT uint32_t pad_crc32_update_impl(pad_crc32_impl_t impl, uint32_t state,
+                                          const uint8_t* data, size_t length) {
+    if (data == NULL || length == 0) {
+        return state;
+    }
+    if (impl == PAD_CRC32_IMPL_AUTO || !impl_available(impl)) {
+        return selected_kernel()(state, data, length);
+    }
+    return kernel_for(impl)(state, data, length);
+}
+
+DLL_EXPORT uint32_t pad_crc32_parallel(const uint8_t* data, size_t length, unsigned max_threads) {
+    if (data == NULL || length == 0) {
+        return pad_crc32_final(pad_crc32_init());
+    }
+
+    unsigned threads = max_threads ? max_threads : std::thread::hardware_concurrency();
+    size_t max_chunks = length / kParallelMinChunk;
+    if (threads > max_chunks) {
+        threads = (unsigned)max_chunks;
+    }
+    if (threads <= 1) {
+        return pad_crc32_final(pad_crc32_update(pad_crc32_init(), data, length));
+    }
+
+    // Each chunk gets an independent CRC; the caller hashes chunk 0 itself
+    // and the pool takes the rest, then the partials are merged in order.
+    size_t chunk = (length + threads - 1) / threads;
+    std::vector<uint32_t> partial(threads);
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    unsigned remaining = threads - 1;
+
+    Crc32WorkerPool& pool = worker_pool();
+    for (unsigned i = 1; i < threads; i++) {
+        size_t offset = chunk * i;
+        size_t n = offset + chunk > length ? length - offset : chunk;
+        pool.submit([&, i, offset, n] {
+            partial[i] = pad_crc32_final(pad_crc32_update(pad_crc32_init(), data + offset, n));
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (--remaining == 0) {
+                done_cv.notify_one();
+            }
+        });
+    }
+    partial[0] = pad_crc32_final(pad_crc32_update(pad_crc32_init(), data, chunk));
+
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [&] { return remaining == 0; });
+    }
+
+    uint32_t crc = partial[0];
+    for (unsigned i = 1; i < threads; i++) {
+        size_t offset = chunk * i;
+        size_t n = offset + chunk > length ? length - offset : chunk;
+        crc = pad_crc32_combine(crc, partial[i], n);
+    }
+    return crc;
+}
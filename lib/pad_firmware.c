@@ -0,0 +1,514 @@
+#include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include "../include/pad_firmware.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One data record as parsed, before sorting and merging
+typedef struct {
+    uint32_t address;
+    uint32_t length;
+    size_t offset;                // Into the builder's pool
+} firmware_record;
+
+// Parse state shared by all formats
+typedef struct {
+    firmware_record* records;
+    size_t record_count;
+    size_t record_capacity;
+    uint8_t* pool;                // Record data, in file order
+    size_t pool_length;
+    size_t pool_capacity;
+    uint32_t entry;
+    size_t line;                  // Text formats: 1-based line being parsed
+    char* error;
+    size_t error_size;
+} firmware_builder;
+
+struct pad_firmware {
+    pad_firmware_format format;
+    pad_firmware_segment* segments;
+    size_t segment_count;
+    uint8_t* data;                // All segment data, in address order
+    uint64_t data_size;
+    uint32_t entry;
+};
+
+static int firmware_fail(firmware_builder* builder, const char* format, ...) {
+    if (builder->error && builder->error_size) {
+        size_t used = 0;
+        if (builder->line) {
+            int written = snprintf(builder->error, builder->error_size, "line %zu: ", builder->line);
+            used = written > 0 ? (size_t)written : 0;
+        }
+        if (used < builder->error_size) {
+            va_list args;
+            va_start(args, format);
+            vsnprintf(builder->error + used, builder->error_size - used, format, args);
+            va_end(args);
+        }
+    }
+    return -1;
+}
+
+static int firmware_add(firmware_builder* builder, uint64_t address, const uint8_t* data,
+                        size_t length) {
+    if (length == 0) return 0;
+    if (address >= 0x100000000ull || length > 0x100000000ull - address) {
+        return firmware_fail(builder, "data at 0x%llx runs past 4 GB",
+                             (unsigned long long)address);
+    }
+
+    if (builder->pool_length + length > builder->pool_capacity) {
+        size_t capacity = builder->pool_capacity ? builder->pool_capacity * 2 : 64 * 1024;
+        while (capacity < builder->pool_length + length) capacity *= 2;
+        uint8_t* pool = (uint8_t*)realloc(builder->pool, capacity);
+        if (!pool) return firmware_fail(builder, "out of memory");
+        builder->pool = pool;
+        builder->pool_capacity = capacity;
+    }
+
+    // Records that continue the previous one just grow it
+    firmware_record* last = builder->record_count ? &builder->records[builder->record_count - 1] : NULL;
+    if (last && (uint64_t)last->address + last->length == address &&
+        last->offset + last->length == builder->pool_length) {
+        last->length += (uint32_t)length;
+    } else {
+        if (builder->record_count == builder->record_capacity) {
+            size_t capacity = builder->record_capacity ? builder->record_capacity * 2 : 64;
+            firmware_record* records = (firmware_record*)realloc(builder->records,
+                                                                 capacity * sizeof(firmware_record));
+            if (!records) return firmware_fail(builder, "out of memory");
+            builder->records = records;
+            builder->record_capacity = capacity;
+        }
+        firmware_record* record = &builder->records[builder->record_count++];
+        record->address = (uint32_t)address;
+        record->length = (uint32_t)length;
+        record->offset = builder->pool_length;
+    }
+
+    memcpy(builder->pool + builder->pool_length, data, length);
+    builder->pool_length += length;
+    return 0;
+}
+
+static int firmware_compare_records(const void* a, const void* b) {
+    uint32_t left = ((const firmware_record*)a)->address;
+    uint32_t right = ((const firmware_record*)b)->address;
+    return left < right ? -1 : left > right;
+}
+
+// Sort the records, reject overlaps and merge touching records into segments
+static pad_firmware* firmware_finish(firmware_builder* builder, pad_firmware_format format) {
+    builder->line = 0;
+    qsort(builder->records, builder->record_count, sizeof(firmware_record), firmware_compare_records);
+
+    size_t segment_count = 0;
+    for (size_t i = 0; i < builder->record_count; i++) {
+        const firmware_record* record = &builder->records[i];
+        if (i > 0) {
+            const firmware_record* previous = &builder->records[i - 1];
+            uint64_t previous_end = (uint64_t)previous->address + previous->length;
+            if (previous_end > record->address) {
+                firmware_fail(builder, "data at 0x%08x overlaps data at 0x%08x",
+                              (unsigned)record->address, (unsigned)previous->address);
+                return NULL;
+            }
+            if (previous_end == record->address) continue;
+        }
+        segment_count++;
+    }
+
+    pad_firmware* firmware = (pad_firmware*)calloc(1, sizeof(pad_firmware));
+    if (!firmware) {
+        firmware_fail(builder, "out of memory");
+        return NULL;
+    }
+    firmware->format = format;
+    firmware->entry = builder->entry;
+    firmware->data_size = builder->pool_length;
+    firmware->segments = (pad_firmware_segment*)calloc(segment_count ? segment_count : 1,
+                                                       sizeof(pad_firmware_segment));
+    firmware->data = (uint8_t*)pad_malloc(builder->pool_length ? builder->pool_length : 1);
+    if (!firmware->segments || !firmware->data) {
+        pad_firmware_free(firmware);
+        firmware_fail(builder, "out of memory");
+        return NULL;
+    }
+
+    size_t position = 0;
+    pad_firmware_segment* segment = NULL;
+    for (size_t i = 0; i < builder->record_count; i++) {
+        const firmware_record* record = &builder->records[i];
+        if (!segment || (uint64_t)segment->address + segment->length != record->address) {
+            segment = &firmware->segments[firmware->segment_count++];
+            segment->address = record->address;
+            segment->length = 0;
+            segment->data = firmware->data + position;
+        }
+        memcpy(firmware->data + position, builder->pool + record->offset, record->length);
+        position += record->length;
+        segment->length += record->length;
+    }
+    return firmware;
+}
+
+static int firmware_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Decode the hex digits of one text record into bytes; -1 on a bad digit
+static int firmware_decode_hex(const char* text, size_t digits, uint8_t* out) {
+    if (digits % 2) return -1;
+    for (size_t i = 0; i < digits; i += 2) {
+        int high = firmware_hex_digit(text[i]);
+        int low = firmware_hex_digit(text[i + 1]);
+        if (high < 0 || low < 0) return -1;
+        out[i / 2] = (uint8_t)(high << 4 | low);
+    }
+    return (int)(digits / 2);
+}
+
+// Next line of a text file without its line ending; NULL at the end
+static const char* firmware_next_line(const char** cursor, const char* end, size_t* length) {
+    const char* line = *cursor;
+    if (line >= end) return NULL;
+    const char* newline = (const char*)memchr(line, '\n', (size_t)(end - line));
+    const char* line_end = newline ? newline : end;
+    *cursor = newline ? newline + 1 : end;
+    while (line_end > line && (line_end[-1] == '\r' || line_end[-1] == ' ' || line_end[-1] == '\t')) {
+        line_end--;
+    }
+    *length = (size_t)(line_end - line);
+    return line;
+}
+
+// Intel HEX: ":LLAAAATT<data>CC" per line
+static int firmware_parse_ihex(firmware_builder* builder, const char* text, size_t length) {
+    const char* cursor = text;
+    const char* end = text + length;
+    uint32_t base = 0;            // From extended segment/linear address records
+    uint8_t record[256 + 5];
+    size_t line_length;
+    const char* line;
+
+    for (builder->line = 1; (line = firmware_next_line(&cursor, end, &line_length)) != NULL;
+         builder->line++) {
+        if (line_length == 0) continue;
+        if (line[0] != ':') return firmware_fail(builder, "expected ':'");
+
+        int bytes = line_length - 1 <= 2 * sizeof(record)
+                        ? firmware_decode_hex(line + 1, line_length - 1, record) : -1;
+        if (bytes < 5 || bytes != record[0] + 5) {
+            return firmware_fail(builder, "malformed record");
+        }
+        uint8_t sum = 0;
+        for (int i = 0; i < bytes; i++) sum += record[i];
+        if (sum != 0) return firmware_fail(builder, "bad checksum");
+
+        uint8_t count = record[0];
+        uint32_t offset = (uint32_t)record[1] << 8 | record[2];
+        const uint8_t* data = record + 4;
+        switch (record[3]) {
+            case 0x00: // Data
+                if (firmware_add(builder, (uint64_t)base + offset, data, count) != 0) return -1;
+                break;
+            case 0x01: // End of file
+                return 0;
+            case 0x02: // Extended segment address
+                if (count != 2) return firmware_fail(builder, "malformed record");
+                base = ((uint32_t)data[0] << 8 | data[1]) << 4;
+                break;
+            case 0x03: // Start segment address (CS:IP)
+                if (count != 4) return firmware_fail(builder, "malformed record");
+                builder->entry = (((uint32_t)data[0] << 8 | data[1]) << 4) +
+                                 ((uint32_t)data[2] << 8 | data[3]);
+                break;
+            case 0x04: // Extended linear address
+                if (count != 2) return firmware_fail(builder, "malformed record");
+                base = ((uint32_t)data[0] << 8 | data[1]) << 16;
+                break;
+            case 0x05: // Start linear address
+                if (count != 4) return firmware_fail(builder, "malformed record");
+                builder->entry = (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+                                 (uint32_t)data[2] << 8 | data[3];
+                break;
+            default:
+                return firmware_fail(builder, "unknown record type %02X", record[3]);
+        }
+    }
+    builder->line = 0;
+    return firmware_fail(builder, "missing end-of-file record");
+}
+
+// Motorola S-records: "S<type><count><address><data><checksum>" per line
+static int firmware_parse_srec(firmware_builder* builder, const char* text, size_t length) {
+    const char* cursor = text;
+    const char* end = text + length;
+    uint8_t record[256];
+    size_t line_length;
+    const char* line;
+
+    for (builder->line = 1; (line = firmware_next_line(&cursor, end, &line_length)) != NULL;
+         builder->line++) {
+        if (line_length == 0) continue;
+        if (line_length < 4 || line[0] != 'S') return firmware_fail(builder, "expected 'S'");
+
+        int bytes = line_length - 2 <= 2 * sizeof(record)
+                        ? firmware_decode_hex(line + 2, line_length - 2, record) : -1;
+        if (bytes < 1 || bytes != record[0] + 1) {
+            return firmware_fail(builder, "malformed record");
+        }
+        uint8_t sum = 0;
+        for (int i = 0; i < bytes; i++) sum += record[i];
+        if (sum != 0xFF) return firmware_fail(builder, "bad checksum");
+
+        // Address width by record type
+        int type = line[1] - '0';
+        static const int address_sizes[10] = {2, 2, 3, 4, 0, 2, 3, 4, 3, 2};
+        if (type < 0 || type > 9 || type == 4) {
+            return firmware_fail(builder, "unknown record type S%c", line[1]);
+        }
+        int address_size = address_sizes[type];
+        int data_length = record[0] - 1 - address_size;
+        if (data_length < 0) return firmware_fail(builder, "malformed record");
+        uint32_t address = 0;
+        for (int i = 0; i < address_size; i++) {
+            address = address << 8 | record[1 + i];
+        }
+        const uint8_t* data = record + 1 + address_size;
+
+        if (type >= 1 && type <= 3) {
+            if (firmware_add(builder, address, data, (size_t)data_length) != 0) return -1;
+        } else if (type >= 7) {
+            builder->entry = address;
+        }
+        // S0 (header) and S5/S6 (record counts) carry nothing to flash; the
+        // S7-S9 termination record is optional in practice
+    }
+    builder->line = 0;
+    return 0;
+}
+
+// ELF readers for either byte order
+static uint64_t firmware_elf_read(const uint8_t* p, int size, int big_endian) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++) {
+        int index = big_endian ? i : size - 1 - i;
+        value = value << 8 | p[index];
+    }
+    return value;
+}
+
+// ELF: every PT_LOAD program header's file contents at its physical address
+static int firmware_parse_elf(firmware_builder* builder, const uint8_t* data, size_t length) {
+    if (length < 52 || memcmp(data, "\x7F" "ELF", 4) != 0) {
+        return firmware_fail(builder, "not an ELF file");
+    }
+    int is_64 = data[4] == 2;
+    int big_endian = data[5] == 2;
+    if ((data[4] != 1 && data[4] != 2) || (data[5] != 1 && data[5] != 2)) {
+        return firmware_fail(builder, "unsupported ELF class or byte order");
+    }
+    if (is_64 && length < 64) return firmware_fail(builder, "truncated ELF header");
+
+    int word = is_64 ? 8 : 4;
+    uint64_t entry = firmware_elf_read(data + 24, word, big_endian);
+    uint64_t phoff = firmware_elf_read(data + (is_64 ? 32 : 28), word, big_endian);
+    size_t phentsize = (size_t)firmware_elf_read(data + (is_64 ? 54 : 42), 2, big_endian);
+    size_t phnum = (size_t)firmware_elf_read(data + (is_64 ? 56 : 44), 2, big_endian);
+    size_t min_entsize = is_64 ? 56 : 32;
+    if (phnum == 0) return firmware_fail(builder, "ELF file has no program headers");
+    if (phentsize < min_entsize || phoff > length || phnum * phentsize > length - phoff) {
+        return firmware_fail(builder, "truncated ELF program headers");
+    }
+    if (entry > 0xFFFFFFFFull) return firmware_fail(builder, "ELF entry point beyond 4 GB");
+    builder->entry = (uint32_t)entry;
+
+    for (size_t i = 0; i < phnum; i++) {
+        const uint8_t* ph = data + phoff + i * phentsize;
+        if (firmware_elf_read(ph, 4, big_endian) != 1) continue; // PT_LOAD only
+
+        uint64_t offset = firmware_elf_read(ph + (is_64 ? 8 : 4), word, big_endian);
+        uint64_t paddr = firmware_elf_read(ph + (is_64 ? 24 : 12), word, big_endian);
+        uint64_t filesz = firmware_elf_read(ph + (is_64 ? 32 : 16), word, big_endian);
+        if (filesz == 0) continue; // .bss and friends: nothing stored
+        if (offset > length || filesz > length - offset) {
+            return firmware_fail(builder, "ELF segment %zu lies outside the file", i);
+        }
+        if (firmware_add(builder, paddr, data + offset, (size_t)filesz) != 0) return -1;
+    }
+    return 0;
+}
+
+static int firmware_has_suffix(const char* name, const char* suffix) {
+    size_t name_length = strlen(name);
+    size_t suffix_length = strlen(suffix);
+    if (name_length < suffix_length) return 0;
+    const char* tail = name + name_length - suffix_length;
+    for (size_t i = 0; i < suffix_length; i++) {
+        char c = tail[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != suffix[i]) return 0;
+    }
+    return 1;
+}
+
+pad_firmware_format pad_firmware_detect(const char* name, const uint8_t* data, size_t length) {
+    if (length >= 4 && memcmp(data, "\x7F" "ELF", 4) == 0) {
+        return PAD_FIRMWARE_ELF;
+    }
+    if (name) {
+        static const char* hex[] = {".hex", ".ihex", ".ihx"};
+        static const char* srec[] = {".srec", ".s19", ".s28", ".s37", ".mot"};
+        for (size_t i = 0; i < sizeof(hex) / sizeof(hex[0]); i++) {
+            if (firmware_has_suffix(name, hex[i])) return PAD_FIRMWARE_IHEX;
+        }
+        for (size_t i = 0; i < sizeof(srec) / sizeof(srec[0]); i++) {
+            if (firmware_has_suffix(name, srec[i])) return PAD_FIRMWARE_SREC;
+        }
+        if (firmware_has_suffix(name, ".bin")) return PAD_FIRMWARE_BINARY;
+    }
+
+    // A text format only if the first line is a well-formed record start;
+    // a binary that merely begins with ':' or 'S' is unlikely to pass
+    if (length >= 11 && data[0] == ':') {
+        int digits = 1;
+        while (digits < 11 && firmware_hex_digit((char)data[digits]) >= 0) digits++;
+        if (digits == 11) return PAD_FIRMWARE_IHEX;
+    }
+    if (length >= 10 && data[0] == 'S' && data[1] >= '0' && data[1] <= '9') {
+        int digits = 2;
+        while (digits < 10 && firmware_hex_digit((char)data[digits]) >= 0) digits++;
+        if (digits == 10) return PAD_FIRMWARE_SREC;
+    }
+    return PAD_FIRMWARE_BINARY;
+}
+
+const char* pad_firmware_format_name(pad_firmware_format format) {
+    switch (format) {
+        case PAD_FIRMWARE_AUTO:   return "auto";
+        case PAD_FIRMWARE_BINARY: return "binary";
+        case PAD_FIRMWARE_IHEX:   return "Intel HEX";
+        case PAD_FIRMWARE_SREC:   return "S-record";
+        case PAD_FIRMWARE_ELF:    return "ELF";
+    }
+    return "unknown";
+}
+
+pad_firmware* pad_firmware_parse(const uint8_t* data, size_t length, const char* name,
+                                 pad_firmware_format format, uint32_t binary_address,
+                                 char* error, size_t error_size) {
+    if (error && error_size) error[0] = '\0';
+    if (!data && length) return NULL;
+
+    firmware_builder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.error = error;
+    builder.error_size = error_size;
+
+    if (format == PAD_FIRMWARE_AUTO) {
+        format = pad_firmware_detect(name, data, length);
+    }
+
+    int result;
+    switch (format) {
+        case PAD_FIRMWARE_IHEX:
+            result = firmware_parse_ihex(&builder, (const char*)data, length);
+            break;
+        case PAD_FIRMWARE_SREC:
+            result = firmware_parse_srec(&builder, (const char*)data, length);
+            break;
+        case PAD_FIRMWARE_ELF:
+            result = firmware_parse_elf(&builder, data, length);
+            break;
+        default:
+            result = firmware_add(&builder, binary_address, data, length);
+            break;
+    }
+
+    pad_firmware* firmware = result == 0 ? firmware_finish(&builder, format) : NULL;
+    free(builder.records);
+    free(builder.pool);
+    return firmware;
+}
+
+pad_firmware* pad_firmware_load(const char* filename, pad_firmware_format format,
+                                uint32_t binary_address, char* error, size_t error_size) {
+    if (error && error_size) error[0] = '\0';
+    if (!filename) return NULL;
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        if (error) snprintf(error, error_size, "cannot open %s", filename);
+        return NULL;
+    }
+    uint8_t* data = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    for (;;) {
+        if (length == capacity) {
+            capacity = capacity ? capacity * 2 : 256 * 1024;
+            uint8_t* grown = (uint8_t*)realloc(data, capacity);
+            if (!grown) {
+                if (error) snprintf(error, error_size, "out of memory");
+                free(data);
+                fclose(file);
+                return NULL;
+            }
+            data = grown;
+        }
+        size_t read = fread(data + length, 1, capacity - length, file);
+        if (read == 0) break;
+        length += read;
+    }
+    int failed = ferror(file);
+    fclose(file);
+    if (failed) {
+        if (error) snprintf(error, error_size, "read error on %s", filename);
+        free(data);
+        return NULL;
+    }
+
+    char detail[256];
+    pad_firmware* firmware = pad_firmware_parse(data, length, filename, format, binary_address,
+                                                detail, sizeof(detail));
+    if (!firmware && error) {
+        snprintf(error, error_size, "%s: %s", filename, detail);
+    }
+    free(data);
+    return firmware;
+}
+
+void pad_firmware_free(pad_firmware* firmware) {
+    if (!firmware) return;
+    free(firmware->segments);
+    pad_free(firmware->data);
+    free(firmware);
+}
+
+pad_firmware_format pad_firmware_get_format(const pad_firmware* firmware) {
+    return firmware ? firmware->format : PAD_FIRMWARE_AUTO;
+}
+
+size_t pad_firmware_segment_count(const pad_firmware* firmware) {
+    return firmware ? firmware->segment_count : 0;
+}
+
+const pad_firmware_segment* pad_firmware_segments(const pad_firmware* firmware) {
+    return firmware ? firmware->segments : NULL;
+}
+
+uint64_t pad_firmware_data_size(const pad_firmware* firmware) {
+    return firmware ? firmware->data_size : 0;
+}
+
+uint32_t pad_firmware_entry(const pad_firmware* firmware) {
+    return firmware ? firmware->entry : 0;
+}
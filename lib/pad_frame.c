@@ -0,0 +1,427 @@
+#ifdef __linux__
+    #define _GNU_SOURCE // memfd_create
+#endif
+
+#include "../include/common_types.h"
+#include "../include/pad_frame.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#define RING_PAGE_SIZE 4096
+
+#define SLIP_END     0xC0
+#define SLIP_ESC     0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+#define HDLC_FLAG    0x7E
+#define HDLC_ESC     0x7D
+#define HDLC_XOR     0x20
+
+struct pad_ring {
+    uint8_t* base;
+    size_t capacity;
+    size_t head;        // Offset of the first buffered byte
+    size_t length;
+    int mirrored;       // base[capacity, 2 * capacity) aliases base[0, capacity)
+};
+
+struct pad_framer {
+    pad_ring* ring;
+    pad_frame_format format;
+    size_t max_frame;
+    size_t scanned;     // Buffered bytes already searched for a delimiter
+    size_t returned;    // Bytes of the frame last returned, delimiter included
+    int discarding;     // Dropping an oversized frame up to its delimiter
+    uint64_t frames;
+    uint64_t errors;
+};
+
+// ---------------------------------------------------------------------------
+// Ring
+// ---------------------------------------------------------------------------
+
+#ifdef __linux__
+// Map one memfd twice, back to back; NULL if the kernel does not cooperate
+static uint8_t* ring_map_mirrored(size_t capacity) {
+    int fd = memfd_create("pad_ring", MFD_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, (off_t)capacity) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // Reserve both halves first so nothing else can land in between
+    uint8_t* base = (uint8_t*)mmap(NULL, 2 * capacity, PROT_NONE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * capacity);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    return base;
+}
+#endif
+
+pad_ring* pad_ring_create(size_t capacity) {
+    if (capacity == 0) return NULL;
+
+    pad_ring* ring = (pad_ring*)calloc(1, sizeof(pad_ring));
+    if (!ring) return NULL;
+    ring->capacity = (capacity + RING_PAGE_SIZE - 1) & ~(size_t)(RING_PAGE_SIZE - 1);
+
+#ifdef __linux__
+    ring->base = ring_map_mirrored(ring->capacity);
+    ring->mirrored = ring->base != NULL;
+#endif
+    if (!ring->base) {
+        ring->base = (uint8_t*)malloc(ring->capacity);
+        if (!ring->base) {
+            free(ring);
+            return NULL;
+        }
+    }
+    return ring;
+}
+
+void pad_ring_destroy(pad_ring* ring) {
+    if (!ring) return;
+#ifdef __linux__
+    if (ring->mirrored) {
+        munmap(ring->base, 2 * ring->capacity);
+        free(ring);
+        return;
+    }
+#endif
+    free(ring->base);
+    free(ring);
+}
+
+size_t pad_ring_capacity(const pad_ring* ring) {
+    return ring ? ring->capacity : 0;
+}
+
+size_t pad_ring_length(const pad_ring* ring) {
+    return ring ? ring->length : 0;
+}
+
+uint8_t* pad_ring_write_ptr(pad_ring* ring, size_t* space) {
+    if (!ring || !space) return NULL;
+
+    if (ring->mirrored) {
+        *space = ring->capacity - ring->length;
+        size_t tail = ring->head + ring->length;
+        if (tail >= ring->capacity) tail -= ring->capacity;
+        return ring->base + tail;
+    }
+
+    // Flat buffer: move the data to the front once the end is reached
+    if (ring->head > 0 && ring->head + ring->length == ring->capacity) {
+        memmove(ring->base, ring->base + ring->head, ring->length);
+        ring->head = 0;
+    }
+    *space = ring->capacity - ring->head - ring->length;
+    return ring->base + ring->head + ring->length;
+}
+
+void pad_ring_commit(pad_ring* ring, size_t length) {
+    if (!ring) return;
+    size_t space = ring->mirrored ? ring->capacity - ring->length
+                                  : ring->capacity - ring->head - ring->length;
+    ring->length += length < space ? length : space;
+}
+
+uint8_t* pad_ring_read_ptr(const pad_ring* ring, size_t* length) {
+    if (!ring || !length) return NULL;
+    *length = ring->length;
+    return ring->base + ring->head;
+}
+
+void pad_ring_consume(pad_ring* ring, size_t length) {
+    if (!ring) return;
+    if (length >= ring->length) {
+        ring->head = 0;
+        ring->length = 0;
+        return;
+    }
+    ring->head += length;
+    ring->length -= length;
+    if (ring->mirrored && ring->head >= ring->capacity) {
+        ring->head -= ring->capacity;
+    }
+}
+
+int pad_ring_fill(pad_ring* ring, serial_port_t* port) {
+    size_t space;
+    uint8_t* dest = pad_ring_write_ptr(ring, &space);
+    if (!dest || !port) return -1;
+    if (space == 0) return 0;
+
+    errno = 0;
+    int received = pad_serial_read(port, dest, space);
+    if (received < 0) {
+        // A port driven by a reactor is non-blocking
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    pad_ring_commit(ring, (size_t)received);
+    return received;
+}
+
+// ---------------------------------------------------------------------------
+// Framing
+// ---------------------------------------------------------------------------
+
+static uint8_t frame_delimiter(pad_frame_format format) {
+    switch (format) {
+        case PAD_FRAME_SLIP: return SLIP_END;
+        case PAD_FRAME_COBS: return 0x00;
+        default:             return HDLC_FLAG;
+    }
+}
+
+// Decode an encoded frame (without its delimiter) in place. The decoded form
+// is never longer, so writes never overtake reads. -1 if malformed.
+static long frame_decode(pad_frame_format format, uint8_t* data, size_t length) {
+    size_t in = 0, out = 0;
+
+    // Unescaped frames (the common case) decode to themselves
+    if (format != PAD_FRAME_COBS) {
+        const uint8_t* escape = (const uint8_t*)memchr(
+            data, format == PAD_FRAME_SLIP ? SLIP_ESC : HDLC_ESC, length);
+        if (!escape) return (long)length;
+        in = out = (size_t)(escape - data);
+    }
+
+    switch (format) {
+        case PAD_FRAME_SLIP:
+            while (in < length) {
+                uint8_t byte = data[in++];
+                if (byte == SLIP_ESC) {
+                    if (in == length) return -1;
+                    byte = data[in++];
+                    if (byte == SLIP_ESC_END) byte = SLIP_END;
+                    else if (byte == SLIP_ESC_ESC) byte = SLIP_ESC;
+                    else return -1;
+                }
+                data[out++] = byte;
+            }
+            break;
+
+        case PAD_FRAME_HDLC:
+            while (in < length) {
+                uint8_t byte = data[in++];
+                if (byte == HDLC_ESC) {
+                    if (in == length) return -1;
+                    byte = data[in++] ^ HDLC_XOR;
+                }
+                data[out++] = byte;
+            }
+            break;
+
+        case PAD_FRAME_COBS:
+            while (in < length) {
+                uint8_t code = data[in++];
+                size_t run = (size_t)code - 1;
+                if (run > length - in) return -1;
+                memmove(data + out, data + in, run);
+                in += run;
+                out += run;
+                // A full 0xFF block carries no implied zero, nor does the last block
+                if (code != 0xFF && in < length) {
+                    data[out++] = 0x00;
+                }
+            }
+            break;
+    }
+    return (long)out;
+}
+
+pad_framer* pad_framer_create(pad_frame_format format, size_t ring_capacity, size_t max_frame) {
+    if (format != PAD_FRAME_SLIP && format != PAD_FRAME_COBS && format != PAD_FRAME_HDLC) {
+        return NULL;
+    }
+
+    pad_framer* framer = (pad_framer*)calloc(1, sizeof(pad_framer));
+    if (!framer) return NULL;
+    framer->ring = pad_ring_create(ring_capacity);
+    if (!framer->ring) {
+        free(framer);
+        return NULL;
+    }
+    framer->format = format;
+
+    // A frame and its delimiter must fit in the ring to ever be seen whole
+    size_t limit = framer->ring->capacity - 1;
+    framer->max_frame = max_frame == 0 || max_frame > limit ? limit : max_frame;
+    return framer;
+}
+
+void pad_framer_destroy(pad_framer* framer) {
+    if (!framer) return;
+    pad_ring_destroy(framer->ring);
+    free(framer);
+}
+
+pad_ring* pad_framer_ring(pad_framer* framer) {
+    return framer ? framer->ring : NULL;
+}
+
+// Release the frame handed out by the previous pad_framer_next
+static void framer_release(pad_framer* framer) {
+    if (framer->returned) {
+        pad_ring_consume(framer->ring, framer->returned);
+        framer->returned = 0;
+    }
+}
+
+int pad_framer_fill(pad_framer* framer, serial_port_t* port) {
+    if (!framer) return -1;
+    framer_release(framer);
+    return pad_ring_fill(framer->ring, port);
+}
+
+int pad_framer_next(pad_framer* framer, pad_frame* frame) {
+    if (!framer || !frame) return -1;
+    framer_release(framer);
+
+    uint8_t delimiter = frame_delimiter(framer->format);
+    for (;;) {
+        size_t length = 0;
+        uint8_t* data = pad_ring_read_ptr(framer->ring, &length);
+        if (framer->scanned > length) {
+            framer->scanned = 0; // The ring was consumed directly
+        }
+        uint8_t* end = (uint8_t*)memchr(data + framer->scanned, delimiter,
+                                        length - framer->scanned);
+        if (!end) {
+            framer->scanned = length;
+            if (length > framer->max_frame) {
+                // Too long to be a frame: drop it and resynchronize
+                pad_ring_consume(framer->ring, length);
+                framer->scanned = 0;
+                if (!framer->discarding) {
+                    framer->discarding = 1;
+                    framer->errors++;
+                    return -1;
+                }
+            }
+            return 0;
+        }
+
+        size_t encoded = (size_t)(end - data);
+        framer->scanned = 0;
+        if (framer->discarding || encoded == 0) {
+            // Tail of a dropped frame, or an empty frame
+            framer->discarding = 0;
+            pad_ring_consume(framer->ring, encoded + 1);
+            continue;
+        }
+        if (encoded > framer->max_frame) {
+            pad_ring_consume(framer->ring, encoded + 1);
+            framer->errors++;
+            return -1;
+        }
+
+        long decoded = frame_decode(framer->format, data, encoded);
+        if (decoded < 0) {
+            pad_ring_consume(framer->ring, encoded + 1);
+            framer->errors++;
+            return -1;
+        }
+        frame->data = data;
+        frame->length = (size_t)decoded;
+        framer->returned = encoded + 1;
+        framer->frames++;
+        return 1;
+    }
+}
+
+void pad_framer_release(pad_framer* framer) {
+    if (!framer) return;
+    framer_release(framer);
+}
+
+void pad_framer_reset(pad_framer* framer) {
+    if (!framer) return;
+    size_t length;
+    pad_ring_read_ptr(framer->ring, &length);
+    pad_ring_consume(framer->ring, length);
+    framer->returned = 0;
+    framer->scanned = 0;
+    framer->discarding = 0;
+}
+
+uint64_t pad_framer_frames(const pad_framer* framer) {
+    return framer ? framer->frames : 0;
+}
+
+uint64_t pad_framer_errors(const pad_framer* framer) {
+    return framer ? framer->errors : 0;
+}
+
+size_t pad_frame_encoded_max(pad_frame_format format, size_t length) {
+    if (format == PAD_FRAME_COBS) {
+        return length + length / 254 + 2;
+    }
+    return 2 * length + 2; // Every byte escaped, plus both delimiters
+}
+
+int pad_frame_encode(pad_frame_format format, const uint8_t* data, size_t length,
+                     uint8_t* dest, size_t dest_size) {
+    if ((!data && length) || !dest) return -1;
+    size_t out = 0;
+
+    if (format == PAD_FRAME_COBS) {
+        // Each block is a code byte followed by up to 254 non-zero bytes
+        size_t code_at = out++;
+        uint8_t code = 1;
+        for (size_t i = 0; i < length; i++) {
+            if (out + 2 > dest_size) return -1;
+            if (data[i] != 0) {
+                dest[out++] = data[i];
+                code++;
+            }
+            if (data[i] == 0 || code == 0xFF) {
+                dest[code_at] = code;
+                code_at = out++;
+                code = 1;
+            }
+        }
+        if (out + 1 > dest_size) return -1;
+        dest[code_at] = code;
+        dest[out++] = 0x00;
+        return (int)out;
+    }
+
+    uint8_t delimiter = frame_delimiter(format);
+    if (dest_size < 2) return -1;
+    dest[out++] = delimiter;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        if (out + 3 > dest_size) return -1;
+        if (format == PAD_FRAME_SLIP && (byte == SLIP_END || byte == SLIP_ESC)) {
+            dest[out++] = SLIP_ESC;
+            dest[out++] = byte == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC;
+        } else if (format == PAD_FRAME_HDLC && (byte == HDLC_FLAG || byte == HDLC_ESC)) {
+            dest[out++] = HDLC_ESC;
+            dest[out++] = byte ^ HDLC_XOR;
+        } else {
+            dest[out++] = byte;
+        }
+    }
+    dest[out++] = delimiter;
+    return (int)out;
+}
@@ -0,0 +1,523 @@
+#include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include "../include/pad_json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_MAX_DEPTH 64
+#define JSON_READ_CHUNK (64 * 1024)
+
+typedef enum {
+    JSON_STATE_VALUE,             // Expecting a value
+    JSON_STATE_ARRAY_FIRST,       // After '[': a value or ']'
+    JSON_STATE_OBJECT_FIRST,      // After '{': a key or '}'
+    JSON_STATE_KEY,               // After ',' in an object
+    JSON_STATE_COLON,
+    JSON_STATE_AFTER_VALUE,       // ',' or a closing bracket
+    JSON_STATE_DONE,              // Root value complete: only whitespace may follow
+    JSON_STATE_STRING,
+    JSON_STATE_ESCAPE,
+    JSON_STATE_UNICODE,
+    JSON_STATE_NUMBER,
+    JSON_STATE_LITERAL,
+    JSON_STATE_COMMENT_START,
+    JSON_STATE_LINE_COMMENT,
+    JSON_STATE_BLOCK_COMMENT,
+    JSON_STATE_BLOCK_COMMENT_END,
+    JSON_STATE_ERROR
+} json_state;
+
+struct pad_json_parser {
+    pad_json_callback callback;
+    void* user;
+    json_state state;
+    json_state resume_state;      // Where a comment returns to
+
+    char stack[JSON_MAX_DEPTH];   // '{' or '[' per open container
+    int depth;
+
+    char* token;                  // String or number being parsed
+    size_t token_length;
+    size_t token_capacity;
+    int string_is_key;
+    char* key;                    // Member name of the value being parsed
+    size_t key_capacity;
+
+    uint32_t code_point;          // \uXXXX escape in progress
+    int code_digits;
+    uint32_t high_surrogate;
+
+    const char* literal;          // "true", "false" or "null" in progress
+    size_t literal_position;
+    pad_json_event literal_event;
+
+    size_t line;
+    const char* error;
+};
+
+static int json_fail(pad_json_parser* parser, const char* message) {
+    parser->state = JSON_STATE_ERROR;
+    parser->error = message;
+    return -1;
+}
+
+static int json_reserve(pad_json_parser* parser, size_t extra) {
+    size_t needed = parser->token_length + extra + 1; // Room for the terminator
+    if (needed <= parser->token_capacity) return 0;
+
+    size_t capacity = parser->token_capacity ? parser->token_capacity : 256;
+    while (capacity < needed) capacity *= 2;
+    char* token = (char*)realloc(parser->token, capacity);
+    if (!token) return json_fail(parser, "out of memory");
+    parser->token = token;
+    parser->token_capacity = capacity;
+    return 0;
+}
+
+static int json_append(pad_json_parser* parser, const char* data, size_t length) {
+    if (json_reserve(parser, length) != 0) return -1;
+    memcpy(parser->token + parser->token_length, data, length);
+    parser->token_length += length;
+    return 0;
+}
+
+static int json_emit(pad_json_parser* parser, pad_json_event event, const char* value, size_t length) {
+    const char* key = NULL;
+    if (event != PAD_JSON_OBJECT_END && event != PAD_JSON_ARRAY_END &&
+        parser->depth > 0 && parser->stack[parser->depth - 1] == '{') {
+        key = parser->key;
+    }
+    if (parser->callback(parser->user, event, key, value, length, parser->depth) != 0) {
+        return json_fail(parser, "stopped by callback");
+    }
+    return 0;
+}
+
+static void json_value_done(pad_json_parser* parser) {
+    parser->state = parser->depth == 0 ? JSON_STATE_DONE : JSON_STATE_AFTER_VALUE;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static int json_valid_number(const char* text, size_t length) {
+    const char* p = text;
+    const char* end = text + length;
+    if (p < end && *p == '-') p++;
+    if (p == end) return 0;
+    if (*p == '0') {
+        p++;
+    } else if (*p >= '1' && *p <= '9') {
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    } else {
+        return 0;
+    }
+    if (p < end && *p == '.') {
+        const char* digits = ++p;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+        if (p == digits) return 0;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        const char* digits = p;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+        if (p == digits) return 0;
+    }
+    return p == end;
+}
+
+static int json_end_number(pad_json_parser* parser) {
+    if (!json_valid_number(parser->token, parser->token_length)) {
+        return json_fail(parser, "invalid number");
+    }
+    parser->token[parser->token_length] = '\0';
+    if (json_emit(parser, PAD_JSON_NUMBER, parser->token, parser->token_length) != 0) return -1;
+    json_value_done(parser);
+    return 0;
+}
+
+static int json_end_string(pad_json_parser* parser) {
+    if (parser->high_surrogate) {
+        return json_fail(parser, "unpaired surrogate escape");
+    }
+    if (json_reserve(parser, 0) != 0) return -1; // An empty string has no buffer yet
+    parser->token[parser->token_length] = '\0';
+
+    if (parser->string_is_key) {
+        // The key buffer takes over the token; the old key buffer is reused
+        char* key = parser->key;
+        size_t key_capacity = parser->key_capacity;
+        parser->key = parser->token;
+        parser->key_capacity = parser->token_capacity;
+        parser->token = key;
+        parser->token_capacity = key_capacity;
+        parser->state = JSON_STATE_COLON;
+        return 0;
+    }
+
+    if (json_emit(parser, PAD_JSON_STRING, parser->token, parser->token_length) != 0) return -1;
+    json_value_done(parser);
+    return 0;
+}
+
+static void json_begin_string(pad_json_parser* parser, int is_key) {
+    parser->token_length = 0;
+    parser->string_is_key = is_key;
+    parser->state = JSON_STATE_STRING;
+}
+
+static int json_append_code_point(pad_json_parser* parser, uint32_t cp) {
+    char utf8[4];
+    size_t length;
+    if (cp < 0x80) {
+        utf8[0] = (char)cp;
+        length = 1;
+    } else if (cp < 0x800) {
+        utf8[0] = (char)(0xC0 | (cp >> 6));
+        utf8[1] = (char)(0x80 | (cp & 0x3F));
+        length = 2;
+    } else if (cp < 0x10000) {
+        utf8[0] = (char)(0xE0 | (cp >> 12));
+        utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (cp & 0x3F));
+        length = 3;
+    } else {
+        utf8[0] = (char)(0xF0 | (cp >> 18));
+        utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (cp & 0x3F));
+        length = 4;
+    }
+    return json_append(parser, utf8, length);
+}
+
+static int json_end_unicode(pad_json_parser* parser) {
+    uint32_t cp = parser->code_point;
+    if (parser->high_surrogate) {
+        if (cp < 0xDC00 || cp > 0xDFFF) {
+            return json_fail(parser, "unpaired surrogate escape");
+        }
+        cp = 0x10000 + ((parser->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+        parser->high_surrogate = 0;
+    } else if (cp >= 0xD800 && cp <= 0xDBFF) {
+        parser->high_surrogate = cp; // Must be followed by a low surrogate escape
+        parser->state = JSON_STATE_STRING;
+        return 0;
+    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        return json_fail(parser, "unpaired surrogate escape");
+    }
+    parser->state = JSON_STATE_STRING;
+    return json_append_code_point(parser, cp);
+}
+
+static int json_push(pad_json_parser* parser, char bracket, pad_json_event event) {
+    if (parser->depth == JSON_MAX_DEPTH) {
+        return json_fail(parser, "nesting too deep");
+    }
+    if (json_emit(parser, event, NULL, 0) != 0) return -1;
+    parser->stack[parser->depth++] = bracket;
+    parser->state = bracket == '{' ? JSON_STATE_OBJECT_FIRST : JSON_STATE_ARRAY_FIRST;
+    return 0;
+}
+
+static int json_pop(pad_json_parser* parser) {
+    char bracket = parser->stack[--parser->depth];
+    pad_json_event event = bracket == '{' ? PAD_JSON_OBJECT_END : PAD_JSON_ARRAY_END;
+    if (json_emit(parser, event, NULL, 0) != 0) return -1;
+    json_value_done(parser);
+    return 0;
+}
+
+static int json_begin_value(pad_json_parser* parser, char c) {
+    switch (c) {
+        case '"':
+            json_begin_string(parser, 0);
+            return 0;
+        case '{':
+            return json_push(parser, '{', PAD_JSON_OBJECT_BEGIN);
+        case '[':
+            return json_push(parser, '[', PAD_JSON_ARRAY_BEGIN);
+        case 't':
+            parser->literal = "true";
+            parser->literal_event = PAD_JSON_TRUE;
+            break;
+        case 'f':
+            parser->literal = "false";
+            parser->literal_event = PAD_JSON_FALSE;
+            break;
+        case 'n':
+            parser->literal = "null";
+            parser->literal_event = PAD_JSON_NULL;
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                parser->token_length = 0;
+                parser->state = JSON_STATE_NUMBER;
+                return json_append(parser, &c, 1);
+            }
+            return json_fail(parser, "unexpected character");
+    }
+    parser->literal_position = 1;
+    parser->state = JSON_STATE_LITERAL;
+    return 0;
+}
+
+static int json_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Process one character outside a string run. Returns 1 if it was consumed,
+// 0 if it must be processed again in the new state, -1 on error.
+static int json_step(pad_json_parser* parser, char c) {
+    json_state state = parser->state;
+
+    // Whitespace and comments may appear between any two tokens
+    if (state <= JSON_STATE_DONE) {
+        if (json_is_space(c)) return 1;
+        if (c == '/') {
+            parser->resume_state = state;
+            parser->state = JSON_STATE_COMMENT_START;
+            return 1;
+        }
+    }
+
+    switch (state) {
+        case JSON_STATE_ARRAY_FIRST:
+            if (c == ']') return json_pop(parser) == 0 ? 1 : -1;
+            /* fall through */
+        case JSON_STATE_VALUE:
+            return json_begin_value(parser, c) == 0 ? 1 : -1;
+
+        case JSON_STATE_OBJECT_FIRST:
+            if (c == '}') return json_pop(parser) == 0 ? 1 : -1;
+            /* fall through */
+        case JSON_STATE_KEY:
+            if (c != '"') return json_fail(parser, "expected a member name");
+            json_begin_string(parser, 1);
+            return 1;
+
+        case JSON_STATE_COLON:
+            if (c != ':') return json_fail(parser, "expected ':'");
+            parser->state = JSON_STATE_VALUE;
+            return 1;
+
+        case JSON_STATE_AFTER_VALUE: {
+            char bracket = parser->stack[parser->depth - 1];
+            if (c == ',') {
+                parser->state = bracket == '{' ? JSON_STATE_KEY : JSON_STATE_VALUE;
+                return 1;
+            }
+            if ((c == '}' && bracket == '{') || (c == ']' && bracket == '[')) {
+                return json_pop(parser) == 0 ? 1 : -1;
+            }
+            return json_fail(parser, bracket == '{' ? "expected ',' or '}'" : "expected ',' or ']'");
+        }
+
+        case JSON_STATE_DONE:
+            return json_fail(parser, "unexpected data after the document");
+
+        case JSON_STATE_ESCAPE: {
+            if (parser->high_surrogate && c != 'u') {
+                return json_fail(parser, "unpaired surrogate escape");
+            }
+            char decoded;
+            switch (c) {
+                case '"':  decoded = '"';  break;
+                case '\\': decoded = '\\'; break;
+                case '/':  decoded = '/';  break;
+                case 'b':  decoded = '\b'; break;
+                case 'f':  decoded = '\f'; break;
+                case 'n':  decoded = '\n'; break;
+                case 'r':  decoded = '\r'; break;
+                case 't':  decoded = '\t'; break;
+                case 'u':
+                    parser->code_point = 0;
+                    parser->code_digits = 0;
+                    parser->state = JSON_STATE_UNICODE;
+                    return 1;
+                default:
+                    return json_fail(parser, "invalid escape");
+            }
+            parser->state = JSON_STATE_STRING;
+            return json_append(parser, &decoded, 1) == 0 ? 1 : -1;
+        }
+
+        case JSON_STATE_UNICODE: {
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') digit = (uint32_t)(c - 'A' + 10);
+            else return json_fail(parser, "invalid \\u escape");
+            parser->code_point = (parser->code_point << 4) | digit;
+            if (++parser->code_digits == 4) {
+                return json_end_unicode(parser) == 0 ? 1 : -1;
+            }
+            return 1;
+        }
+
+        case JSON_STATE_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                return json_append(parser, &c, 1) == 0 ? 1 : -1;
+            }
+            return json_end_number(parser) == 0 ? 0 : -1;
+
+        case JSON_STATE_LITERAL:
+            if (c != parser->literal[parser->literal_position]) {
+                return json_fail(parser, "invalid literal");
+            }
+            if (parser->literal[++parser->literal_position] == '\0') {
+                if (json_emit(parser, parser->literal_event, NULL, 0) != 0) return -1;
+                json_value_done(parser);
+            }
+            return 1;
+
+        case JSON_STATE_COMMENT_START:
+            if (c == '/') parser->state = JSON_STATE_LINE_COMMENT;
+            else if (c == '*') parser->state = JSON_STATE_BLOCK_COMMENT;
+            else return json_fail(parser, "unexpected character");
+            return 1;
+
+        case JSON_STATE_LINE_COMMENT:
+            if (c == '\n') parser->state = parser->resume_state;
+            return 1;
+
+        case JSON_STATE_BLOCK_COMMENT:
+            if (c == '*') parser->state = JSON_STATE_BLOCK_COMMENT_END;
+            return 1;
+
+        case JSON_STATE_BLOCK_COMMENT_END:
+            if (c == '/') parser->state = parser->resume_state;
+            else if (c != '*') parser->state = JSON_STATE_BLOCK_COMMENT;
+            return 1;
+
+        default:
+            return -1;
+    }
+}
+
+pad_json_parser* pad_json_parser_create(pad_json_callback callback, void* user) {
+    if (!callback) return NULL;
+
+    pad_json_parser* parser = (pad_json_parser*)calloc(1, sizeof(pad_json_parser));
+    if (!parser) return NULL;
+    parser->callback = callback;
+    parser->user = user;
+    parser->state = JSON_STATE_VALUE;
+    parser->line = 1;
+    return parser;
+}
+
+void pad_json_parser_destroy(pad_json_parser* parser) {
+    if (!parser) return;
+    free(parser->token);
+    free(parser->key);
+    free(parser);
+}
+
+int pad_json_parser_feed(pad_json_parser* parser, const char* data, size_t length) {
+    if (!parser || (!data && length)) return -1;
+    if (parser->state == JSON_STATE_ERROR) return -1;
+
+    size_t i = 0;
+    while (i < length) {
+        if (parser->state == JSON_STATE_STRING) {
+            // Copy the run of plain characters in one go
+            size_t start = i;
+            while (i < length && data[i] != '"' && data[i] != '\\' && (uint8_t)data[i] >= 0x20) {
+                i++;
+            }
+            if (i > start) {
+                if (parser->high_surrogate) return json_fail(parser, "unpaired surrogate escape");
+                if (json_append(parser, data + start, i - start) != 0) return -1;
+            }
+            if (i == length) break;
+
+            char c = data[i++];
+            if (c == '"') {
+                if (json_end_string(parser) != 0) return -1;
+            } else if (c == '\\') {
+                parser->state = JSON_STATE_ESCAPE;
+            } else {
+                return json_fail(parser, "control character in string");
+            }
+            continue;
+        }
+
+        int consumed = json_step(parser, data[i]);
+        if (consumed < 0) return -1;
+        if (consumed) {
+            if (data[i] == '\n') parser->line++;
+            i++;
+        }
+    }
+    return 0;
+}
+
+int pad_json_parser_finish(pad_json_parser* parser) {
+    if (!parser || parser->state == JSON_STATE_ERROR) return -1;
+
+    if (parser->state == JSON_STATE_NUMBER && json_end_number(parser) != 0) {
+        return -1;
+    }
+    if (parser->state == JSON_STATE_LINE_COMMENT && parser->resume_state == JSON_STATE_DONE) {
+        parser->state = JSON_STATE_DONE;
+    }
+    if (parser->state != JSON_STATE_DONE) {
+        return json_fail(parser, "unexpected end of input");
+    }
+    return 0;
+}
+
+const char* pad_json_parser_error(const pad_json_parser* parser) {
+    return parser && parser->error ? parser->error : "";
+}
+
+size_t pad_json_parser_line(const pad_json_parser* parser) {
+    return parser ? parser->line : 0;
+}
+
+int pad_json_parse_file(const char* filename, pad_json_callback callback, void* user,
+                        char* error, size_t error_size) {
+    if (error && error_size) error[0] = '\0';
+    if (!filename || !callback) return -1;
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        if (error) snprintf(error, error_size, "cannot open %s", filename);
+        return -1;
+    }
+
+    pad_json_parser* parser = pad_json_parser_create(callback, user);
+    char* chunk = (char*)pad_malloc(JSON_READ_CHUNK);
+    if (!parser || !chunk) {
+        if (error) snprintf(error, error_size, "out of memory");
+        pad_json_parser_destroy(parser);
+        pad_free(chunk);
+        fclose(file);
+        return -1;
+    }
+
+    int result = 0;
+    size_t length;
+    while ((length = fread(chunk, 1, JSON_READ_CHUNK, file)) > 0) {
+        if (pad_json_parser_feed(parser, chunk, length) != 0) {
+            result = -1;
+            break;
+        }
+    }
+    if (result == 0 && ferror(file)) {
+        if (error) snprintf(error, error_size, "read error on %s", filename);
+        result = -2;
+    } else if (result == 0) {
+        result = pad_json_parser_finish(parser);
+    }
+    if (result == -1 && error) {
+        snprintf(error, error_size, "%s:%zu: %s", filename,
+                 pad_json_parser_line(parser), pad_json_parser_error(parser));
+    }
+
+    pad_json_parser_destroy(parser);
+    pad_free(chunk);
+    fclose(file);
+    return result < 0 ? -1 : 0;
+}
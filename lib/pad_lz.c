@@ -0,0 +1,165 @@
+#include "../include/pad_lz.h"
+#include <string.h>
+
+// LZ4 block format limits: matches are at least 4 bytes, the last match
+// starts 12 or more bytes before the end and the last 5 bytes are literals
+#define LZ_MIN_MATCH      4
+#define LZ_MATCH_LIMIT    12
+#define LZ_LAST_LITERALS  5
+#define LZ_MAX_OFFSET     65535
+#define LZ_HASH_BITS      12
+#define LZ_NO_POSITION    0xFFFFFFFFu
+
+static uint32_t lz_read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t lz_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Length beyond the token's 15: 255 per byte, then the remainder
+static uint8_t* lz_put_length(uint8_t* out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+// Emit literals and, if match_length is not 0, the match after them.
+// NULL if output would overflow.
+static uint8_t* lz_put_sequence(uint8_t* out, const uint8_t* out_end, const uint8_t* literals,
+                                size_t literal_length, size_t offset, size_t match_length) {
+    size_t needed = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+    if (needed > (size_t)(out_end - out)) {
+        return NULL;
+    }
+
+    size_t match_code = match_length ? match_length - LZ_MIN_MATCH : 0;
+    uint8_t* token = out++;
+    *token = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+    if (literal_length >= 15) {
+        out = lz_put_length(out, literal_length - 15);
+    }
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    if (match_length) {
+        *out++ = (uint8_t)offset;
+        *out++ = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)(match_code < 15 ? match_code : 15);
+        if (match_code >= 15) {
+            out = lz_put_length(out, match_code - 15);
+        }
+    }
+    return out;
+}
+
+size_t pad_lz_bound(size_t input_size) {
+    return input_size + input_size / 255 + 16;
+}
+
+size_t pad_lz_compress(const uint8_t* input, size_t input_size,
+                       uint8_t* output, size_t output_capacity) {
+    uint32_t table[1u << LZ_HASH_BITS];
+    memset(table, 0xFF, sizeof(table));
+
+    uint8_t* out = output;
+    const uint8_t* out_end = output + output_capacity;
+    size_t anchor = 0;                 // First byte not yet emitted
+    size_t position = 0;
+
+    if (input_size > LZ_MATCH_LIMIT) {
+        size_t match_start_limit = input_size - LZ_MATCH_LIMIT;
+        size_t match_end_limit = input_size - LZ_LAST_LITERALS;
+        while (position < match_start_limit) {
+            uint32_t sequence = lz_read32(input + position);
+            uint32_t hash = lz_hash(sequence);
+            size_t candidate = table[hash];
+            table[hash] = (uint32_t)position;
+            if (candidate == LZ_NO_POSITION || position - candidate > LZ_MAX_OFFSET ||
+                lz_read32(input + candidate) != sequence) {
+                position++;
+                continue;
+            }
+
+            size_t length = LZ_MIN_MATCH;
+            while (position + length < match_end_limit &&
+                   input[candidate + length] == input[position + length]) {
+                length++;
+            }
+            // Take in literals that also match
+            while (position > anchor && candidate > 0 && input[position - 1] == input[candidate - 1]) {
+                position--;
+                candidate--;
+                length++;
+            }
+
+            out = lz_put_sequence(out, out_end, input + anchor, position - anchor,
+                                  position - candidate, length);
+            if (!out) return 0;
+            position += length;
+            anchor = position;
+        }
+    }
+
+    out = lz_put_sequence(out, out_end, input + anchor, input_size - anchor, 0, 0);
+    return out ? (size_t)(out - output) : 0;
+}
+
+// Read a length continued past the token's 15; -1 on truncation
+static int lz_get_length(const uint8_t** in, const uint8_t* in_end, size_t* length) {
+    uint8_t byte;
+    do {
+        if (*in >= in_end) return -1;
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+int pad_lz_decompress(const uint8_t* input, size_t input_size,
+                      uint8_t* output, size_t output_capacity, size_t* output_size) {
+    const uint8_t* in = input;
+    const uint8_t* in_end = input + input_size;
+    size_t out = 0;
+
+    while (in < in_end) {
+        uint8_t token = *in++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && lz_get_length(&in, in_end, &literal_length) != 0) {
+            return -1;
+        }
+        if (literal_length > (size_t)(in_end - in) || literal_length > output_capacity - out) {
+            return -1;
+        }
+        memcpy(output + out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+        if (in == in_end) {
+            break;                     // The last sequence has no match
+        }
+
+        if (in_end - in < 2) return -1;
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > out) return -1;
+        size_t match_length = token & 15;
+        if (match_length == 15 && lz_get_length(&in, in_end, &match_length) != 0) {
+            return -1;
+        }
+        match_length += LZ_MIN_MATCH;
+        if (match_length > output_capacity - out) return -1;
+        // Byte by byte: the match may overlap what it produces
+        for (size_t i = 0; i < match_length; i++, out++) {
+            output[out] = output[out - offset];
+        }
+    }
+
+    *output_size = out;
+    return 0;
+}
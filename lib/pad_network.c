@@ -1,4 +1,5 @@
 #include "../include/common_types.h"
+#include "../include/pad_network.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,14 +18,21 @@
 #endif
 
 // Structure to represent a network socket
-typedef struct {
+struct network_socket {
 #ifdef _WIN32
     SOCKET sock;
 #else
     int sock;
 #endif
     int is_connected;
-} network_socket_t;
+    pad_allocator allocator;
+};
+
+// Release a socket object through the allocator it came from
+static void network_socket_release(network_socket_t* net_sock) {
+    pad_allocator allocator = net_sock->allocator;
+    pad_allocator_free(&allocator, net_sock);
+}
 
 // Initialize network subsystem (Windows)
 int pad_network_init(void) {
@@ -47,21 +55,29 @@ int pad_network_cleanup(void) {
 
 // Create a TCP socket
 network_socket_t* pad_tcp_create_socket(void) {
-    network_socket_t* net_sock = (network_socket_t*)malloc(sizeof(network_socket_t));
+    return pad_tcp_create_socket_with(NULL);
+}
+
+// Create a TCP socket, allocating the socket object from an arena or pool
+network_socket_t* pad_tcp_create_socket_with(const pad_allocator* allocator) {
+    network_socket_t* net_sock = (network_socket_t*)pad_allocator_alloc(allocator, sizeof(network_socket_t));
     if (!net_sock) return NULL;
     
     memset(net_sock, 0, sizeof(network_socket_t));
+    if (allocator) {
+        net_sock->allocator = *allocator;
+    }
     
 #ifdef _WIN32
     net_sock->sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (net_sock->sock == INVALID_SOCKET) {
-        free(net_sock);
+        network_socket_release(net_sock);
         return NULL;
     }
 #else
     net_sock->sock = socket(AF_INET, SOCK_STREAM, 0);
     if (net_sock->sock < 0) {
-        free(net_sock);
+        network_socket_release(net_sock);
         return NULL;
     }
 #endif
@@ -164,7 +180,7 @@ int pad_tcp_close(network_socket_t* net_sock) {
         net_sock->is_connected = 0;
     }
     
-    free(net_sock);
+    network_socket_release(net_sock);
     return 0;
 }
 
@@ -1,7 +1,10 @@
 #include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include "../include/pad_serial.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -11,23 +14,114 @@
     #include <termios.h>
     #include <errno.h>
     #include <sys/ioctl.h>
+    #include <poll.h>
 #endif
 
-typedef struct {
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <linux/serial.h>
+#endif
+
+// Arbitrary line speeds through termios2. Declared here because the kernel's
+// own header clashes with <termios.h>; the layout is fixed by the ioctl ABI.
+#if defined(__linux__) && defined(TCGETS2)
+    #define SERIAL_HAVE_TERMIOS2 1
+    #ifndef BOTHER
+        #define BOTHER 0010000
+    #endif
+struct termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+#endif
+
+struct serial_watch;
+
+struct serial_port {
 #ifdef _WIN32
     HANDLE handle;
 #else
     int fd;
 #endif
     int is_open;
-} serial_port_t;
+    pad_allocator allocator;
+    struct serial_watch* watch; // Reactor registration, if any
+};
+
+#ifndef _WIN32
+// Bxxx constant for a standard rate, 0 if there is none
+static speed_t serial_standard_speed(int baud_rate) {
+    static const struct { int rate; speed_t speed; } rates[] = {
+        {1200, B1200}, {2400, B2400}, {4800, B4800}, {9600, B9600},
+        {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200},
+        {230400, B230400},
+#ifdef B460800
+        {460800, B460800}, {500000, B500000}, {576000, B576000}, {921600, B921600},
+        {1000000, B1000000}, {1152000, B1152000}, {1500000, B1500000},
+        {2000000, B2000000}, {2500000, B2500000}, {3000000, B3000000},
+        {3500000, B3500000}, {4000000, B4000000},
+#endif
+    };
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        if (rates[i].rate == baud_rate) return rates[i].speed;
+    }
+    return 0;
+}
+
+// Apply tty with the given line speed; non-standard rates need termios2
+static int serial_apply_termios(int fd, struct termios* tty, int baud_rate) {
+    speed_t speed = serial_standard_speed(baud_rate);
+    if (speed) {
+        cfsetospeed(tty, speed);
+        cfsetispeed(tty, speed);
+        return tcsetattr(fd, TCSANOW, tty);
+    }
+
+#ifdef SERIAL_HAVE_TERMIOS2
+    if (baud_rate <= 0 || tcsetattr(fd, TCSANOW, tty) != 0) return -1;
+
+    struct termios2 tty2;
+    if (ioctl(fd, TCGETS2, &tty2) != 0) return -1;
+    tty2.c_cflag &= ~(tcflag_t)(CBAUD | CIBAUD);
+    tty2.c_cflag |= BOTHER;
+    tty2.c_ispeed = (speed_t)baud_rate;
+    tty2.c_ospeed = (speed_t)baud_rate;
+    return ioctl(fd, TCSETS2, &tty2);
+#else
+    errno = EINVAL;
+    return -1;
+#endif
+}
+#endif
+
+// Release a port object through the allocator it came from
+static void serial_port_release(serial_port_t* port) {
+    pad_allocator allocator = port->allocator;
+    pad_allocator_free(&allocator, port);
+}
 
 // Open serial port
 serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
-    serial_port_t* port = (serial_port_t*)malloc(sizeof(serial_port_t));
+    return pad_serial_open_with(port_name, baud_rate, NULL);
+}
+
+// Open serial port, allocating the port object from an arena or pool
+serial_port_t* pad_serial_open_with(const char* port_name, int baud_rate,
+                                    const pad_allocator* allocator) {
+    serial_port_t* port = (serial_port_t*)pad_allocator_alloc(allocator, sizeof(serial_port_t));
     if (!port) return NULL;
     
     memset(port, 0, sizeof(serial_port_t));
+    if (allocator) {
+        port->allocator = *allocator;
+    }
     
 #ifdef _WIN32
     char full_port_name[256];
@@ -44,7 +138,7 @@ serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
     );
     
     if (port->handle == INVALID_HANDLE_VALUE) {
-        free(port);
+        serial_port_release(port);
         return NULL;
     }
     
@@ -52,7 +146,7 @@ serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
     dcb.DCBlength = sizeof(dcb);
     if (!GetCommState(port->handle, &dcb)) {
         CloseHandle(port->handle);
-        free(port);
+        serial_port_release(port);
         return NULL;
     }
     
@@ -63,7 +157,7 @@ serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
     
     if (!SetCommState(port->handle, &dcb)) {
         CloseHandle(port->handle);
-        free(port);
+        serial_port_release(port);
         return NULL;
     }
     
@@ -76,28 +170,25 @@ serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
     
     if (!SetCommTimeouts(port->handle, &timeouts)) {
         CloseHandle(port->handle);
-        free(port);
+        serial_port_release(port);
         return NULL;
     }
     
     port->is_open = 1;
 #else
-    port->fd = open(port_name, O_RDWR | O_NOCTTY | O_SYNC);
+    port->fd = open(port_name, O_RDWR | O_NOCTTY);
     if (port->fd < 0) {
-        free(port);
+        serial_port_release(port);
         return NULL;
     }
     
     struct termios tty;
     if (tcgetattr(port->fd, &tty) != 0) {
         close(port->fd);
-        free(port);
+        serial_port_release(port);
         return NULL;
     }
     
-    cfsetospeed(&tty, baud_rate);
-    cfsetispeed(&tty, baud_rate);
-    
     tty.c_cflag &= ~PARENB;  // No parity
     tty.c_cflag &= ~CSTOPB;  // 1 stop bit
     tty.c_cflag &= ~CSIZE;
@@ -106,6 +197,7 @@ serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
     tty.c_cflag |= CREAD | CLOCAL;
     
     tty.c_iflag &= ~(IXON | IXOFF | IXANY); // No SW flow control
+    tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL); // Binary-safe
     tty.c_lflag &= ~ICANON; // Non-canonical mode
     tty.c_lflag &= ~ECHO;   // No echo
     tty.c_lflag &= ~ECHOE;  // No erasure
@@ -116,9 +208,9 @@ serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
     tty.c_cc[VMIN] = 0;    // Non-blocking read
     tty.c_cc[VTIME] = 5;   // 0.5 second timeout
     
-    if (tcsetattr(port->fd, TCSANOW, &tty) != 0) {
+    if (serial_apply_termios(port->fd, &tty, baud_rate) != 0) {
         close(port->fd);
-        free(port);
+        serial_port_release(port);
         return NULL;
     }
     
@@ -130,8 +222,8 @@ serial_port_t* pad_serial_open(const char* port_name, int baud_rate) {
 
 // Close serial port
 int pad_serial_close(serial_port_t* port) {
-    if (!port || !port->is_open) {
-        return -1;
+    if (!port || !port->is_open || port->watch) {
+        return -1; // Remove it from its reactor first
     }
     
 #ifdef _WIN32
@@ -141,7 +233,7 @@ int pad_serial_close(serial_port_t* port) {
 #endif
     
     port->is_open = 0;
-    free(port);
+    serial_port_release(port);
     return 0;
 }
 
@@ -183,7 +275,7 @@ int pad_serial_read(serial_port_t* port, uint8_t* buffer, size_t max_length) {
 #endif
 }
 
-// Flush serial port
+// Discard unsent output and unread input
 int pad_serial_flush(serial_port_t* port) {
     if (!port || !port->is_open) {
         return -1;
@@ -200,4 +292,665 @@ int pad_serial_flush(serial_port_t* port) {
 #endif
     
     return 0;
-}
\ No newline at end of file
+}
+
+// Change the line speed of an open port
+int pad_serial_set_baud(serial_port_t* port, int baud_rate) {
+    if (!port || !port->is_open || baud_rate <= 0) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    DCB dcb = {0};
+    dcb.DCBlength = sizeof(dcb);
+    if (!GetCommState(port->handle, &dcb)) {
+        return -1;
+    }
+    dcb.BaudRate = baud_rate;
+    return SetCommState(port->handle, &dcb) ? 0 : -1;
+#else
+    struct termios tty;
+    if (tcgetattr(port->fd, &tty) != 0) {
+        return -1;
+    }
+    return serial_apply_termios(port->fd, &tty, baud_rate);
+#endif
+}
+
+// Toggle the driver's low-latency receive mode
+int pad_serial_set_low_latency(serial_port_t* port, int enabled) {
+    if (!port || !port->is_open) {
+        return -1;
+    }
+
+#if defined(__linux__) && defined(TIOCGSERIAL)
+    struct serial_struct serial;
+    if (ioctl(port->fd, TIOCGSERIAL, &serial) != 0) {
+        return -1;
+    }
+    if (enabled) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+    } else {
+        serial.flags &= ~ASYNC_LOW_LATENCY;
+    }
+    return ioctl(port->fd, TIOCSSERIAL, &serial) == 0 ? 0 : -1;
+#else
+    (void)enabled;
+    return -1;
+#endif
+}
+
+// Block until all written data has been transmitted
+int pad_serial_drain(serial_port_t* port) {
+    if (!port || !port->is_open) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    return FlushFileBuffers(port->handle) ? 0 : -1;
+#else
+    return tcdrain(port->fd) == 0 ? 0 : -1;
+#endif
+}
+
+// Wait for input without consuming it
+int pad_serial_wait_readable(serial_port_t* port, int timeout_ms) {
+    if (!port || !port->is_open) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    uint64_t start = pad_get_timestamp_ms();
+    for (;;) {
+        COMSTAT status;
+        DWORD errors;
+        if (!ClearCommError(port->handle, &errors, &status)) {
+            return -1;
+        }
+        if (status.cbInQue > 0) {
+            return 1;
+        }
+        if (timeout_ms >= 0 && pad_get_timestamp_ms() - start >= (uint64_t)timeout_ms) {
+            return 0;
+        }
+        Sleep(1);
+    }
+#else
+    struct pollfd pfd;
+    pfd.fd = port->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ready;
+    do {
+        ready = poll(&pfd, 1, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+    if (ready < 0) return -1;
+    return ready > 0 ? 1 : 0;
+#endif
+}
+
+#ifdef __linux__
+// Read a one-line sysfs attribute, without the newline
+static int serial_read_attribute(const char* dir, const char* name, char* value, size_t size) {
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    int ok = fgets(value, (int)size, file) != NULL;
+    fclose(file);
+    if (!ok) return -1;
+    value[strcspn(value, "\r\n")] = '\0';
+    return value[0] ? 0 : -1;
+}
+#endif
+
+// Identify the USB adapter behind a port by vendor, product and serial number
+int pad_serial_adapter_id(const char* port_name, char* id, size_t size) {
+    if (!port_name || !id || size == 0) {
+        return -1;
+    }
+
+#ifdef __linux__
+    // /dev/serial/by-id/... and other links lead to the ttyUSBn node
+    char device[PATH_MAX];
+    if (!realpath(port_name, device)) {
+        return -1;
+    }
+    const char* name = strrchr(device, '/');
+    name = name ? name + 1 : device;
+
+    char path[PATH_MAX + 32];
+    char sys[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/tty/%s/device", name);
+    if (!realpath(path, sys)) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    // Walk up from the tty's interface to the USB device; stop there even
+    // without a serial number rather than reporting a hub's
+    for (;;) {
+        char vendor[16], product[16], serial[128];
+        if (serial_read_attribute(sys, "idVendor", vendor, sizeof(vendor)) == 0) {
+            if (serial_read_attribute(sys, "idProduct", product, sizeof(product)) != 0 ||
+                serial_read_attribute(sys, "serial", serial, sizeof(serial)) != 0) {
+                break;
+            }
+            int written = snprintf(id, size, "usb-%s:%s-%s", vendor, product, serial);
+            return written > 0 && (size_t)written < size ? 0 : -1;
+        }
+        char* slash = strrchr(sys, '/');
+        if (!slash || slash == sys) break;
+        *slash = '\0';
+    }
+    errno = ENODEV;
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Reactor
+// ---------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#define REACTOR_DEFAULT_OUTPUT_LIMIT (64 * 1024)
+#define REACTOR_MAX_EVENTS 64
+
+// Hashed timer wheel of 1 ms ticks; a deadline more than one turn away simply
+// stays in its slot until a later turn reaches it
+#define WHEEL_SLOTS 512
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+
+typedef struct serial_watch {
+    serial_port_t* port;
+    pad_serial_callback callback;
+    void* user;
+    uint32_t interest;          // epoll events currently registered
+    int reading;
+    int removed;
+    int send_refused;           // Deliver WRITABLE once the queue drains
+
+    uint8_t* out;               // Pending output is out[out_head, out_head + out_length)
+    size_t out_head;
+    size_t out_length;
+    size_t out_capacity;
+
+    int saved_flags;            // fd state restored on removal
+    struct termios saved_tty;
+
+    int timer_armed;
+    uint64_t timer_deadline;    // Tick (ms) at which the timeout fires
+    struct serial_watch* timer_prev;
+    struct serial_watch* timer_next;
+    struct serial_watch* fired_next;
+    struct serial_watch* free_next;
+
+    struct serial_watch* prev;  // All registered ports
+    struct serial_watch* next;
+} serial_watch;
+
+struct pad_serial_reactor {
+    int epoll_fd;
+    int wake_fd;
+    int stop_requested;
+    size_t output_limit;
+
+    serial_watch* wheel[WHEEL_SLOTS];
+    uint64_t wheel_tick;        // Last tick whose slot has been processed
+    size_t timers_armed;
+
+    serial_watch* watches;
+    int dispatching;
+    serial_watch* graveyard;    // Removed during dispatch, freed afterwards
+};
+
+static uint64_t reactor_now_ms(void) {
+    return pad_now_ns() / 1000000u;
+}
+
+static void reactor_timer_unlink(pad_serial_reactor* reactor, serial_watch* watch) {
+    if (!watch->timer_armed) return;
+
+    if (watch->timer_prev) {
+        watch->timer_prev->timer_next = watch->timer_next;
+    } else {
+        reactor->wheel[watch->timer_deadline & WHEEL_MASK] = watch->timer_next;
+    }
+    if (watch->timer_next) {
+        watch->timer_next->timer_prev = watch->timer_prev;
+    }
+    watch->timer_prev = watch->timer_next = NULL;
+    watch->timer_armed = 0;
+    reactor->timers_armed--;
+}
+
+static void reactor_free_watch(serial_watch* watch) {
+    free(watch->out);
+    free(watch);
+}
+
+static int reactor_update_interest(pad_serial_reactor* reactor, serial_watch* watch) {
+    uint32_t interest = (watch->reading ? EPOLLIN : 0) | (watch->out_length ? EPOLLOUT : 0);
+    if (interest == watch->interest) return 0;
+
+    struct epoll_event event;
+    event.events = interest;
+    event.data.ptr = watch;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, watch->port->fd, &event) != 0) return -1;
+    watch->interest = interest;
+    return 0;
+}
+
+// Write as much queued output as the driver takes; -1 on an I/O error
+static int reactor_flush_output(serial_watch* watch) {
+    while (watch->out_length > 0) {
+        ssize_t written = write(watch->port->fd, watch->out + watch->out_head, watch->out_length);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        watch->out_head += (size_t)written;
+        watch->out_length -= (size_t)written;
+    }
+    if (watch->out_length == 0) {
+        watch->out_head = 0;
+    }
+    return 0;
+}
+
+pad_serial_reactor* pad_serial_reactor_create(size_t output_limit) {
+    pad_serial_reactor* reactor = (pad_serial_reactor*)calloc(1, sizeof(pad_serial_reactor));
+    if (!reactor) return NULL;
+
+    reactor->output_limit = output_limit ? output_limit : REACTOR_DEFAULT_OUTPUT_LIMIT;
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    reactor->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (reactor->epoll_fd < 0 || reactor->wake_fd < 0) {
+        goto fail;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL; // The wake fd
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &event) != 0) {
+        goto fail;
+    }
+    reactor->wheel_tick = reactor_now_ms();
+    return reactor;
+
+fail:
+    if (reactor->epoll_fd >= 0) close(reactor->epoll_fd);
+    if (reactor->wake_fd >= 0) close(reactor->wake_fd);
+    free(reactor);
+    return NULL;
+}
+
+int pad_serial_reactor_add(pad_serial_reactor* reactor, serial_port_t* port,
+                           pad_serial_callback callback, void* user) {
+    if (!reactor || !port || !port->is_open || port->watch || !callback) {
+        return -1;
+    }
+
+    serial_watch* watch = (serial_watch*)calloc(1, sizeof(serial_watch));
+    if (!watch) return -1;
+    watch->port = port;
+    watch->callback = callback;
+    watch->user = user;
+    watch->reading = 1;
+
+    // Reads must return at once: no O_NONBLOCK wait and no VTIME delay
+    watch->saved_flags = fcntl(port->fd, F_GETFL);
+    if (watch->saved_flags < 0 || tcgetattr(port->fd, &watch->saved_tty) != 0) {
+        free(watch);
+        return -1;
+    }
+    struct termios tty = watch->saved_tty;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if (fcntl(port->fd, F_SETFL, watch->saved_flags | O_NONBLOCK) != 0 ||
+        tcsetattr(port->fd, TCSANOW, &tty) != 0) {
+        fcntl(port->fd, F_SETFL, watch->saved_flags);
+        free(watch);
+        return -1;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = watch;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, port->fd, &event) != 0) {
+        tcsetattr(port->fd, TCSANOW, &watch->saved_tty);
+        fcntl(port->fd, F_SETFL, watch->saved_flags);
+        free(watch);
+        return -1;
+    }
+    watch->interest = EPOLLIN;
+    watch->next = reactor->watches;
+    if (reactor->watches) {
+        reactor->watches->prev = watch;
+    }
+    reactor->watches = watch;
+    port->watch = watch;
+    return 0;
+}
+
+int pad_serial_reactor_remove(pad_serial_reactor* reactor, serial_port_t* port) {
+    if (!reactor || !port || !port->watch) return -1;
+
+    serial_watch* watch = port->watch;
+    reactor_timer_unlink(reactor, watch);
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, port->fd, NULL);
+    tcsetattr(port->fd, TCSANOW, &watch->saved_tty);
+    fcntl(port->fd, F_SETFL, watch->saved_flags);
+    port->watch = NULL;
+    watch->removed = 1;
+    if (watch->prev) {
+        watch->prev->next = watch->next;
+    } else {
+        reactor->watches = watch->next;
+    }
+    if (watch->next) {
+        watch->next->prev = watch->prev;
+    }
+
+    if (reactor->dispatching) {
+        // Events for it may still be in this round's batch
+        watch->free_next = reactor->graveyard;
+        reactor->graveyard = watch;
+    } else {
+        reactor_free_watch(watch);
+    }
+    return 0;
+}
+
+void pad_serial_reactor_destroy(pad_serial_reactor* reactor) {
+    if (!reactor) return;
+
+    while (reactor->watches) {
+        pad_serial_reactor_remove(reactor, reactor->watches->port);
+    }
+    while (reactor->graveyard) {
+        serial_watch* next = reactor->graveyard->free_next;
+        reactor_free_watch(reactor->graveyard);
+        reactor->graveyard = next;
+    }
+    close(reactor->epoll_fd);
+    close(reactor->wake_fd);
+    free(reactor);
+}
+
+int pad_serial_reactor_set_timeout(pad_serial_reactor* reactor, serial_port_t* port,
+                                   uint32_t timeout_ms) {
+    if (!reactor || !port || !port->watch) return -1;
+
+    serial_watch* watch = port->watch;
+    reactor_timer_unlink(reactor, watch);
+    if (timeout_ms == 0) return 0;
+
+    // Never before the next tick, so it cannot land in an already-processed slot
+    uint64_t deadline = reactor_now_ms() + timeout_ms;
+    if (deadline <= reactor->wheel_tick) {
+        deadline = reactor->wheel_tick + 1;
+    }
+    serial_watch** head = &reactor->wheel[deadline & WHEEL_MASK];
+    watch->timer_deadline = deadline;
+    watch->timer_prev = NULL;
+    watch->timer_next = *head;
+    if (*head) {
+        (*head)->timer_prev = watch;
+    }
+    *head = watch;
+    watch->timer_armed = 1;
+    reactor->timers_armed++;
+    return 0;
+}
+
+int pad_serial_reactor_set_reading(pad_serial_reactor* reactor, serial_port_t* port,
+                                   int enabled) {
+    if (!reactor || !port || !port->watch) return -1;
+    port->watch->reading = enabled ? 1 : 0;
+    return reactor_update_interest(reactor, port->watch);
+}
+
+int pad_serial_reactor_send(pad_serial_reactor* reactor, serial_port_t* port,
+                            const uint8_t* data, size_t length) {
+    if (!reactor || !port || !port->watch || (!data && length)) return -1;
+
+    serial_watch* watch = port->watch;
+    if (watch->out_length + length > reactor->output_limit) {
+        watch->send_refused = 1;
+        return -1;
+    }
+
+    // Nothing queued: hand the data straight to the driver
+    if (watch->out_length == 0) {
+        while (length > 0) {
+            ssize_t written = write(port->fd, data, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return -1;
+            }
+            data += written;
+            length -= (size_t)written;
+        }
+        if (length == 0) return 0;
+    }
+
+    // Queue the rest, compacting or growing the buffer as needed
+    if (watch->out_head + watch->out_length + length > watch->out_capacity) {
+        if (watch->out_length + length <= watch->out_capacity) {
+            memmove(watch->out, watch->out + watch->out_head, watch->out_length);
+        } else {
+            size_t capacity = watch->out_capacity ? watch->out_capacity : 4096;
+            while (capacity < watch->out_length + length) capacity *= 2;
+            uint8_t* out = (uint8_t*)malloc(capacity);
+            if (!out) return -1;
+            if (watch->out_length) {
+                memcpy(out, watch->out + watch->out_head, watch->out_length);
+            }
+            free(watch->out);
+            watch->out = out;
+            watch->out_capacity = capacity;
+        }
+        watch->out_head = 0;
+    }
+    memcpy(watch->out + watch->out_head + watch->out_length, data, length);
+    watch->out_length += length;
+    return reactor_update_interest(reactor, watch);
+}
+
+size_t pad_serial_reactor_pending(const pad_serial_reactor* reactor, const serial_port_t* port) {
+    (void)reactor;
+    return port && port->watch ? port->watch->out_length : 0;
+}
+
+// Milliseconds until the next occupied wheel slot (-1 if no timer is armed)
+static int reactor_next_timeout(const pad_serial_reactor* reactor, uint64_t now) {
+    if (reactor->timers_armed == 0) return -1;
+
+    for (uint64_t tick = reactor->wheel_tick + 1; tick <= reactor->wheel_tick + WHEEL_SLOTS; tick++) {
+        if (reactor->wheel[tick & WHEEL_MASK]) {
+            return tick <= now ? 0 : (int)(tick - now);
+        }
+    }
+    return 0;
+}
+
+// Unlink every timer due by now and chain them on a fired list
+static serial_watch* reactor_collect_expired(pad_serial_reactor* reactor, uint64_t now) {
+    serial_watch* fired = NULL;
+    if (now <= reactor->wheel_tick) return NULL;
+
+    // Far behind (e.g. a long callback): one pass over every slot suffices
+    uint64_t first = reactor->wheel_tick + 1;
+    if (now - reactor->wheel_tick > WHEEL_SLOTS) {
+        first = now - WHEEL_SLOTS + 1;
+    }
+    for (uint64_t tick = first; tick <= now; tick++) {
+        serial_watch* watch = reactor->wheel[tick & WHEEL_MASK];
+        while (watch) {
+            serial_watch* next = watch->timer_next;
+            if (watch->timer_deadline <= now) {
+                reactor_timer_unlink(reactor, watch);
+                watch->fired_next = fired;
+                fired = watch;
+            }
+            watch = next;
+        }
+    }
+    reactor->wheel_tick = now;
+    return fired;
+}
+
+int pad_serial_reactor_run_once(pad_serial_reactor* reactor, int timeout_ms) {
+    if (!reactor) return -1;
+
+    int wait_ms = reactor_next_timeout(reactor, reactor_now_ms());
+    if (wait_ms < 0 || (timeout_ms >= 0 && timeout_ms < wait_ms)) {
+        wait_ms = timeout_ms;
+    }
+
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    int count = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, wait_ms);
+    if (count < 0) {
+        if (errno != EINTR) return -1;
+        count = 0;
+    }
+
+    int dispatched = 0;
+    reactor->dispatching = 1;
+    for (int i = 0; i < count; i++) {
+        serial_watch* watch = (serial_watch*)events[i].data.ptr;
+        if (!watch) {
+            uint64_t value;
+            ssize_t ignored = read(reactor->wake_fd, &value, sizeof(value));
+            (void)ignored;
+            reactor->stop_requested = 1;
+            continue;
+        }
+        if (watch->removed) continue;
+
+        int flags = 0;
+        uint32_t ready = events[i].events;
+        if (ready & (EPOLLERR | EPOLLHUP)) {
+            flags |= PAD_SERIAL_ERROR;
+        }
+        if (ready & EPOLLOUT) {
+            if (reactor_flush_output(watch) != 0) {
+                flags |= PAD_SERIAL_ERROR;
+            } else if (watch->send_refused && watch->out_length <= reactor->output_limit / 2) {
+                watch->send_refused = 0;
+                flags |= PAD_SERIAL_WRITABLE;
+            }
+            reactor_update_interest(reactor, watch);
+        }
+        if (ready & EPOLLIN) {
+            flags |= PAD_SERIAL_READABLE;
+        }
+        if (flags) {
+            watch->callback(reactor, watch->port, flags, watch->user);
+            dispatched++;
+        }
+    }
+
+    serial_watch* fired = reactor_collect_expired(reactor, reactor_now_ms());
+    while (fired) {
+        serial_watch* watch = fired;
+        fired = watch->fired_next;
+        // Skip ports removed or re-armed by an earlier callback in this batch
+        if (!watch->removed && !watch->timer_armed) {
+            watch->callback(reactor, watch->port, PAD_SERIAL_TIMEOUT, watch->user);
+            dispatched++;
+        }
+    }
+
+    reactor->dispatching = 0;
+    while (reactor->graveyard) {
+        serial_watch* next = reactor->graveyard->free_next;
+        reactor_free_watch(reactor->graveyard);
+        reactor->graveyard = next;
+    }
+    return dispatched;
+}
+
+int pad_serial_reactor_run(pad_serial_reactor* reactor) {
+    if (!reactor) return -1;
+
+    reactor->stop_requested = 0;
+    while (!reactor->stop_requested) {
+        if (pad_serial_reactor_run_once(reactor, -1) < 0) return -1;
+    }
+    return 0;
+}
+
+void pad_serial_reactor_stop(pad_serial_reactor* reactor) {
+    if (!reactor) return;
+    uint64_t one = 1;
+    ssize_t ignored = write(reactor->wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+#else
+
+pad_serial_reactor* pad_serial_reactor_create(size_t output_limit) {
+    (void)output_limit;
+    return NULL;
+}
+
+void pad_serial_reactor_destroy(pad_serial_reactor* reactor) {
+    (void)reactor;
+}
+
+int pad_serial_reactor_add(pad_serial_reactor* reactor, serial_port_t* port,
+                           pad_serial_callback callback, void* user) {
+    (void)reactor; (void)port; (void)callback; (void)user;
+    return -1;
+}
+
+int pad_serial_reactor_remove(pad_serial_reactor* reactor, serial_port_t* port) {
+    (void)reactor; (void)port;
+    return -1;
+}
+
+int pad_serial_reactor_set_timeout(pad_serial_reactor* reactor, serial_port_t* port,
+                                   uint32_t timeout_ms) {
+    (void)reactor; (void)port; (void)timeout_ms;
+    return -1;
+}
+
+int pad_serial_reactor_set_reading(pad_serial_reactor* reactor, serial_port_t* port,
+                                   int enabled) {
+    (void)reactor; (void)port; (void)enabled;
+    return -1;
+}
+
+int pad_serial_reactor_send(pad_serial_reactor* reactor, serial_port_t* port,
+                            const uint8_t* data, size_t length) {
+    (void)reactor; (void)port; (void)data; (void)length;
+    return -1;
+}
+
+size_t pad_serial_reactor_pending(const pad_serial_reactor* reactor, const serial_port_t* port) {
+    (void)reactor; (void)port;
+    return 0;
+}
+
+int pad_serial_reactor_run_once(pad_serial_reactor* reactor, int timeout_ms) {
+    (void)reactor; (void)timeout_ms;
+    return -1;
+}
+
+int pad_serial_reactor_run(pad_serial_reactor* reactor) {
+    (void)reactor;
+    return -1;
+}
+
+void pad_serial_reactor_stop(pad_serial_reactor* reactor) {
+    (void)reactor;
+}
+
+#endif
@@ -0,0 +1,236 @@
+#include "../include/common_types.h"
+#include "../include/pad_common.h"
+#include "../include/pad_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define trace_getpid() ((int)GetCurrentProcessId())
+#else
+    #include <unistd.h>
+    #define trace_getpid() ((int)getpid())
+#endif
+
+// Chrome trace event phases
+#define TRACE_PHASE_BEGIN    'B'
+#define TRACE_PHASE_END      'E'
+#define TRACE_PHASE_INSTANT  'i'
+#define TRACE_PHASE_COMPLETE 'X'
+#define TRACE_PHASE_COUNTER  'C'
+
+// One slot of a ring. seq is written last (release) and holds index + 1, so
+// the dumper can detect a slot that was overwritten while it was being read.
+typedef struct {
+    _Atomic uint64_t seq;
+    const char* name;
+    uint64_t timestamp_ns;
+    int64_t value; // duration_ns for 'X', counter value for 'C'
+    char phase;
+} trace_event;
+
+typedef struct trace_ring {
+    struct trace_ring* next;
+    const char* thread_name;
+    uint32_t tid;
+    uint64_t mask;
+    _Atomic uint64_t head;
+    trace_event events[];
+} trace_ring;
+
+static _Atomic int trace_active = 0;
+static _Atomic uint32_t trace_generation = 0;
+static _Atomic uint32_t trace_next_tid = 1;
+static _Atomic(trace_ring*) trace_rings = NULL;
+static size_t trace_ring_capacity = 0;
+static uint64_t trace_epoch_ns = 0;
+
+static PAD_THREAD_LOCAL trace_ring* thread_ring = NULL;
+static PAD_THREAD_LOCAL uint32_t thread_ring_generation = 0;
+
+static size_t round_up_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Get (or lazily create and register) the calling thread's ring
+static trace_ring* trace_thread_ring(void) {
+    uint32_t generation = atomic_load_explicit(&trace_generation, memory_order_acquire);
+    if (thread_ring && thread_ring_generation == generation) {
+        return thread_ring;
+    }
+
+    trace_ring* ring = (trace_ring*)calloc(1, sizeof(trace_ring) +
+                                              trace_ring_capacity * sizeof(trace_event));
+    if (!ring) return NULL;
+    ring->tid = atomic_fetch_add(&trace_next_tid, 1);
+    ring->mask = trace_ring_capacity - 1;
+
+    // Lock-free push onto the global ring list
+    trace_ring* old_head = atomic_load(&trace_rings);
+    do {
+        ring->next = old_head;
+    } while (!atomic_compare_exchange_weak(&trace_rings, &old_head, ring));
+
+    thread_ring = ring;
+    thread_ring_generation = generation;
+    return ring;
+}
+
+static void trace_record(char phase, const char* name, uint64_t timestamp_ns, int64_t value) {
+    if (!atomic_load_explicit(&trace_active, memory_order_relaxed)) {
+        return;
+    }
+
+    trace_ring* ring = trace_thread_ring();
+    if (!ring) return;
+
+    uint64_t index = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    trace_event* event = &ring->events[index & ring->mask];
+    atomic_store_explicit(&event->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    event->name = name;
+    event->timestamp_ns = timestamp_ns;
+    event->value = value;
+    event->phase = phase;
+    atomic_store_explicit(&event->seq, index + 1, memory_order_release);
+    atomic_store_explicit(&ring->head, index + 1, memory_order_release);
+}
+
+int pad_trace_init(size_t events_per_thread) {
+    if (atomic_load(&trace_active)) {
+        return -1;
+    }
+    trace_ring_capacity = round_up_pow2(events_per_thread ? events_per_thread : 65536);
+    trace_epoch_ns = pad_now_ns();
+    atomic_fetch_add(&trace_generation, 1);
+    atomic_store(&trace_active, 1);
+    return 0;
+}
+
+void pad_trace_shutdown(void) {
+    atomic_store(&trace_active, 0);
+    atomic_fetch_add(&trace_generation, 1);
+
+    trace_ring* ring = atomic_exchange(&trace_rings, NULL);
+    while (ring) {
+        trace_ring* next = ring->next;
+        free(ring);
+        ring = next;
+    }
+}
+
+int pad_trace_enabled(void) {
+    return atomic_load_explicit(&trace_active, memory_order_relaxed);
+}
+
+void pad_trace_set_thread_name(const char* name) {
+    if (!pad_trace_enabled()) return;
+    trace_ring* ring = trace_thread_ring();
+    if (ring) {
+        ring->thread_name = name;
+    }
+}
+
+void pad_trace_begin(const char* name) {
+    trace_record(TRACE_PHASE_BEGIN, name, pad_now_ns(), 0);
+}
+
+void pad_trace_end(const char* name) {
+    trace_record(TRACE_PHASE_END, name, pad_now_ns(), 0);
+}
+
+void pad_trace_instant(const char* name) {
+    trace_record(TRACE_PHASE_INSTANT, name, pad_now_ns(), 0);
+}
+
+void pad_trace_complete(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+    trace_record(TRACE_PHASE_COMPLETE, name, start_ns, (int64_t)duration_ns);
+}
+
+void pad_trace_counter(const char* name, int64_t value) {
+    trace_record(TRACE_PHASE_COUNTER, name, pad_now_ns(), value);
+}
+
+static void write_json_string(FILE* file, const char* str) {
+    fputc('"', file);
+    for (const char* p = str ? str : "?"; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+            fputc(c, file);
+        } else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// Microseconds since pad_trace_init(), as Chrome expects
+static double trace_us(uint64_t timestamp_ns) {
+    return (double)(int64_t)(timestamp_ns - trace_epoch_ns) / 1000.0;
+}
+
+int pad_trace_dump_json(const char* filename) {
+    if (!filename) return -1;
+
+    FILE* file = fopen(filename, "w");
+    if (!file) return -1;
+
+    int pid = trace_getpid();
+    int first = 1;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    for (trace_ring* ring = atomic_load(&trace_rings); ring; ring = ring->next) {
+        if (ring->thread_name) {
+            fprintf(file, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+                    first ? "" : ",", pid, ring->tid);
+            write_json_string(file, ring->thread_name);
+            fprintf(file, "}}");
+            first = 0;
+        }
+
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t start = head > ring->mask + 1 ? head - (ring->mask + 1) : 0;
+        for (uint64_t index = start; index < head; index++) {
+            trace_event* slot = &ring->events[index & ring->mask];
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire) != index + 1) {
+                continue;
+            }
+            trace_event event;
+            event.name = slot->name;
+            event.timestamp_ns = slot->timestamp_ns;
+            event.value = slot->value;
+            event.phase = slot->phase;
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != index + 1) {
+                continue; // Overwritten while we were copying it
+            }
+
+            fprintf(file, "%s\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"name\":",
+                    first ? "" : ",", event.phase, pid, ring->tid, trace_us(event.timestamp_ns));
+            write_json_string(file, event.name);
+            if (event.phase == TRACE_PHASE_COMPLETE) {
+                fprintf(file, ",\"dur\":%.3f", (double)event.value / 1000.0);
+            } else if (event.phase == TRACE_PHASE_COUNTER) {
+                fprintf(file, ",\"args\":{\"value\":%lld}", (long long)event.value);
+            } else if (event.phase == TRACE_PHASE_INSTANT) {
+                fprintf(file, ",\"s\":\"t\"");
+            }
+            fputc('}', file);
+            first = 0;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    int result = ferror(file) ? -1 : 0;
+    fclose(file);
+    return result;
+}
@@ -10,6 +10,8 @@
 #include <ctime>
 #include <cstdlib>
 
+#include "pad_config.h"
+
 // Forward declarations for health monitoring components
 class SensorReader;
 class ThresholdManager;
@@ -23,6 +25,7 @@ private:
     bool verbose;
     bool daemon_mode;
     int polling_interval;
+    bool interval_from_cli;    // -i given: the config file's polling_interval is ignored
     bool mqtt_enabled;
     bool email_enabled;
     std::string mqtt_server;
@@ -31,7 +34,7 @@ private:
     
 public:
     PADHealth() : verbose(false), daemon_mode(false), 
-                  polling_interval(5), mqtt_enabled(false),
+                  polling_interval(5), interval_from_cli(false), mqtt_enabled(false),
                   email_enabled(false), output_format("text") {}
     
     void print_usage() {
@@ -104,6 +107,7 @@ public:
                 case 'i':
                     polling_interval = std::stoi(optarg);
                     if (polling_interval < 1) polling_interval = 1;
+                    interval_from_cli = true;
                     break;
                 case 'm':
                     mqtt_server = optarg;
@@ -173,16 +177,27 @@ public:
             return true;
         }
         
-        std::ifstream file(config_file);
-        if (!file.is_open()) {
+        if (pad_config_live_load(config_file.c_str()) != 0) {
             std::cerr << "Error: Could not open config file: " << config_file << std::endl;
             return false;
         }
         
-        // For now, just read the file to validate it exists
-        std::string content((std::istreambuf_iterator<char>(file)),
-                             std::istreambuf_iterator<char>());
-        if (verbose) std::cout << "Configuration loaded successfully" << std::endl;
+        // A daemon picks up edits (or SIGHUP) without pausing polling
+        if (daemon_mode &&
+            pad_config_live_watch(config_file.c_str(),
+                                  PAD_CONFIG_RELOAD_SIGHUP | PAD_CONFIG_RELOAD_INOTIFY) != 0) {
+            std::cerr << "Warning: Config reload on change is unavailable" << std::endl;
+        }
+        
+        if (verbose) {
+            std::cout << "Configuration loaded successfully" << std::endl;
+            if (!interval_from_cli) {
+                const pad_config_snapshot* config = pad_config_live_acquire();
+                int interval = pad_config_snapshot_get_int(config, "polling_interval", polling_interval);
+                pad_config_live_release();
+                std::cout << "  Polling interval: " << interval << " seconds (config file)" << std::endl;
+            }
+        }
         return true;
     }
     
@@ -225,7 +240,24 @@ public:
         
         // Main monitoring loop
         int iteration = 0;
+        uint64_t config_version = 0;
         while (true) {
+            // Thresholds come from the current config snapshot, which a
+            // reload may replace between iterations
+            const pad_config_snapshot* config = pad_config_live_acquire();
+            double max_temperature = pad_config_snapshot_get_float(config, "max_temperature", 70.0f);
+            double min_voltage = pad_config_snapshot_get_float(config, "min_voltage", 3.0f);
+            double max_voltage = pad_config_snapshot_get_float(config, "max_voltage", 3.6f);
+            int interval = interval_from_cli ? polling_interval
+                                             : pad_config_snapshot_get_int(config, "polling_interval", polling_interval);
+            uint64_t version = pad_config_snapshot_version(config);
+            pad_config_live_release();
+            
+            if (verbose && version != config_version && config_version != 0) {
+                std::cout << "Configuration reloaded (version " << version << ")" << std::endl;
+            }
+            config_version = version;
+            
             // Simulate sensor readings
             double temperature = 25.0 + (rand() % 50);  // Random temp between 25-75°C
             double voltage = 3.3 + ((rand() % 100 - 50) / 1000.0); // 3.25V to 3.35V
@@ -248,17 +280,18 @@ public:
                 std::cout << std::fixed << std::setprecision(3) << voltage << ",";
                 std::cout << std::fixed << std::setprecision(5) << clock_stability << std::endl;
             } else { // text format
-                std::cout << "[" << std::put_time(std::localtime(&std::time(nullptr)), "%F %T") << "] ";
+                std::time_t now = std::time(nullptr);
+                std::cout << "[" << std::put_time(std::localtime(&now), "%F %T") << "] ";
                 std::cout << "Temp: " << std::fixed << std::setprecision(2) << temperature << "°C, ";
                 std::cout << "Voltage: " << std::fixed << std::setprecision(3) << voltage << "V, ";
                 std::cout << "Clock: ±" << std::fixed << std::setprecision(5) << clock_stability << "%" << std::endl;
             }
             
             // Check for thresholds and trigger alerts if needed
-            if (temperature > 70.0) {
+            if (temperature > max_temperature) {
                 std::cout << "ALERT: High temperature detected: " << temperature << "°C" << std::endl;
             }
-            if (voltage < 3.0 || voltage > 3.6) {
+            if (voltage < min_voltage || voltage > max_voltage) {
                 std::cout << "ALERT: Voltage out of range: " << voltage << "V" << std::endl;
             }
             
@@ -269,7 +302,7 @@ public:
                 break;
             }
             
-            std::this_thread::sleep_for(std::chrono::seconds(polling_interval));
+            std::this_thread::sleep_for(std::chrono::seconds(interval < 1 ? 1 : interval));
         }
         
         return true;
@@ -280,7 +313,9 @@ public:
             return false;
         }
         
-        return run_monitoring();
+        bool result = run_monitoring();
+        pad_config_live_stop();
+        return result;
     }
 };
 
@@ -9,6 +9,8 @@
 #include <sstream>
 #include <cmath>
 
+#include "pad_trace.h"
+
 // Forward declarations for protocol decoders
 class UARTDecoder;
 class I2CDecoder;
@@ -28,6 +30,7 @@ private:
     std::string trigger_type;
     double trigger_level;
     bool gui_mode;
+    std::string trace_file;
     
 public:
     PADScope() : sample_rate(1000000), verbose(false), trigger_channel(-1), 
@@ -49,6 +52,7 @@ public:
         std::cout << "  --trigger-level LEVEL     Trigger voltage level (default: 1.65V)\n";
         std::cout << "  --uart-baud BAUD          UART baud rate (default: 9600)\n";
         std::cout << "  --no-gui                  Run in command-line mode only\n";
+        std::cout << "  --trace FILE              Write a Chrome/Perfetto trace of the run to FILE\n";
         std::cout << "  -V, --version             Show version information\n";
         std::cout << "  -h, --help                Show this help message\n";
         std::cout << "\nExamples:\n";
@@ -77,6 +81,7 @@ public:
             {"trigger-level", required_argument, 0, 1003},
             {"uart-baud", required_argument, 0, 1004},
             {"no-gui", no_argument, 0, 1005},
+            {"trace", required_argument, 0, 1006},
             {"version", no_argument, 0, 'V'},
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
@@ -122,6 +127,9 @@ public:
                 case 1005: // no-gui
                     gui_mode = false;
                     break;
+                case 1006: // trace
+                    trace_file = optarg;
+                    break;
                 case 'V':
                     print_version();
                     return false;
@@ -189,6 +197,7 @@ public:
     }
     
     bool initialize_device() {
+        PAD_TRACE_SPAN("initialize_device");
         std::cout << "Connecting to device: " << device_port << std::endl;
         
         // Simulate device connection
@@ -210,6 +219,7 @@ public:
     }
     
     bool setup_trigger() {
+        PAD_TRACE_SPAN("setup_trigger");
         if (trigger_channel < 0) {
             // No trigger specified, use free-running mode
             return true;
@@ -231,6 +241,7 @@ public:
         
         // Simulate data capture
         for (int sec = 0; sec < 5; ++sec) {
+            PAD_TRACE_SPAN("capture_block");
             std::cout << "Capturing... " << sec+1 << "/5 seconds\r" << std::flush;
             std::this_thread::sleep_for(std::chrono::milliseconds(1000));
         }
@@ -250,6 +261,7 @@ public:
     }
     
     bool export_data() {
+        PAD_TRACE_SPAN("export_data");
         std::cout << "Exporting data in " << export_format << " format to " << export_file << std::endl;
         
         if (export_format == "csv") {
@@ -350,15 +362,20 @@ public:
     }
     
     bool run() {
-        if (!initialize_device()) {
-            return false;
+        if (!trace_file.empty()) {
+            pad_trace_init(0);
+            pad_trace_set_thread_name("main");
         }
         
-        if (!setup_trigger()) {
-            return false;
-        }
+        bool ok = initialize_device() && setup_trigger() && run_capture();
         
-        return run_capture();
+        if (!trace_file.empty()) {
+            if (pad_trace_dump_json(trace_file.c_str()) != 0) {
+                std::cerr << "Error: Could not write trace file: " << trace_file << std::endl;
+            }
+            pad_trace_shutdown();
+        }
+        return ok;
     }
 };
 
@@ -9,12 +9,679 @@
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
 #else
 #include <unistd.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <csignal>
+#endif
+
+#ifdef __linux__
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#endif
+
+// Live per-device status for batch runs. Workers only store into their own
+// device's atomics; a single renderer thread reads them and redraws the
+// board at a fixed rate, so flashing never waits on the console.
+class StatusBoard {
+public:
+    enum class Stage : int {
+        Waiting = 0,
+        Connecting,
+        Recovery,
+        Flashing,
+        Validating,
+        Done,
+        Failed
+    };
+
+    // One cache line per device, so workers reporting progress do not
+    // contend with each other
+    static constexpr size_t kCacheLine = 64;
+    struct alignas(kCacheLine) DeviceProgress {
+        std::atomic<int> stage{static_cast<int>(Stage::Waiting)};
+        std::atomic<int> percent{0};
+        std::atomic<const char*> error{nullptr}; // String literal, set before Failed
+        std::atomic<bool> replugged{false};      // Station mode: plugged in again while busy
+
+        void set(Stage new_stage, int new_percent = 0) {
+            percent.store(new_percent, std::memory_order_relaxed);
+            stage.store(static_cast<int>(new_stage), std::memory_order_release);
+        }
+        void setPercent(int new_percent) {
+            percent.store(new_percent, std::memory_order_relaxed);
+        }
+        void fail(const char* reason) {
+            error.store(reason, std::memory_order_relaxed);
+            stage.store(static_cast<int>(Stage::Failed), std::memory_order_release);
+        }
+    };
+
+private:
+    static constexpr std::chrono::milliseconds kRedrawInterval{100};
+
+    std::unique_ptr<DeviceProgress[]> progress_;
+    std::vector<std::string> labels_;   // Sized to capacity; the first count_ are shown
+    std::atomic<size_t> count_{0};
+    std::vector<int> printed_states_;   // Renderer only: last state() logged per device
+    bool interactive_ = false;          // Redraw in place rather than log changes
+    size_t drawn_lines_ = 0;
+
+    std::thread renderer_;
+    std::mutex wake_mutex_;             // Main thread and renderer only
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    static const char* stageName(Stage stage) {
+        switch (stage) {
+            case Stage::Waiting:    return "WAITING";
+            case Stage::Connecting: return "CONNECTING";
+            case Stage::Recovery:   return "RECOVERY";
+            case Stage::Flashing:   return "FLASHING";
+            case Stage::Validating: return "VALIDATING";
+            case Stage::Done:       return "COMPLETE";
+            case Stage::Failed:     return "ERROR";
+        }
+        return "?";
+    }
+
+    // What a log line shows: the stage, and whether a replug is pending
+    static int state(const DeviceProgress& device) {
+        return device.stage.load(std::memory_order_acquire) * 2 +
+               (device.replugged.load(std::memory_order_relaxed) ? 1 : 0);
+    }
+
+    std::string line(size_t index) const {
+        const DeviceProgress& device = progress_[index];
+        Stage stage = static_cast<Stage>(device.stage.load(std::memory_order_acquire));
+        std::ostringstream out;
+        out << "[DEVICE " << (index + 1) << "] " << labels_[index] << "  " << stageName(stage);
+        if (interactive_ && (stage == Stage::Flashing || stage == Stage::Validating)) {
+            out << " (" << device.percent.load(std::memory_order_relaxed) << "%)";
+        } else if (stage == Stage::Failed) {
+            const char* reason = device.error.load(std::memory_order_relaxed);
+            if (reason) out << ": " << reason;
+        }
+        if (device.replugged.load(std::memory_order_relaxed)) {
+            out << " (replugged, flashing again next)";
+        }
+        return out.str();
+    }
+
+    void draw() {
+        size_t count = count_.load(std::memory_order_acquire);
+        std::string frame;
+        if (interactive_) {
+            // Back to the top of the board, then rewrite every line
+            if (drawn_lines_) frame += "\033[" + std::to_string(drawn_lines_) + "A";
+            for (size_t i = 0; i < count; i++) {
+                frame += "\r" + line(i) + "\033[K\n";
+            }
+            drawn_lines_ = count;
+        } else {
+            // Not a terminal: one line per stage change
+            for (size_t i = 0; i < count; i++) {
+                int current = state(progress_[i]);
+                if (current != printed_states_[i]) {
+                    printed_states_[i] = current;
+                    frame += line(i) + "\n";
+                }
+            }
+        }
+        std::cout << frame;
+        std::cout.flush();
+    }
+
+    void render() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        while (!stopping_) {
+            lock.unlock();
+            draw();
+            lock.lock();
+            wake_.wait_for(lock, kRedrawInterval, [this] { return stopping_; });
+        }
+    }
+
+public:
+    ~StatusBoard() { stop(); }
+
+    // Show one line per label until stop(), with room for add() to bring
+    // the board up to capacity lines
+    void start(const std::vector<std::string>& labels, size_t capacity = 0) {
+        stop();
+        capacity = std::max(capacity, labels.size());
+        labels_ = labels;
+        labels_.resize(capacity);
+        count_.store(labels.size(), std::memory_order_release);
+        progress_.reset(new DeviceProgress[capacity]);
+        printed_states_.assign(capacity, -1);
+#ifdef _WIN32
+        interactive_ = _isatty(_fileno(stdout)) != 0;
+#else
+        interactive_ = isatty(STDOUT_FILENO) != 0;
+#endif
+        drawn_lines_ = 0;
+        stopping_ = false;
+        renderer_ = std::thread(&StatusBoard::render, this);
+    }
+
+    // Draw the final state and end the renderer
+    void stop() {
+        if (!renderer_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        renderer_.join();
+        draw();
+    }
+
+    // Add a line while the board is shown; from one thread only. Returns
+    // its index, or SIZE_MAX if the board is full.
+    size_t add(const std::string& label) {
+        size_t index = count_.load(std::memory_order_relaxed);
+        if (index >= labels_.size()) return SIZE_MAX;
+        labels_[index] = label;
+        count_.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    DeviceProgress& device(size_t index) { return progress_[index]; }
+
+    size_t count(Stage stage) const {
+        size_t total = 0;
+        for (size_t i = 0; i < count_.load(std::memory_order_acquire); i++) {
+            if (progress_[i].stage.load(std::memory_order_acquire) == static_cast<int>(stage)) total++;
+        }
+        return total;
+    }
+};
+
+// Fixed set of worker threads, each with its own task deque. A worker runs
+// its newest task first (so a device's next step follows its last one) and,
+// when out of work, steals the oldest task of another worker. Tasks
+// submitted from a worker go to that worker's deque, others round-robin.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_queue_{0};
+
+    std::mutex state_mutex_;
+    std::condition_variable work_;      // Tasks queued, or stopping
+    std::condition_variable idle_;      // Nothing pending
+    size_t queued_ = 0;                 // In a deque
+    size_t pending_ = 0;                // Submitted and not yet finished
+    bool stopping_ = false;
+
+    // The calling thread's pool and deque, if it is a worker
+    inline static thread_local WorkStealingPool* current_pool_ = nullptr;
+    inline static thread_local size_t current_queue_ = 0;
+
+    bool take(size_t self, Task& task) {
+        {
+            Queue& own = *queues_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues_.size(); i++) {
+            Queue& victim = *queues_[(self + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t self) {
+        current_pool_ = this;
+        current_queue_ = self;
+        Task task;
+        for (;;) {
+            if (take(self, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(state_mutex_);
+                    queued_--;
+                }
+                task();
+                task = nullptr;
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                if (--pending_ == 0) idle_.notify_all();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            if (stopping_) return;
+            // A task counted but not yet taken is being taken by another worker
+            work_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t threads) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; i++) {
+            queues_.emplace_back(new Queue());
+        }
+        for (size_t i = 0; i < threads; i++) {
+            threads_.emplace_back(&WorkStealingPool::work, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            stopping_ = true;
+        }
+        work_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return threads_.size(); }
+
+    void submit(Task task) {
+        size_t index = current_pool_ == this ? current_queue_
+                                             : next_queue_.fetch_add(1) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            queued_++;
+            pending_++;
+        }
+        {
+            Queue& queue = *queues_[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        work_.notify_one();
+    }
+
+    // Until every task, including those submitted by tasks, has run
+    void wait() {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        idle_.wait(lock, [this] { return pending_ == 0; });
+    }
+};
+
+// Append-only record of a batch run, so a run that dies part way can be
+// resumed. The file is memory-mapped and sized up front for the whole run:
+// appending is a store into the page cache and survives the process dying,
+// while a background thread msyncs new records in batches to survive power
+// loss. Each record carries a checksum; torn or unwritten slots are skipped.
+class FlashJournal {
+public:
+    enum RecordType : uint16_t {
+        kBlocksDone = 1,          // value: percent of the image programmed and verified
+        kDeviceDone = 2
+    };
+    struct DeviceState {
+        bool done = false;
+        int programmed = 0;
+    };
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint64_t firmware_id;
+        uint64_t reserved;
+    };
+    struct Record {
+        uint32_t device;          // deviceKey() of the port
+        uint16_t type;
+        uint16_t value;
+        uint32_t reserved;
+        uint32_t check;           // fnv1a() of the fields above
+    };
+    static_assert(sizeof(Record) == 16, "journal records are 16 bytes");
+    static constexpr char kMagic[8] = {'P', 'A', 'D', 'J', 'R', 'N', 'L', '1'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr std::chrono::milliseconds kSyncInterval{100};
+
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;
+    size_t map_size_ = 0;
+    Record* records_ = nullptr;
+    size_t capacity_ = 0;
+    std::atomic<size_t> next_{0};       // Next free record slot
+    std::map<uint32_t, DeviceState> states_;
+
+    std::thread syncer_;
+    std::mutex sync_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    size_t synced_ = 0;                 // Syncer only: slots known to be on disk
+
+    static uint32_t checkOf(const Record& record) {
+        return fnv1a(&record, offsetof(Record, check)) | 1u; // Never 0, as unwritten slots are
+    }
+
+    // msync the pages holding slots [from, to)
+    void syncRecords(size_t from, size_t to) {
+#ifndef _WIN32
+        if (from >= to) return;
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t start = (sizeof(Header) + from * sizeof(Record)) / page * page;
+        size_t end = sizeof(Header) + to * sizeof(Record);
+        msync(map_ + start, end - start, MS_SYNC);
+#endif
+    }
+
+    void syncLoop() {
+        std::unique_lock<std::mutex> lock(sync_mutex_);
+        for (;;) {
+            bool stopping = wake_.wait_for(lock, kSyncInterval, [this] { return stopping_; });
+            size_t written = std::min(next_.load(), capacity_);
+            syncRecords(synced_, written);
+            synced_ = written;
+            if (stopping) return;
+        }
+    }
+
+public:
+    FlashJournal() = default;
+    FlashJournal(const FlashJournal&) = delete;
+    FlashJournal& operator=(const FlashJournal&) = delete;
+    ~FlashJournal() { close(); }
+
+    static uint32_t fnv1a(const void* data, size_t length, uint32_t hash = 2166136261u) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    static uint32_t deviceKey(const std::string& device_path) {
+        return fnv1a(device_path.data(), device_path.size());
+    }
+
+    // Open the journal with room for `records` more records. With resume,
+    // the existing records are read back (see state()) and appended to; the
+    // journal must be for the same firmware_id. Otherwise it starts empty.
+    bool open(const std::string& path, uint64_t firmware_id, bool resume, size_t records,
+              std::string* error) {
+        close();
+#ifdef _WIN32
+        (void)path; (void)firmware_id; (void)resume; (void)records;
+        *error = "journals are not supported on this platform";
+        return false;
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | (resume ? 0 : O_TRUNC), 0644);
+        if (fd_ < 0) {
+            *error = path + ": " + strerror(errno);
+            return false;
+        }
+        struct stat info;
+        fstat(fd_, &info);
+        size_t existing = 0;
+        if (resume && info.st_size > 0) {
+            Header header;
+            if ((size_t)info.st_size < sizeof(Header) || pread(fd_, &header, sizeof(header), 0) != sizeof(header) ||
+                memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+                header.record_size != sizeof(Record)) {
+                *error = path + ": not a pad-flasher journal";
+                close();
+                return false;
+            }
+            if (header.firmware_id != firmware_id) {
+                *error = path + ": journal is for another firmware image";
+                close();
+                return false;
+            }
+            // Replay: the last BlocksDone of a device is how far it got. New
+            // records go after the last slot that was ever written.
+            std::vector<Record> old(((size_t)info.st_size - sizeof(Header)) / sizeof(Record));
+            size_t bytes = old.size() * sizeof(Record);
+            if (pread(fd_, old.data(), bytes, sizeof(Header)) != (ssize_t)bytes) {
+                *error = path + ": " + strerror(errno);
+                close();
+                return false;
+            }
+            for (size_t i = 0; i < old.size(); i++) {
+                const Record& record = old[i];
+                if (record.check == 0) continue;
+                existing = i + 1;
+                if (record.check != checkOf(record)) continue;
+                DeviceState& state = states_[record.device];
+                if (record.type == kBlocksDone) {
+                    state.programmed = std::max<int>(state.programmed, record.value);
+                } else if (record.type == kDeviceDone) {
+                    state.done = true;
+                }
+            }
+        }
+
+        capacity_ = existing + records;
+        map_size_ = sizeof(Header) + capacity_ * sizeof(Record);
+        if (ftruncate(fd_, (off_t)map_size_) != 0) {
+            *error = path + ": " + strerror(errno);
+            close();
+            return false;
+        }
+        void* map = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) {
+            *error = path + ": " + strerror(errno);
+            map_ = nullptr;
+            close();
+            return false;
+        }
+        map_ = static_cast<uint8_t*>(map);
+        records_ = reinterpret_cast<Record*>(map_ + sizeof(Header));
+        next_ = existing;
+        synced_ = existing;
+
+        if (existing == 0) {
+            Header header{};
+            memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            header.record_size = sizeof(Record);
+            header.firmware_id = firmware_id;
+            memcpy(map_, &header, sizeof(header));
+            msync(map_, sizeof(header), MS_SYNC);
+        }
+        fsync(fd_);               // The new file size
+        stopping_ = false;
+        syncer_ = std::thread(&FlashJournal::syncLoop, this);
+        return true;
+#endif
+    }
+
+    bool isOpen() const { return map_ != nullptr; }
+
+    // What earlier runs recorded for a device
+    DeviceState state(uint32_t device) const {
+        auto found = states_.find(device);
+        return found == states_.end() ? DeviceState() : found->second;
+    }
+
+    // Safe from any thread; never waits for the disk
+    void append(uint32_t device, RecordType type, uint16_t value = 0) {
+        if (!map_) return;
+        size_t slot = next_.fetch_add(1);
+        if (slot >= capacity_) return; // Sized for the run; cannot happen
+        Record record{device, type, value, 0, 0};
+        record.check = checkOf(record);
+        memcpy(&records_[slot], &record, sizeof(record));
+    }
+
+    // Sync what is left and unmap
+    void close() {
+        if (syncer_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(sync_mutex_);
+                stopping_ = true;
+            }
+            wake_.notify_one();
+            syncer_.join();
+        }
+#ifndef _WIN32
+        if (map_) {
+            munmap(map_, map_size_);
+            // Drop the slots this run did not need
+            if (ftruncate(fd_, (off_t)(sizeof(Header) + std::min(next_.load(), capacity_) * sizeof(Record))) == 0) {
+                fsync(fd_);
+            }
+        }
+        if (fd_ >= 0) ::close(fd_);
+#endif
+        map_ = nullptr;
+        records_ = nullptr;
+        fd_ = -1;
+        states_.clear();
+    }
+};
+
+#ifdef __linux__
+// Reports serial ports as they appear, for station mode. It listens to
+// udev's netlink events if udev runs, as those come after its rules have
+// set up the port. Otherwise it uses the kernel's uevents, or failing
+// that, inotify on /dev.
+class PortWatcher {
+private:
+    enum class Source { Udev, Kernel, Inotify };
+
+    int fd_ = -1;
+    Source source_ = Source::Kernel;
+    std::vector<std::string> prefixes_;
+
+    bool matches(const std::string& name) const {
+        for (const auto& prefix : prefixes_) {
+            if (name.compare(0, prefix.size(), prefix) == 0 && name.size() > prefix.size()) return true;
+        }
+        return false;
+    }
+
+    void add(const std::string& name, std::vector<std::string>* ports) const {
+        std::string base = name.substr(name.find_last_of('/') + 1);
+        if (matches(base)) ports->push_back(name[0] == '/' ? name : "/dev/" + name);
+    }
+
+    // A uevent is NUL-separated KEY=VALUE properties, after a udev header
+    // or a kernel "ACTION@DEVPATH" line
+    void parseUevent(const char* buffer, size_t length, std::vector<std::string>* ports) const {
+        size_t offset;
+        if (length >= 20 && memcmp(buffer, "libudev", 8) == 0) {
+            uint32_t magic, properties;
+            memcpy(&magic, buffer + 8, sizeof(magic));
+            memcpy(&properties, buffer + 16, sizeof(properties));
+            if (ntohl(magic) != 0xfeedcafe) return;
+            offset = properties;
+        } else {
+            offset = strnlen(buffer, length) + 1;
+        }
+        std::string action, subsystem, name;
+        while (offset < length) {
+            std::string property(buffer + offset, strnlen(buffer + offset, length - offset));
+            offset += property.size() + 1;
+            if (property.compare(0, 7, "ACTION=") == 0) action = property.substr(7);
+            else if (property.compare(0, 10, "SUBSYSTEM=") == 0) subsystem = property.substr(10);
+            else if (property.compare(0, 8, "DEVNAME=") == 0) name = property.substr(8);
+        }
+        if (action == "add" && subsystem == "tty" && !name.empty()) add(name, ports);
+    }
+
+public:
+    PortWatcher() = default;
+    PortWatcher(const PortWatcher&) = delete;
+    PortWatcher& operator=(const PortWatcher&) = delete;
+    ~PortWatcher() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    // Watch for ports whose names start with one of prefixes
+    bool open(const std::vector<std::string>& prefixes, std::string* error) {
+        prefixes_ = prefixes;
+        fd_ = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+        if (fd_ >= 0) {
+            bool udev = access("/run/udev/control", F_OK) == 0;
+            sockaddr_nl address{};
+            address.nl_family = AF_NETLINK;
+            address.nl_groups = udev ? 2 : 1;     // udev's multicast group, or the kernel's
+            if (bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+                source_ = udev ? Source::Udev : Source::Kernel;
+                return true;
+            }
+            close(fd_);
+        }
+        fd_ = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (fd_ < 0 || inotify_add_watch(fd_, "/dev", IN_CREATE) < 0) {
+            *error = std::string("cannot watch for new ports: ") + strerror(errno);
+            return false;
+        }
+        source_ = Source::Inotify;
+        return true;
+    }
+
+    const char* source() const {
+        return source_ == Source::Udev ? "udev" : source_ == Source::Kernel ? "kernel uevents" : "inotify on /dev";
+    }
+
+    // Wait up to timeout_ms for ports to appear and add their paths to ports
+    void poll(int timeout_ms, std::vector<std::string>* ports) {
+        pollfd waiting{fd_, POLLIN, 0};
+        if (::poll(&waiting, 1, timeout_ms) <= 0) return;
+        alignas(inotify_event) char buffer[16384];
+        for (;;) {
+            ssize_t length = read(fd_, buffer, sizeof(buffer));
+            if (length <= 0) return;              // Drained (EAGAIN), or an error
+            if (source_ != Source::Inotify) {
+                parseUevent(buffer, (size_t)length, ports);
+                continue;
+            }
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0) add(event->name, ports);
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+};
+
+// Set by SIGINT/SIGTERM to end station mode
+static volatile std::sig_atomic_t g_stop_station = 0;
 #endif
 
 // PAD-Flasher Core Implementation
@@ -42,12 +709,47 @@ public:
         bool recovery_mode = false;
         bool parallel_mode = false;
         int num_devices = 0;
+        int jobs = 0;             // Worker threads for parallel mode, 0: from cores and hubs
+        std::string journal_path; // Default: the firmware path plus ".journal"
+        bool resume = false;      // Carry on from the journal of an interrupted run
+        bool station_mode = false; // Flash ports as they are plugged in, until stopped
+        std::vector<std::string> port_prefixes{"ttyUSB", "ttyACM"}; // Ports station mode takes
         std::vector<DeviceConfig> devices;
     };
 
 private:
+    // A device's job is a chain of steps; in parallel mode each step is a
+    // pool task that queues the next, so no thread stays with one device
+    enum class Step {
+        Connect,
+        Erase,
+        Program,
+        Verify,
+        Finish
+    };
+    struct DeviceJob {
+        Step step = Step::Connect;
+        int programmed = 0;       // Percent of the image written
+        uint32_t key = 0;         // FlashJournal::deviceKey of the port
+    };
+    static constexpr int kProgramChunk = 10; // Percent of the image per Program step
+    static constexpr size_t kPortsPerHub = 4; // Default ports driven at once per USB hub
+    static constexpr size_t kMaxStationPorts = 256;
+
+    // Station mode: what a port has done across plug-ins, at a fixed slot
+    struct PortState {
+        std::atomic<bool> busy{false};  // A job is queued or running
+        std::atomic<int> flashed{0};
+        std::atomic<int> failed{0};
+    };
+    std::unique_ptr<PortState[]> ports_;
+
     FlashConfig config_;
-    std::mutex output_mutex_;
+    StatusBoard board_;
+    FlashJournal journal_;
+    std::vector<DeviceJob> jobs_;
+    using Stage = StatusBoard::Stage;
+    using DeviceProgress = StatusBoard::DeviceProgress;
 
 public:
     PadFlasher() = default;
@@ -57,6 +759,7 @@ public:
         std::cout << "Supports UART/JTAG/SWD interfaces for mass device programming\n\n";
     }
 
+    // 0 to go on, 1 when done (help, version), -1 on error
     int parseCommandLine(int argc, char* argv[]) {
         config_.devices.clear();
         
@@ -104,6 +807,27 @@ public:
                 }
             } else if (arg == "-p" || arg == "--parallel") {
                 config_.parallel_mode = true;
+            } else if (arg == "-j" || arg == "--jobs") {
+                if (i + 1 < argc) {
+                    config_.jobs = std::stoi(argv[++i]);
+                }
+            } else if (arg == "--journal") {
+                if (i + 1 < argc) {
+                    config_.journal_path = argv[++i];
+                }
+            } else if (arg == "--resume") {
+                config_.resume = true;
+            } else if (arg == "--station") {
+                config_.station_mode = true;
+            } else if (arg == "--match") {
+                if (i + 1 < argc) {
+                    config_.port_prefixes.clear();
+                    std::stringstream list(argv[++i]);
+                    std::string prefix;
+                    while (std::getline(list, prefix, ',')) {
+                        if (!prefix.empty()) config_.port_prefixes.push_back(prefix);
+                    }
+                }
             } else if (arg == "-n" || arg == "--num-devices") {
                 if (i + 1 < argc) {
                     config_.num_devices = std::stoi(argv[++i]);
@@ -122,10 +846,10 @@ public:
                 }
             } else if (arg == "-h" || arg == "--help") {
                 printUsage(argv[0]);
-                return 0;
+                return 1;
             } else if (arg == "-V" || arg == "--version") {
                 printVersion();
-                return 0;
+                return 1;
             } else if (arg == "-c" || arg == "--batch") {
                 std::cout << "Batch configuration file: " << (i + 1 < argc ? argv[++i] : "") << std::endl;
                 // In a real implementation, we would parse the config file here
@@ -136,8 +860,8 @@ public:
             }
         }
 
-        // Set defaults if not specified
-        if (config_.devices.empty()) {
+        // Set defaults if not specified; a station waits for ports instead
+        if (config_.devices.empty() && !config_.station_mode) {
             DeviceConfig default_dev{};
             default_dev.type = InterfaceType::UART;
             default_dev.device_path = "/dev/ttyUSB0";
@@ -174,13 +898,22 @@ public:
         std::cout << "  -v, --validate          Validate checksum after flashing\n";
         std::cout << "  -r, --recovery          Enable recovery mode\n";
         std::cout << "  -p, --parallel          Enable parallel mode for multiple devices\n";
+        std::cout << "  -j, --jobs NUM          Worker threads in parallel mode\n";
+        std::cout << "                          (default: 4 per USB hub, at least 2 per CPU core)\n";
         std::cout << "  -c, --batch CONFIG      Batch configuration file\n";
+        std::cout << "  --journal FILE          Record progress in FILE (default: firmware path\n";
+        std::cout << "                          plus .journal)\n";
+        std::cout << "  --resume                Skip devices the journal shows finished and carry\n";
+        std::cout << "                          on partly flashed ones from their last block\n";
+        std::cout << "  --station               Flash every serial port plugged in, until stopped\n";
+        std::cout << "  --match PREFIXES        Port names station mode takes (default: ttyUSB,ttyACM)\n";
         std::cout << "  -V, --version           Print version information\n";
         std::cout << "  -h, --help              Show this help message\n\n";
         std::cout << "Examples:\n";
         std::cout << "  " << program_name << " -f firmware.hex -i uart -d /dev/ttyUSB0\n";
         std::cout << "  " << program_name << " -f firmware.hex -i swd -n 4 -p        # Flash 4 devices in parallel\n";
         std::cout << "  " << program_name << " -f firmware.hex -c batch.conf         # Use batch configuration\n";
+        std::cout << "  " << program_name << " -f firmware.hex --station -v          # Flash boards as they are plugged in\n";
     }
 
     void printVersion() {
@@ -191,17 +924,15 @@ public:
         std::cout << "Copyright (c) 2023 PAD Service\n";
     }
 
-    int initDeviceConnection(DeviceConfig& config) {
-        if (config.type == InterfaceType::UART) {
-            // In a real implementation, we would open the serial port here
-            std::lock_guard<std::mutex> lock(output_mutex_);
-            std::cout << "Connected to device via UART: " << config.device_path 
-                      << " at " << config.baudrate << " baud" << std::endl;
-        } else {
-            std::lock_guard<std::mutex> lock(output_mutex_);
-            std::cout << "Initialized connection to " << config.device_path << " via " 
-                      << (config.type == InterfaceType::JTAG ? "JTAG" : "SWD") << std::endl;
-        }
+    static const char* interfaceName(InterfaceType type) {
+        return type == InterfaceType::UART ? "UART" :
+               type == InterfaceType::JTAG ? "JTAG" : "SWD";
+    }
+
+    int initDeviceConnection(DeviceConfig& config, DeviceProgress& progress) {
+        progress.set(Stage::Connecting);
+        // In a real implementation, we would open the serial port (UART) or
+        // the debug probe (JTAG/SWD) here
         
         // For simulation purposes, just set a positive fd
         config.fd = 1;
@@ -215,57 +946,57 @@ public:
         return 0;
     }
 
-    int flashDevice(DeviceConfig& device, const std::string& firmware_path) {
-        std::lock_guard<std::mutex> lock(output_mutex_);
-        std::cout << "Flashing device " << device.device_path << " with firmware " << firmware_path << "..." << std::endl;
+    int eraseDevice(DeviceProgress& progress) {
+        progress.set(Stage::Flashing);
         
+        // Simulate a chip erase
+#ifdef _WIN32
+        Sleep(200);  // Windows sleep in milliseconds
+#else
+        usleep(200000);  // Linux sleep in microseconds
+#endif
+        return 0;
+    }
+
+    // Write the next `percent` of the image after `programmed`
+    int programBlocks(DeviceProgress& progress, int programmed, int percent) {
         // Simulate flashing process
-        for (int i = 0; i <= 100; i += 10) {
-            std::cout << "\rFlashing progress: " << i << "%";
-            std::cout.flush();
+        for (int i = programmed; i < programmed + percent; i += 10) {
 #ifdef _WIN32
-            Sleep(200);  // Windows sleep in milliseconds
+            Sleep(200);
 #else
-            usleep(200000);  // Linux sleep in microseconds
+            usleep(200000);
 #endif
+            progress.setPercent(std::min(i + 10, 100));
         }
-        std::cout << std::endl;
-        
-        std::cout << "Device " << device.device_path << " flashed successfully" << std::endl;
         return 0;
     }
 
-    int validateChecksum(const std::string& firmware_path, DeviceConfig& device) {
+    int validateChecksum(const std::string& firmware_path, DeviceConfig& device, DeviceProgress& progress) {
         if (!device.validate_after_flash) {
             return 0; // Skip validation if not requested
         }
         
-        std::lock_guard<std::mutex> lock(output_mutex_);
-        std::cout << "Validating checksum on device " << device.device_path << "..." << std::endl;
+        progress.set(Stage::Validating);
         
         // Simulate validation process
         for (int i = 0; i <= 100; i += 25) {
-            std::cout << "\rValidation progress: " << i << "%";
-            std::cout.flush();
+            progress.setPercent(i);
 #ifdef _WIN32
             Sleep(100);
 #else
             usleep(100000);
 #endif
         }
-        std::cout << std::endl;
-        
-        std::cout << "Checksum validation passed for device " << device.device_path << std::endl;
         return 0;
     }
 
-    int enterRecoveryMode(DeviceConfig& device) {
+    int enterRecoveryMode(DeviceConfig& device, DeviceProgress& progress) {
         if (!device.recovery_mode) {
             return 0; // Skip recovery if not requested
         }
         
-        std::lock_guard<std::mutex> lock(output_mutex_);
-        std::cout << "Entering recovery mode on device " << device.device_path << "..." << std::endl;
+        progress.set(Stage::Recovery);
         
         // Simulate recovery process
 #ifdef _WIN32
@@ -273,87 +1004,336 @@ public:
 #else
         sleep(1);
 #endif
-        std::cout << "Recovery mode entered successfully for device " << device.device_path << std::endl;
         return 0;
     }
 
-    void processSingleDevice(int device_index) {
+    // Run a device's next step. Returns false once its job has ended. In
+    // parallel mode this runs on a pool thread: report through the board only.
+    bool runStep(size_t device_index) {
         DeviceConfig& device = config_.devices[device_index];
-        
-        {
-            std::lock_guard<std::mutex> lock(output_mutex_);
-            std::cout << "\n--- Processing Device " << (device_index + 1) << " ---" << std::endl;
-            std::cout << "Interface: " << 
-                         (device.type == InterfaceType::UART ? "UART" :
-                          device.type == InterfaceType::JTAG ? "JTAG" : "SWD") << std::endl;
-            std::cout << "Device: " << device.device_path << std::endl;
-        }
+        DeviceProgress& progress = board_.device(device_index);
+        DeviceJob& job = jobs_[device_index];
+
+        switch (job.step) {
+            case Step::Connect:
+                // Initialize connection
+                if (initDeviceConnection(device, progress) != 0) {
+                    progress.fail("failed to initialize device");
+                    return false;
+                }
+                // Enter recovery mode if enabled
+                enterRecoveryMode(device, progress);
+                // Erasing would lose the blocks an earlier run confirmed
+                if (job.programmed > 0) {
+                    progress.set(Stage::Flashing, job.programmed);
+                    job.step = Step::Program;
+                } else {
+                    job.step = Step::Erase;
+                }
+                return true;
+
+            case Step::Erase:
+                if (eraseDevice(progress) != 0) {
+                    progress.fail("erase failed");
+                    closeDeviceConnection(device);
+                    return false;
+                }
+                job.step = Step::Program;
+                return true;
 
-        // Initialize connection
-        if (initDeviceConnection(device) != 0) {
-            std::lock_guard<std::mutex> lock(output_mutex_);
-            std::cerr << "Failed to initialize device " << device.device_path << std::endl;
-            return;
+            case Step::Program: {
+                int chunk = std::min(kProgramChunk, 100 - job.programmed);
+                if (programBlocks(progress, job.programmed, chunk) != 0) {
+                    progress.fail("flashing failed");
+                    closeDeviceConnection(device);
+                    return false;
+                }
+                job.programmed += chunk;
+                journal_.append(job.key, FlashJournal::kBlocksDone, (uint16_t)job.programmed);
+                if (job.programmed >= 100) job.step = Step::Verify;
+                return true;
+            }
+
+            case Step::Verify:
+                // Validate checksum if requested
+                if (validateChecksum(config_.firmware_path, device, progress) != 0) {
+                    progress.fail("checksum validation failed");
+                    closeDeviceConnection(device);
+                    return false;
+                }
+                job.step = Step::Finish;
+                return true;
+
+            case Step::Finish:
+                // Close connection
+                closeDeviceConnection(device);
+                journal_.append(job.key, FlashJournal::kDeviceDone);
+                progress.set(Stage::Done);
+                return false;
         }
+        return false;
+    }
+
+    // Queue a device's next step on the pool, and the one after from there
+    void scheduleStep(WorkStealingPool& pool, size_t device_index) {
+        pool.submit([this, &pool, device_index] {
+            if (runStep(device_index)) {
+                scheduleStep(pool, device_index);
+            } else if (ports_) {
+                PortState& port = ports_[device_index];
+                bool failed = board_.device(device_index).stage.load(std::memory_order_acquire) ==
+                              static_cast<int>(Stage::Failed);
+                (failed ? port.failed : port.flashed)++;
+                port.busy.store(false, std::memory_order_release);
+            }
+        });
+    }
 
-        // Enter recovery mode if enabled
-        enterRecoveryMode(device);
+    // The USB hub a serial port hangs off, from its sysfs path (say
+    // .../usb1/1-2/1-2.3/1-2.3:1.0/ttyUSB0 is port 3 of hub 1-2). Empty if
+    // unknown.
+    static std::string usbHub(const std::string& device_path) {
+#ifdef _WIN32
+        (void)device_path;
+        return "";
+#else
+        std::string name = device_path.substr(device_path.find_last_of('/') + 1);
+        char resolved[PATH_MAX];
+        if (name.empty() || !realpath(("/sys/class/tty/" + name + "/device").c_str(), resolved)) {
+            return "";
+        }
+        // The USB device is the last component like "1-2.3", without a ':'
+        std::string path = resolved, usb_device;
+        for (size_t start = 0, end; start < path.size(); start = end + 1) {
+            end = path.find('/', start);
+            if (end == std::string::npos) end = path.size();
+            std::string part = path.substr(start, end - start);
+            if (!part.empty() && isdigit((unsigned char)part[0]) &&
+                part.find('-') != std::string::npos && part.find(':') == std::string::npos) {
+                usb_device = part;
+            }
+        }
+        size_t dot = usb_device.find_last_of('.');
+        return dot == std::string::npos ? usb_device.substr(0, usb_device.find('-')) : usb_device.substr(0, dot);
+#endif
+    }
 
-        // Flash the device
-        if (flashDevice(device, config_.firmware_path) != 0) {
-            std::lock_guard<std::mutex> lock(output_mutex_);
-            std::cerr << "Failed to flash device " << device.device_path << std::endl;
-            closeDeviceConnection(device);
-            return;
+    // Steps mostly wait on the port, so a thread per core is too few. Allow
+    // a few ports per hub at once (ports without a known hub share one), at
+    // least two threads per core, and no more threads than devices.
+    size_t workerCount() const {
+        if (config_.jobs > 0) return std::min<size_t>(config_.jobs, config_.devices.size());
+        std::set<std::string> hubs;
+        for (const auto& device : config_.devices) {
+            hubs.insert(usbHub(device.device_path));
         }
+        size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+        return std::min(std::max(2 * cores, kPortsPerHub * hubs.size()), config_.devices.size());
+    }
 
-        // Validate checksum if requested
-        if (validateChecksum(config_.firmware_path, device) != 0) {
-            std::lock_guard<std::mutex> lock(output_mutex_);
-            std::cerr << "Checksum validation failed for device " << device.device_path << std::endl;
-            closeDeviceConnection(device);
-            return;
+    // Firmware identity for the journal: its path, size and modification time
+    uint64_t firmwareId() const {
+        uint64_t id = FlashJournal::fnv1a(config_.firmware_path.data(), config_.firmware_path.size());
+        struct stat info;
+        if (stat(config_.firmware_path.c_str(), &info) == 0) {
+            uint64_t size = (uint64_t)info.st_size, modified = (uint64_t)info.st_mtime;
+            id = (id << 32) | FlashJournal::fnv1a(&size, sizeof(size), FlashJournal::fnv1a(&modified, sizeof(modified)));
         }
+        return id;
+    }
 
-        // Close connection
-        closeDeviceConnection(device);
+    // Without --resume a journal is only a record, so failing to open one
+    // is not fatal
+    int openJournal() {
+        std::string path = config_.journal_path.empty() ? config_.firmware_path + ".journal"
+                                                        : config_.journal_path;
+        // Room for every record this run can append
+        size_t records = config_.devices.size() * (100 / kProgramChunk + 2);
+        std::string error;
+        if (!journal_.open(path, firmwareId(), config_.resume, records, &error)) {
+            std::cerr << (config_.resume ? "Error: " : "Warning: ") << "cannot open journal " << error << std::endl;
+            return config_.resume ? -1 : 0;
+        }
+        std::cout << "Journal: " << path << std::endl;
+        return 0;
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(output_mutex_);
-            std::cout << "Device " << device.device_path << " completed successfully" << std::endl;
+    void markFinished() {
+        for (size_t i = 0; i < config_.devices.size(); ++i) {
+            if (journal_.state(jobs_[i].key).done) board_.device(i).set(Stage::Done);
         }
     }
 
     int performBatchOperation() {
         std::cout << "Starting batch operation with " << config_.devices.size() << " device(s)" << std::endl;
+        std::cout << "Firmware: " << config_.firmware_path << std::endl;
 
-        if (config_.parallel_mode) {
-            std::cout << "Running in parallel mode" << std::endl;
-            
-            // Create threads for parallel processing
-            std::vector<std::thread> threads;
-            for (size_t i = 0; i < config_.devices.size(); ++i) {
-                threads.emplace_back(&PadFlasher::processSingleDevice, this, i);
+        std::vector<std::string> labels;
+        for (const auto& device : config_.devices) {
+            labels.push_back(device.device_path + " " + interfaceName(device.type));
+        }
+        jobs_.assign(config_.devices.size(), DeviceJob());
+        if (openJournal() != 0) {
+            return -1;
+        }
+
+        // Devices an earlier run finished are shown done and not queued
+        std::vector<size_t> pending;
+        size_t finished = 0, partial = 0;
+        for (size_t i = 0; i < config_.devices.size(); ++i) {
+            DeviceJob& job = jobs_[i];
+            job.key = FlashJournal::deviceKey(config_.devices[i].device_path);
+            FlashJournal::DeviceState state = journal_.state(job.key);
+            if (state.done) {
+                finished++;
+                continue;
             }
-            
-            // Wait for all threads to complete
-            for (auto& thread : threads) {
-                thread.join();
+            job.programmed = std::min(state.programmed / kProgramChunk * kProgramChunk, 100);
+            if (job.programmed > 0) partial++;
+            pending.push_back(i);
+        }
+        if (config_.resume) {
+            std::cout << "Resuming: " << finished << " device(s) already done, " << partial
+                      << " partly flashed" << std::endl;
+        }
+
+        if (config_.parallel_mode) {
+            WorkStealingPool pool(workerCount());
+            std::cout << "Running in parallel mode (" << pool.size() << " worker threads)" << std::endl;
+            board_.start(labels);
+            markFinished();
+            for (size_t i : pending) {
+                scheduleStep(pool, i);
             }
+            pool.wait();
         } else {
             std::cout << "Running in sequential mode" << std::endl;
-            
+            board_.start(labels);
+            markFinished();
             // Process devices sequentially
-            for (size_t i = 0; i < config_.devices.size(); ++i) {
-                processSingleDevice(i);
+            for (size_t i : pending) {
+                while (runStep(i)) {
+                }
             }
         }
 
-        return 0;
+        journal_.close();
+        board_.stop();
+        size_t failed = board_.count(Stage::Failed);
+        std::cout << (config_.devices.size() - failed) << " of " << config_.devices.size()
+                  << " device(s) completed" << std::endl;
+        return failed == 0 ? 0 : -1;
+    }
+
+    // Flash ports as they appear, until SIGINT or SIGTERM. A port keeps its
+    // slot (job, board line and counts) across plug-ins. Devices given on
+    // the command line are flashed first. No journal: every plug-in is a
+    // new board.
+    int runStation() {
+#ifdef __linux__
+        PortWatcher watcher;
+        std::string error;
+        if (!watcher.open(config_.port_prefixes, &error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+
+        size_t initial = std::min(config_.devices.size(), kMaxStationPorts);
+        config_.devices.resize(kMaxStationPorts);
+        jobs_.assign(kMaxStationPorts, DeviceJob());
+        ports_.reset(new PortState[kMaxStationPorts]);
+        std::map<std::string, size_t> slots;
+        std::vector<std::string> labels;
+        for (size_t i = 0; i < initial; ++i) {
+            slots[config_.devices[i].device_path] = i;
+            labels.push_back(config_.devices[i].device_path + " " + interfaceName(config_.devices[i].type));
+        }
+
+        size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+        WorkStealingPool pool(config_.jobs > 0 ? (size_t)config_.jobs : std::max(2 * cores, kPortsPerHub));
+        std::string prefixes;
+        for (const auto& prefix : config_.port_prefixes) {
+            prefixes += (prefixes.empty() ? "" : ",") + prefix + "*";
+        }
+        std::cout << "Station mode: flashing " << prefixes << " ports as they appear (" << watcher.source()
+                  << ", " << pool.size() << " worker threads). Ctrl+C stops." << std::endl;
+        std::cout << "Firmware: " << config_.firmware_path << std::endl;
+
+        g_stop_station = 0;
+        struct sigaction action{};
+        action.sa_handler = [](int) { g_stop_station = 1; };
+        action.sa_flags = SA_RESETHAND;       // A second Ctrl+C ends at once
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        board_.start(labels, kMaxStationPorts);
+        auto enqueue = [&](size_t slot) {
+            ports_[slot].busy.store(true, std::memory_order_relaxed);
+            jobs_[slot] = DeviceJob();
+            board_.device(slot).replugged.store(false, std::memory_order_relaxed);
+            board_.device(slot).set(Stage::Waiting);
+            scheduleStep(pool, slot);
+        };
+        for (size_t i = 0; i < initial; ++i) {
+            enqueue(i);
+        }
+
+        std::vector<std::string> ports;
+        while (!g_stop_station) {
+            ports.clear();
+            watcher.poll(200, &ports);
+            for (const auto& port : ports) {
+                auto found = slots.find(port);
+                size_t slot;
+                if (found != slots.end()) {
+                    slot = found->second;
+                    // Still flashing the last board: flash the new one once
+                    // that job ends (below)
+                    if (ports_[slot].busy.load(std::memory_order_acquire)) {
+                        board_.device(slot).replugged.store(true, std::memory_order_relaxed);
+                        continue;
+                    }
+                } else {
+                    slot = board_.add(port + " UART");
+                    if (slot == SIZE_MAX) continue; // Board full
+                    slots[port] = slot;
+                }
+                DeviceConfig& device = config_.devices[slot];
+                device = DeviceConfig{};
+                device.type = InterfaceType::UART;
+                device.device_path = port;
+                device.baudrate = 115200;
+                device.validate_after_flash = config_.validate_after_flash;
+                device.recovery_mode = config_.recovery_mode;
+                enqueue(slot);
+            }
+            for (const auto& entry : slots) {
+                size_t slot = entry.second;
+                if (board_.device(slot).replugged.load(std::memory_order_relaxed) &&
+                    !ports_[slot].busy.load(std::memory_order_acquire)) {
+                    enqueue(slot);
+                }
+            }
+        }
+
+        // Let boards being flashed finish
+        pool.wait();
+        board_.stop();
+        int failed = 0;
+        for (const auto& entry : slots) {
+            const PortState& port = ports_[entry.second];
+            std::cout << entry.first << ": " << port.flashed << " flashed, " << port.failed << " failed" << std::endl;
+            failed += port.failed;
+        }
+        return failed == 0 ? 0 : -1;
+#else
+        std::cerr << "Error: station mode needs Linux (udev, uevents or inotify)" << std::endl;
+        return -1;
+#endif
     }
 
     int run() {
-        if (performBatchOperation() != 0) {
+        if ((config_.station_mode ? runStation() : performBatchOperation()) != 0) {
             std::cerr << "Flashing operation failed" << std::endl;
             return 1;
         }
@@ -367,8 +1347,9 @@ int main(int argc, char* argv[]) {
     PadFlasher flasher;
     flasher.printBanner();
 
-    if (flasher.parseCommandLine(argc, argv) != 0) {
-        return 1;
+    int parsed = flasher.parseCommandLine(argc, argv);
+    if (parsed != 0) {
+        return parsed < 0 ? 1 : 0;
     }
 
     return flasher.run();